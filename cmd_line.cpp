@@ -6,10 +6,17 @@
 // HISTORY:
 //      14-DEC-12   D.Brown     Created
 //      26-DEC-12   D.Brown     Added immediate command mode
+//      17-OCT-26   D.Brown     Added built-in program for markovc
+//      17-OCT-26   D.Brown     Added lines command mode
+//      17-OCT-26   D.Brown     Added -tap, -junit and -filter for unit tests
+//      17-OCT-26   D.Brown     Added serve command mode
+//      17-OCT-26   D.Brown     Help lists the options with no abbreviation
 
 #include "cmd_line.h"
 #include "misc.h"
 #include <string.h>
+#include <stdlib.h>
+#include <ctype.h>
 
 
 using namespace std;
@@ -28,6 +35,12 @@ static const StrTabElement_t g_OptionNames[] =
     { CMDFLGS_TEST,       "-t" },       // 
     { CMDFLGS_IMMEDIATE,  "-imm" },     // immediate mode 
     { CMDFLGS_IMMEDIATE,  "-i" },       // 
+    { CMDFLGS_LINES,      "-lines" },   // lines mode
+    { CMDFLGS_LINES,      "-l" },       // 
+    { CMDFLGS_TAP,        "-tap" },     // unit test results as TAP
+    { CMDFLGS_JUNIT,      "-junit" },   // unit test results as JUnit XML
+    { CMDFLGS_FILTER,     "-filter" },  // select unit test cases
+    { CMDFLGS_SERVE,      "-serve" },   // serve mode
     { CMDFLGS_DEBUG,      "-debug" },   // debug mode
     { CMDFLGS_DEBUG,      "-d" },       // 
     { CMDFLGS_VERBOSE,    "-verbose" }, // verbose debug mode
@@ -50,6 +63,8 @@ static const StrTabElement_t g_CmdModeNames[] =
     { CMDMODE_FULL_FILE,        "FULL_FILE" },
     { CMDMODE_IMMEDIATE,        "IMMEDIATE" },
     { CMDMODE_UNIT_TEST,        "UNIT_TEST" },
+    { CMDMODE_LINES,            "LINES" },
+    { CMDMODE_SERVE,            "SERVE" },
     { -1,                       0 }
 };
 
@@ -64,7 +79,10 @@ inline const char * YES_OR_NO( bool flag )
 
 CmdLine::CmdLine() :
   myCmdMode(CMDMODE_FULL_FILE),
-  myFlags(0)
+  myFlags(0),
+  myHasBuiltInProgram(false),
+  myFilterStr(0),
+  mySocketName(0)
 {
     memset( myFilenames, 0, sizeof(myFilenames) );
 }
@@ -89,12 +107,72 @@ bool CmdLine::PostProcessArguments()
         num_mode_flags++;
     }
 
-    if ( num_mode_flags > 1 )
+    if ( SET_IN( myFlags, CMDFLGS_LINES ) )
+    {
+        myCmdMode = CMDMODE_LINES;
+        num_mode_flags++;
+    }
+
+    if ( SET_IN( myFlags, CMDFLGS_SERVE ) )
+    {
+        myCmdMode = CMDMODE_SERVE;
+        num_mode_flags++;
+    }
+
+    if ( num_mode_flags > 1 ||
+         ( SET_IN( myFlags, CMDFLGS_TAP ) &&
+           SET_IN( myFlags, CMDFLGS_JUNIT ) ) )
     {
         fprintf( stderr, "ERROR: Incompatible command line flags\n" );
         return false;
     }
 
+    if ( myCmdMode != CMDMODE_UNIT_TEST &&
+         ( SET_IN( myFlags, CMDFLGS_TAP ) ||
+           SET_IN( myFlags, CMDFLGS_JUNIT ) ||
+           SET_IN( myFlags, CMDFLGS_FILTER ) ) )
+    {
+        fprintf( stderr, "ERROR: -tap, -junit and -filter need -test\n" );
+        return false;
+    }
+
+    if ( myCmdMode == CMDMODE_SERVE )
+    {
+        // the input and output filenames are more programs to serve
+        if ( myHasBuiltInProgram && 
+             ( myFilenames[FNID_INPUT_FILE] != 0 || 
+               !myMoreFilenames.empty() ) )
+        {
+            fprintf( stderr, "ERROR: -serve with a built-in program "
+                             "takes no filenames\n" );
+            return false;
+        }
+
+        for ( int fnid = 0; fnid < FNID_END && !myHasBuiltInProgram; fnid++ )
+        {
+            if ( myFilenames[fnid] != 0 )
+            {
+                myServedProgramFileNames.push_back( myFilenames[fnid] );
+            }
+        }
+
+        myServedProgramFileNames.insert( myServedProgramFileNames.end(),
+                                         myMoreFilenames.begin(),
+                                         myMoreFilenames.end() );
+    }
+    else if ( !myMoreFilenames.empty() )
+    {
+        fprintf( stderr, "ERROR: Too many filenames in argument list\n" );
+        return false;
+    }
+
+    if ( myFilterStr != 0 && !ParseFilter() )
+    {
+        fprintf( stderr, "ERROR: Invalid -filter line numbers: %s\n",
+                 myFilterStr );
+        return false;
+    }
+
     if ( !SET_IN( myFlags, CMDFLGS_HELP ) &&
          !SET_IN( myFlags, CMDFLGS_OPTIONS ) )
     {
@@ -115,10 +193,18 @@ bool CmdLine::PostProcessArguments()
 
 
 
+void CmdLine::SetBuiltInProgram( const char * theProgramFileName )
+{
+    myFilenames[FNID_PROGRAM_FILE] = theProgramFileName;
+    myHasBuiltInProgram = true;
+}
+
+
+
 bool CmdLine::ProcessArguments( int argc,
                                 char * argv[] )
 {
-    int fnid = 0;
+    int fnid = myHasBuiltInProgram ? FNID_INPUT_FILE : FNID_PROGRAM_FILE;
     int flagid;
 
     for ( int i = 1; i < argc; i++ )
@@ -129,6 +215,24 @@ bool CmdLine::ProcessArguments( int argc,
         {
             flagid = strtab_StringToValue( g_OptionNames, a );
 
+            if ( flagid == CMDFLGS_FILTER || flagid == CMDFLGS_SERVE )
+            {
+                if ( i + 1 == argc )
+                {
+                    fprintf( stderr, "ERROR: %s needs an argument\n", a );
+                    return false;
+                }
+
+                if ( flagid == CMDFLGS_FILTER )
+                {
+                    myFilterStr = argv[++i];
+                }
+                else
+                {
+                    mySocketName = argv[++i];
+                }
+            }
+
             if ( flagid >= 0 )
             {
                 myFlags |= SET_BIT( flagid );
@@ -145,8 +249,7 @@ bool CmdLine::ProcessArguments( int argc,
         }
         else
         {
-            fprintf( stderr, "ERROR: Too many filenames in argument list\n" );
-            return false;
+            myMoreFilenames.push_back( a );
         }
     }
 
@@ -238,20 +341,133 @@ bool CmdLine::WriteToDebug() const
 
 
 
+bool CmdLine::LineIsSelected( unsigned theLineNumber ) const
+{
+    if ( myFilterStr == 0 )
+    {
+        return true;
+    }
+
+    for ( size_t i = 0; i < myFilterRanges.size(); i++ )
+    {
+        if ( theLineNumber >= myFilterRanges[i].first &&
+             theLineNumber <= myFilterRanges[i].second )
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+
+bool CmdLine::ParseFilter()
+{
+    const char * p = myFilterStr;
+
+    myFilterRanges.clear();
+
+    for ( ;; )
+    {
+        char * end;
+
+        if ( !isdigit( (unsigned char)*p ) )
+        {
+            return false;
+        }
+
+        unsigned first = (unsigned)strtoul( p, &end, 10 );
+        unsigned last = first;
+        p = end;
+
+        if ( *p == '-' )
+        {
+            p++;
+
+            if ( !isdigit( (unsigned char)*p ) )
+            {
+                return false;
+            }
+
+            last = (unsigned)strtoul( p, &end, 10 );
+            p = end;
+        }
+
+        if ( last < first )
+        {
+            return false;
+        }
+
+        myFilterRanges.push_back( make_pair( first, last ) );
+
+        if ( *p == 0 )
+        {
+            return true;
+        }
+
+        if ( *p++ != ',' )
+        {
+            return false;
+        }
+    }
+}
+
+
+
+const char * CmdLine::SocketName() const
+{
+    return mySocketName;
+}
+
+
+
+const vector<const char *> & CmdLine::ServedProgramFileNames() const
+{
+    return myServedProgramFileNames;
+}
+
+
+
 void CmdLine::DoPrintHelp( ostream & outfile ) const
 {
-    outfile << "Syntax: " << ThisProgramName() << 
-               " <options> <program_file> <input_file> <output_file>" <<
-               endl << endl;
+    if ( myHasBuiltInProgram )
+    {
+        outfile << "Syntax: " << ThisProgramName() <<
+                   " <options> <input_file> <output_file>" << endl << endl;
+        outfile << "The program is built in, compiled from " <<
+                   ProgramFileName() << endl << endl;
+    }
+    else
+    {
+        outfile << "Syntax: " << ThisProgramName() <<
+                   " <options> <program_file> <input_file> <output_file>" <<
+                   endl << endl;
+    }
+
     outfile << "output_file and input_file can be omitted from the right " <<
                "if not needed." << endl << endl;
     outfile << "options can appear anywhere on command line." << endl;
     outfile << 
-        "options are 0 or more of: (can abbreviate to 1 char after the dash)"
+        "options are 0 or more of: (can abbreviate to 1 char after the dash,"
         << endl;
+    outfile << "                            " <<
+        "except -tap, -junit, -filter, -serve and -options)" << endl;
     outfile << "     -imm     - immediate mode: use " <<
                                 "input_file itself as input string" << endl;
     outfile << "     -test    - unit test mode" << endl;
+    outfile << "     -lines   - lines mode: transform each line " <<
+                                "separately, in parallel" << endl;
+    outfile << "     -tap     - with -test: run every case in parallel, " <<
+                                "report as TAP" << endl;
+    outfile << "     -junit   - with -test: run every case in parallel, " <<
+                                "report as JUnit XML" << endl;
+    outfile << "     -filter  - with -test: only run the cases at the " <<
+                                "lines given next," << endl;
+    outfile << "                e.g. -filter 12,40-60" << endl;
+    outfile << "     -serve   - serve mode: answer requests on the Unix " <<
+                                "socket given next," << endl;
+    outfile << "                for each program_file given" << endl;
     outfile << "     -debug   - write debug log to " << ThisProgramName() <<
                                 ".log" << endl;
     outfile << "     -verbose - write even more log info" << endl;
@@ -278,6 +494,10 @@ void CmdLine::DoPrintOptions( ostream & outfile ) const
     outfile << "Flags:" << endl;
     outfile << "    -debug :             " <<
              YES_OR_NO(WriteToDebug()) << endl;
+    outfile << "    -filter :            " <<
+             ( myFilterStr != 0 ? myFilterStr : g_NoneStr ) << endl;
+    outfile << "    -serve :             " <<
+             ( mySocketName != 0 ? mySocketName : g_NoneStr ) << endl;
     outfile << "    -print :             " <<
              YES_OR_NO(SET_IN(CmdFlags(), CMDFLGS_PRINT)) << endl;
     outfile << "    -options :           " <<
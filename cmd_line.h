@@ -7,22 +7,30 @@
 //          CmdLineFlags_t  - Flags: bits of CmdLine.CmdFlags()
 //          CmdMode_t       - Operation mode:
 //                            - full file mode reads entire file,
-//                            - single line mode reads and processes
-//                              each line separately,
+//                            - lines mode reads and processes
+//                              each line separately, in parallel,
 //                            - unit test mode reads and processes
 //                              each line and compares it to the
-//                              next line.
+//                              next line,
+//                            - serve mode answers requests on a
+//                              Unix socket (see server.h).
 //          FileId_t        - Index for accessing the file name strings
 //
 // HISTORY:
 //      14-DEC-12   D.Brown     Created
 //      26-DEC-12   D.Brown     Added immediate command mode
+//      17-OCT-26   D.Brown     Added built-in program for markovc
+//      17-OCT-26   D.Brown     Added lines command mode
+//      17-OCT-26   D.Brown     Added -tap, -junit and -filter for unit tests
+//      17-OCT-26   D.Brown     Added serve command mode
 
 #ifndef CMD_LINE_H
 #define CMD_LINE_H
 
 #include "misc.h"
 #include <iostream>
+#include <vector>
+#include <utility>
 #include <stdio.h>
 
 
@@ -33,6 +41,11 @@ enum CmdLineFlags_t
 {
     CMDFLGS_TEST,       // -test or -t : unit test mode
     CMDFLGS_IMMEDIATE,  // -imm or -i : input filename is input string
+    CMDFLGS_LINES,      // -lines or -l : transform each line separately
+    CMDFLGS_TAP,        // -tap : unit test results as TAP
+    CMDFLGS_JUNIT,      // -junit : unit test results as JUnit XML
+    CMDFLGS_FILTER,     // -filter <lines> : only run these unit test cases
+    CMDFLGS_SERVE,      // -serve <socket> : serve the programs on a socket
     CMDFLGS_DEBUG,      // -debug or -d : debug info to markov.log
     CMDFLGS_VERBOSE,    // -verbose or -v : verbose debug mode
     CMDFLGS_CONSOLE,    // -console -r -c : debug & verbose info to console
@@ -49,6 +62,8 @@ enum CmdMode_t
     CMDMODE_FULL_FILE,          // read entire file then do transformation, output
     CMDMODE_IMMEDIATE,          // input filename itself is the input string
     CMDMODE_UNIT_TEST,          // read line, transform, compare with next line, loop
+    CMDMODE_LINES,              // transform each line in parallel, output in order
+    CMDMODE_SERVE,              // answer transform requests on a socket
 
     CMDMODE_END
 };
@@ -76,6 +91,12 @@ private:
     CmdLine & operator = ( const CmdLine & theOther );
 
 public:
+    // For a program compiled by markovc: the program is built in, so
+    // the first filename argument is the input file.  theProgramFileName
+    // is the name of the source it was compiled from.  Must be called
+    // before ProcessArguments.
+    void SetBuiltInProgram( const char * theProgramFileName );
+
     bool ProcessArguments( int argc,
                            char * argv[] );
 
@@ -97,17 +118,39 @@ public:
 
     bool WriteToDebug() const;
 
+    // Returns true if the unit test case whose input string is at line
+    // theLineNumber of the input file was selected by -filter, which
+    // takes a list of line numbers and ranges such as 12,40-60.
+    // Without -filter every case is selected.
+    bool LineIsSelected( unsigned theLineNumber ) const;
+
+    // The Unix socket of serve mode, or 0 if not serve mode.
+    const char * SocketName() const;
+
+    // In serve mode every filename argument is a program file to serve,
+    // so there can be any number of them.  Empty for a built-in program.
+    const std::vector<const char *> & ServedProgramFileNames() const;
+
     void DoPrintHelp( std::ostream & theOutputFile ) const;
 
     void DoPrintOptions( std::ostream & theOutputFile ) const;
 
 private:
     bool PostProcessArguments();
+
+    // Parses myFilterStr into myFilterRanges.
+    bool ParseFilter();
     
 private:
     CmdMode_t    myCmdMode;
     BitSet_t     myFlags;
     const char * myFilenames[FNID_END];
+    bool         myHasBuiltInProgram;
+    const char * myFilterStr;                   // -filter argument or 0
+    const char * mySocketName;                  // -serve argument or 0
+    std::vector<const char *> myMoreFilenames;  // past FNID_END
+    std::vector<const char *> myServedProgramFileNames;
+    std::vector< std::pair<unsigned, unsigned> > myFilterRanges;
 };
 
 
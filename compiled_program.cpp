@@ -0,0 +1,123 @@
+// FILE: compiled_program.cpp
+//
+// DESCRIPTION:
+//      Implements module described in compiled_program.h
+//
+// HISTORY:
+//      17-OCT-26   D.Brown     Created
+//      17-OCT-26   D.Brown     Added serve mode
+//      17-OCT-26   D.Brown     Prepare the built Program
+
+#include "compiled_program.h"
+#include "misc.h"
+#include "cmd_line.h"
+#include "instr.h"
+#include "driver.h"
+#include "work_status.h"
+#include "server.h"
+#include <iostream>
+#include <vector>
+
+using namespace std;
+
+
+#define EXIT_OK    0
+#define EXIT_ERROR 100
+
+
+
+static void BuildProgram( Program & theProgram,
+                          const CompiledRule * theRules,
+                          size_t theNumRules )
+{
+    theProgram.resize( theNumRules );
+
+    for ( size_t i = 0; i < theNumRules; i++ )
+    {
+        const CompiledRule & rule = theRules[i];
+        Instr & instr = theProgram[i];
+
+        instr.SetLineNumber( rule.myLineNumber );
+        instr.PutPatternStr( TaggedString( rule.myPattern,
+                                           rule.myPattern +
+                                               rule.myPatternLength ) );
+        instr.PutReplacementStr( TaggedString( rule.myReplacement,
+                                               rule.myReplacement +
+                                                 rule.myReplacementLength ) );
+        instr.SetNativeMatcher( rule.myMatchFn );
+    }
+
+    theProgram.Prepare();
+}
+
+
+
+int RunCompiledProgram( const CompiledRule * theRules,
+                        size_t theNumRules,
+                        const char * theProgramFileName,
+                        int argc,
+                        char * argv[] )
+{
+    CmdLine cmd_line;
+
+    cmd_line.SetBuiltInProgram( theProgramFileName );
+
+    if ( !cmd_line.ProcessArguments( argc, argv ) )
+    {
+        cmd_line.DoPrintHelp( cerr );
+        return EXIT_ERROR;
+    }
+    else if ( SET_IN(cmd_line.CmdFlags(), CMDFLGS_HELP) )
+    {
+        cmd_line.DoPrintHelp( cout );
+        return EXIT_OK;
+    }
+    else if ( SET_IN(cmd_line.CmdFlags(), CMDFLGS_OPTIONS) )
+    {
+        cmd_line.DoPrintOptions( cout );
+        return EXIT_OK;
+    }
+
+    Program program;
+
+    BuildProgram( program, theRules, theNumRules );
+
+    if ( SET_IN(cmd_line.CmdFlags(), CMDFLGS_PRINT) )
+    {
+        PrintProgram( program, cmd_line.ThisProgramName(),
+                      cmd_line.WriteToStdout() ?
+                         0 : cmd_line.OutputFileName() );
+        return EXIT_OK;
+    }
+
+    if ( cmd_line.CmdMode() == CMDMODE_SERVE )
+    {
+        Server server( cmd_line.SocketName() );
+
+        server.AddProgram( theProgramFileName, program );
+
+        WorkStatus_t ws = server.Run();
+
+        if ( ws != WS_OK )
+        {
+            cerr << "Server returns error " <<
+                     GetWorkStatusStr(ws) << endl;
+            return EXIT_ERROR;
+        }
+
+        return EXIT_OK;
+    }
+
+    Driver driver( cmd_line, program );
+
+    WorkStatus_t ws = driver.Run();
+
+    if ( ws != WS_OK )
+    {
+        cerr << "Driver returns error " <<
+                 GetWorkStatusStr(ws) << endl;
+        return EXIT_ERROR;
+    }
+
+    return EXIT_OK;
+}
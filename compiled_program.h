@@ -0,0 +1,48 @@
+// FILE: compiled_program.h
+//
+// DESCRIPTION:
+//      Defines the interface between the C++ programs written by markovc
+//      (see program_compiler.h) and the Markov runtime.
+//
+//      A compiled program is an array of CompiledRule, one for each
+//      instruction of the Markov program, holding its pattern and
+//      replacement strings and the native matcher markovc generated for
+//      the pattern.  The main() of the compiled program passes the array
+//      to RunCompiledProgram, which builds the Program from it and runs
+//      it with the same command line as markov, except that there is no
+//      program file argument.
+//
+// HISTORY:
+//      17-OCT-26   D.Brown     Created
+
+#ifndef COMPILED_PROGRAM_H
+#define COMPILED_PROGRAM_H
+
+
+#include "tagged_char.h"
+#include "instr.h"
+#include <stddef.h>
+
+
+struct CompiledRule
+{
+    unsigned             myLineNumber;
+    const TaggedChar_t * myPattern;
+    size_t               myPatternLength;
+    const TaggedChar_t * myReplacement;
+    size_t               myReplacementLength;
+    NativeMatchFn_t      myMatchFn;         // 0 to use Work's matchers
+};
+
+
+// Runs the program made of theNumRules rules in theRules, which was
+// compiled from theProgramFileName, with the command line in argc, argv.
+// Returns the exit code for main().
+int RunCompiledProgram( const CompiledRule * theRules,
+                        size_t theNumRules,
+                        const char * theProgramFileName,
+                        int argc,
+                        char * argv[] );
+
+
+#endif // COMPILED_PROGRAM_H
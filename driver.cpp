@@ -6,13 +6,29 @@
 // HISTORY:
 //      14-DEC-12   D.Brown     Created
 //      26-DEC-12   D.Brown     Added immediate command mode
+//      17-OCT-26   D.Brown     Reuse the Work for each input with a WorkPool
+//      17-OCT-26   D.Brown     Added lines command mode
+//      17-OCT-26   D.Brown     Run unit tests in parallel for -tap and -junit
+//      17-OCT-26   D.Brown     Moved ReadTaggedString, WriteTaggedString to
+//                              tagged_io.cpp
+//      17-OCT-26   D.Brown     Lines mode keeps ~ as it is, so each line
+//                              gives one output line
 
 #include "driver.h"
 #include "work.h"
+#include "work_pool.h"
+#include "line_pipeline.h"
+#include "unit_test_report.h"
+#include "tagged_io.h"
 #include "misc.h"
 #include <iostream>
 #include <fstream>
+#include <sstream>
 #include <string>
+#include <thread>
+#include <functional>
+#include <atomic>
+#include <chrono>
 
 using namespace std;
 
@@ -20,8 +36,13 @@ using namespace std;
 #define DEBUG_FILE_EXTENSION ".log"
 #define IMMEDIATE_EXTENSION  ".in"
 
-#define BACKSLASH                 '\\'
-#define SPECIAL_END_OF_LINE_CHAR '~'
+
+// RunLines passes the lines between its threads in batches of this many,
+// so the locking costs little next to the transformations
+#define LINES_PER_BATCH 64
+
+// RunLines lets this many batches per worker be read ahead of the writer
+#define BATCHES_PER_WORKER 4
 
 
 
@@ -51,90 +72,6 @@ static WorkStatus_t OpenDebugFile( ofstream & dbg,
 }
 
 
-// Reads from theInStrm into theInputString.
-// Updates theLineNumber at end-of-lines.
-// Converts any end-of-line characters to tagged ~.
-// If theStopAtEndOfLine then stops reading at the end of the line,
-// and doesn't add the end-of-line character to theInputString.
-// If theCvtTildaToTaggedTilda is true converts ~ to tagged ~
-// If theCvtToTagged is true \ will cause next char to be tagged.
-static WorkStatus_t ReadTaggedString( istream & theInStrm,
-                                      TaggedString & theInputString,
-                                      unsigned & theLineNumber,
-                                      bool theStopAtEndOfLine,
-                                      bool theCvtTildaToTaggedTilda,
-                                      bool theCvtToTagged )
-{
-    WorkStatus_t status = WS_CONTINUE;
-    bool next_is_tagged = false;
-
-    while ( status == WS_CONTINUE )
-    {
-        char c;
-        theInStrm.get( c );
-
-        if ( theInStrm && c == '\t' )       // convert tabs to spaces
-        {
-            c = ' ';
-        }
-
-        if ( !theInStrm )
-        {
-            status = WS_END_OF_FILE;     // tbd: check for read errors as well as eof
-        }
-        else if ( IsEndOfLine( theInStrm, c ) )
-        {
-            theLineNumber++;
-
-            if ( theStopAtEndOfLine )
-            {
-                status = WS_OK;
-            }
-            else 
-            {
-                theInputString.push_back( 
-                       ToTaggedChar(SPECIAL_END_OF_LINE_CHAR) );
-            }
-
-            next_is_tagged = false;
-        }
-        else
-        {
-            TaggedChar_t tc = ToUntaggedChar( c );
-
-            if ( next_is_tagged )
-            {
-                tc = ToTaggedChar( c );
-                next_is_tagged = false;
-            }
-
-            if ( theCvtToTagged && tc == '\\' )
-            {
-                next_is_tagged = true;
-            }
-            else
-            {
-                if ( c == SPECIAL_END_OF_LINE_CHAR && 
-                     theCvtTildaToTaggedTilda )
-                {
-                    theInputString.push_back( ToTaggedChar(c) );
-                }
-                else if ( c >= FIRST_PRINTING_CHAR && c <= LAST_PRINTING_CHAR )
-                {
-                    theInputString.push_back( tc );
-                }
-                // else ignore nonprinting chars
-
-                next_is_tagged = false;
-            }
-        }
-    }
-
-    return status;
-}
-
-
-
 // skip any lines in the input stream which begin with ';'.
 // also skips blank lines as long as they don't contain any spaces.
 static WorkStatus_t SkipCommentLines( istream & theInputStream,
@@ -174,52 +111,10 @@ static WorkStatus_t SkipCommentLines( istream & theInputStream,
 }
 
 
-// Writes theString to theOutputStream.
-// If theConvertTildaToEoln is true, any tagged ~ characters are converted
-// to end-of-lines.  Any tagged characters (other than ~) are prefixed with
-// a backspace.  If the string doesn't end with an end-of-line, 
-// terminates the line.
-static void WriteTaggedString( ostream & theOutputStream,
-                               const TaggedString & theString,
-                               bool theConvertTildaToEoln )
-{
-    size_t len = theString.size();
-    char c = 0;
-
-    for ( size_t i = 0; i < len; i++ )
-    {
-        TaggedChar_t tc = theString[i];
-        c = ToUntaggedChar( tc );
-
-        if ( c == '\n' || 
-             ( c == SPECIAL_END_OF_LINE_CHAR && IsTagged(tc) && 
-               theConvertTildaToEoln ) )
-        {
-            theOutputStream << endl;
-            c = '\n';
-        }
-        else
-        {
-            if ( c != SPECIAL_END_OF_LINE_CHAR && IsTagged( tc ) )
-            {
-                theOutputStream.put( BACKSLASH );
-            }
-
-            theOutputStream.put( c );
-        }
-    }
-
-    if ( c != '\n' )
-    {
-        theOutputStream << endl;
-    }
-}
-
-
 // compares the two strings, and if they are the same returns WS_OK
 // otherwise returns WS_ERROR_DOESNT_MATCH_EXPECTED
-static WorkStatus_t CompareWithExpected( TaggedString & output_string,
-                                         TaggedString & expected_string )
+static WorkStatus_t CompareWithExpected( const TaggedString & output_string,
+                                         const TaggedString & expected_string )
 {
     WorkStatus_t status = WS_OK;
 
@@ -310,6 +205,9 @@ WorkStatus_t Driver::RunSub( istream  & theInputStream,
         dbg_ptr = status == WS_OK ? &dbg : 0;
     }
 
+    // each input is transformed by the same Work, reset between them
+    WorkPool work_pool( myProgram, isVerbose, theDebugToConsole );
+
     while ( status == WS_OK && theInputStream )
     {
         TaggedString input_string;
@@ -328,10 +226,35 @@ WorkStatus_t Driver::RunSub( istream  & theInputStream,
 
         status = ReadTaggedString( theInputStream, input_string, 
                                    line_number, 
-                                   theCmdMode == CMDMODE_UNIT_TEST,
-                                   theCmdMode != CMDMODE_FULL_FILE,
+                                   theCmdMode == CMDMODE_UNIT_TEST ||
+                                     theCmdMode == CMDMODE_LINES,
+                                   theCmdMode != CMDMODE_FULL_FILE &&
+                                     theCmdMode != CMDMODE_LINES,
                                    theCmdMode == CMDMODE_UNIT_TEST );
 
+        // a case not selected by -filter is skipped with its expected string
+        if ( theCmdMode == CMDMODE_UNIT_TEST &&
+             !myCmdLine.LineIsSelected( saved_line_number ) )
+        {
+            TaggedString expected;
+
+            if ( status == WS_OK )
+            {
+                status = ReadTaggedString( theInputStream, expected, 
+                                           line_number, true, true, true );
+            }
+
+            continue;
+        }
+
+        // in lines mode the end of the file after the last end-of-line
+        // isn't another line
+        if ( theCmdMode == CMDMODE_LINES && status == WS_END_OF_FILE &&
+             input_string.empty() )
+        {
+            break;
+        }
+
         if ( dbg_ptr != 0 )
         {
             DebugWriteInputString( dbg, input_string, line_number );
@@ -344,11 +267,13 @@ WorkStatus_t Driver::RunSub( istream  & theInputStream,
 
         TaggedString output_string;
 
-        Work work( myProgram, isVerbose, theDebugToConsole );
+        Work & work = work_pool.Acquire();
 
         status = work.DoTransformations( input_string, output_string, 
                                          dbg_ptr );
 
+        work_pool.Release( work );
+
         if ( dbg_ptr != 0 )
         {
             DebugWriteOutputString( dbg, output_string );
@@ -360,7 +285,8 @@ WorkStatus_t Driver::RunSub( istream  & theInputStream,
         }
         else
         {
-            WriteTaggedString( theOutputStream, output_string, true );
+            WriteTaggedString( theOutputStream, output_string, 
+                               theCmdMode != CMDMODE_LINES );
         }
 
         if ( status == WS_OK && theCmdMode == CMDMODE_UNIT_TEST )
@@ -421,6 +347,343 @@ WorkStatus_t Driver::RunSub( istream  & theInputStream,
 }
 
 
+// One case of a unit test file: an input string and its expected output.
+struct UnitTestCase
+{
+    unsigned myLineNumber;          // line of myInput in the test file
+    TaggedString myInput;
+    TaggedString myExpected;
+};
+
+
+// The cases of a unit test file and their results, shared by the
+// worker threads of RunUnitTests.
+struct UnitTestRun
+{
+    const Program & myProgram;
+    bool myIsVerbose;
+    bool myDebugToConsole;
+    ofstream * myDebug;                     // 0 if not debugging
+    const vector<UnitTestCase> & myCases;
+    vector<UnitTestResult> & myResults;     // one for each of myCases
+    atomic<size_t> myNextCase;              // next case to be run
+};
+
+
+// Returns theString as WriteTaggedString writes it, without the
+// end-of-line at the end.
+static string TaggedStringText( const TaggedString & theString )
+{
+    ostringstream out;
+
+    WriteTaggedString( out, theString, false );
+
+    string text = out.str();
+    text.erase( text.size() - 1 );
+
+    return text;
+}
+
+
+// Reads all of the unit test file theInputStream, and appends the cases
+// selected by theCmdLine's -filter to theCases.  An input string at the
+// end of the file without an expected string isn't a case, as RunSub
+// doesn't compare it.
+static void ReadUnitTestCases( istream & theInputStream,
+                               const CmdLine & theCmdLine,
+                               vector<UnitTestCase> & theCases )
+{
+    WorkStatus_t status = WS_OK;
+    unsigned line_number = 1;
+
+    while ( status == WS_OK )
+    {
+        status = SkipCommentLines( theInputStream, line_number );
+
+        if ( status == WS_OK )
+        {
+            UnitTestCase test_case;
+            test_case.myLineNumber = line_number;
+
+            status = ReadTaggedString( theInputStream, test_case.myInput,
+                                       line_number, true, true, true );
+
+            if ( status == WS_OK )
+            {
+                status = ReadTaggedString( theInputStream,
+                                           test_case.myExpected,
+                                           line_number, true, true, true );
+
+                if ( ( status == WS_OK || !test_case.myExpected.empty() ) &&
+                     theCmdLine.LineIsSelected( test_case.myLineNumber ) )
+                {
+                    theCases.push_back( test_case );
+                }
+            }
+        }
+    }
+}
+
+
+// A worker thread of RunUnitTests: takes the next case of theRun which
+// no worker has taken yet, and runs it, until there are none left.
+static void RunUnitTestCases( UnitTestRun & theRun )
+{
+    WorkPool work_pool( theRun.myProgram, theRun.myIsVerbose,
+                        theRun.myDebugToConsole );
+    TaggedString output_string;
+    ofstream * dbg_ptr = theRun.myDebug;
+
+    for ( size_t i = theRun.myNextCase++; i < theRun.myCases.size();
+          i = theRun.myNextCase++ )
+    {
+        const UnitTestCase & test_case = theRun.myCases[i];
+        UnitTestResult & result = theRun.myResults[i];
+
+        if ( dbg_ptr != 0 )
+        {
+            DebugWriteInputString( *dbg_ptr, test_case.myInput,
+                                   test_case.myLineNumber );
+        }
+
+        Work & work = work_pool.Acquire();
+        chrono::steady_clock::time_point start = chrono::steady_clock::now();
+
+        result.myStatus = work.DoTransformations( test_case.myInput,
+                                                  output_string, dbg_ptr );
+
+        result.mySeconds = chrono::duration<double>(
+                               chrono::steady_clock::now() - start ).count();
+        result.myNumSteps = work.GetNumSteps();
+
+        work_pool.Release( work );
+
+        if ( dbg_ptr != 0 )
+        {
+            DebugWriteOutputString( *dbg_ptr, output_string );
+        }
+
+        if ( result.myStatus == WS_OK )
+        {
+            result.myStatus = CompareWithExpected( output_string,
+                                                   test_case.myExpected );
+
+            if ( result.myStatus != WS_OK && dbg_ptr != 0 )
+            {
+                DebugDoesntMatchExpected( *dbg_ptr, test_case.myInput,
+                                          output_string,
+                                          test_case.myExpected,
+                                          test_case.myLineNumber );
+            }
+        }
+
+        result.myLineNumber = test_case.myLineNumber;
+        result.myInput = TaggedStringText( test_case.myInput );
+        result.myOutput = TaggedStringText( output_string );
+        result.myExpected = TaggedStringText( test_case.myExpected );
+    }
+}
+
+
+// This performs the unit test mode for -tap and -junit.  Unlike RunSub,
+// it reads all the cases first, runs every one of them, spread over a
+// worker thread for each hardware thread, and then writes a report of
+// the results in the case order.  Returns the status of the first case
+// which didn't pass, or WS_OK.
+WorkStatus_t Driver::RunUnitTests( istream  & theInputStream,
+                                   ostream  & theOutputStream,
+                                   bool       theWriteToDebug,
+                                   bool       isVerbose,
+                                   bool       theDebugToConsole )
+{
+    WorkStatus_t status = WS_OK;
+    ofstream dbg;
+
+    if ( theWriteToDebug )
+    {
+        status = OpenDebugFile( dbg, myCmdLine.ThisProgramName() );
+
+        if ( status != WS_OK )
+        {
+            return status;
+        }
+    }
+
+    chrono::steady_clock::time_point start = chrono::steady_clock::now();
+    vector<UnitTestCase> cases;
+
+    ReadUnitTestCases( theInputStream, myCmdLine, cases );
+
+    vector<UnitTestResult> results( cases.size() );
+    UnitTestRun run = { myProgram, isVerbose, theDebugToConsole,
+                        theWriteToDebug ? &dbg : 0, cases, results, {0} };
+
+    // the debug log is written as each case is run, so when debugging
+    // the cases are run one at a time, in order
+    unsigned num_workers = thread::hardware_concurrency();
+
+    if ( num_workers == 0 || theWriteToDebug || theDebugToConsole )
+    {
+        num_workers = 1;
+    }
+
+    vector<thread> workers;
+
+    for ( unsigned i = 1; i < num_workers && i < cases.size(); i++ )
+    {
+        workers.push_back( thread( RunUnitTestCases, ref(run) ) );
+    }
+
+    RunUnitTestCases( run );
+
+    for ( size_t i = 0; i < workers.size(); i++ )
+    {
+        workers[i].join();
+    }
+
+    double seconds = chrono::duration<double>(
+                         chrono::steady_clock::now() - start ).count();
+
+    if ( SET_IN(myCmdLine.CmdFlags(), CMDFLGS_TAP) )
+    {
+        WriteTapReport( theOutputStream, results );
+    }
+    else
+    {
+        WriteJUnitReport( theOutputStream, results,
+                          myCmdLine.InputFileName(), seconds );
+    }
+
+    for ( size_t i = 0; i < results.size() && status == WS_OK; i++ )
+    {
+        status = results[i].myStatus;
+    }
+
+    return status;
+}
+
+
+// The reader thread of RunLines: splits theInputStream into lines,
+// and passes them to the workers in batches.  A ~ in a line is not
+// converted to a tagged ~, as it is not in full file mode.
+static void ReadLines( istream & theInputStream,
+                       LinePipeline & thePipeline )
+{
+    WorkStatus_t status = WS_OK;
+    unsigned line_number = 1;
+    LineBatch batch;
+
+    while ( status == WS_OK )
+    {
+        while ( status == WS_OK && batch.myLines.size() < LINES_PER_BATCH )
+        {
+            batch.myLines.push_back( TaggedString() );
+
+            status = ReadTaggedString( theInputStream, batch.myLines.back(),
+                                       line_number, true, false, false );
+
+            if ( status == WS_END_OF_FILE && batch.myLines.back().empty() )
+            {
+                batch.myLines.pop_back();
+            }
+        }
+
+        if ( !batch.myLines.empty() && !thePipeline.PushInput( batch ) )
+        {
+            break;
+        }
+    }
+
+    thePipeline.EndInput();
+}
+
+
+// A worker thread of RunLines: transforms the lines of each batch, and
+// writes them to its output text, with any tagged ~ written as ~ so each
+// line gives one output line.  Stops a batch at the first error, so
+// the writer can stop after writing the line which had it.
+static void TransformLines( const Program & theProgram,
+                            LinePipeline & thePipeline )
+{
+    WorkPool work_pool( theProgram, false, false );
+    LineBatch batch;
+    TaggedString output_string;
+
+    while ( thePipeline.PopInput( batch ) )
+    {
+        ostringstream out;
+
+        batch.myStatus = WS_OK;
+
+        for ( size_t i = 0; 
+              i < batch.myLines.size() && batch.myStatus == WS_OK; i++ )
+        {
+            Work & work = work_pool.Acquire();
+
+            batch.myStatus = work.DoTransformations( batch.myLines[i],
+                                                     output_string );
+
+            work_pool.Release( work );
+
+            WriteTaggedString( out, output_string, false );
+        }
+
+        batch.myOutput = out.str();
+
+        thePipeline.PushOutput( batch );
+    }
+}
+
+
+// This performs the lines mode when not debugging.  A reader thread
+// splits theInputStream into lines, a worker thread for each hardware
+// thread transforms them, each with its own WorkPool, and the calling
+// thread writes them to theOutputStream in the order they were read.
+WorkStatus_t Driver::RunLines( istream & theInputStream,
+                               ostream & theOutputStream )
+{
+    WorkStatus_t status = WS_OK;
+    unsigned num_workers = thread::hardware_concurrency();
+
+    if ( num_workers == 0 )
+    {
+        num_workers = 1;
+    }
+
+    LinePipeline pipeline( num_workers * BATCHES_PER_WORKER );
+    thread reader( ReadLines, ref(theInputStream), ref(pipeline) );
+    vector<thread> workers;
+
+    for ( unsigned i = 0; i < num_workers; i++ )
+    {
+        workers.push_back( thread( TransformLines, cref(myProgram),
+                                   ref(pipeline) ) );
+    }
+
+    LineBatch batch;
+
+    while ( status == WS_OK && pipeline.PopOutput( batch ) )
+    {
+        theOutputStream << batch.myOutput << flush;
+        status = batch.myStatus;
+    }
+
+    if ( status != WS_OK )
+    {
+        pipeline.Abort();
+    }
+
+    reader.join();
+
+    for ( size_t i = 0; i < workers.size(); i++ )
+    {
+        workers[i].join();
+    }
+
+    return status;
+}
+
+
 // Creates a new file with name immediate_filename which contains
 // the contents immediate_string.
 WorkStatus_t Driver::WriteImmediateFile( const char * immediate_filename,
@@ -487,7 +750,26 @@ WorkStatus_t Driver::Run()
         }
     }
 
-    if ( status == WS_OK )
+    // the debug log is written as each input is transformed, so when
+    // debugging the lines are transformed one at a time by RunSub
+    if ( status == WS_OK && myCmdLine.CmdMode() == CMDMODE_LINES &&
+         !myCmdLine.WriteToDebug() &&
+         !SET_IN(myCmdLine.CmdFlags(), CMDFLGS_VERBOSE) )
+    {
+        status = RunLines( myCmdLine.ReadFromStdin() ? cin : in, 
+                           myCmdLine.WriteToStdout() ? cout : out );
+    }
+    else if ( status == WS_OK && myCmdLine.CmdMode() == CMDMODE_UNIT_TEST &&
+              ( SET_IN(myCmdLine.CmdFlags(), CMDFLGS_TAP) ||
+                SET_IN(myCmdLine.CmdFlags(), CMDFLGS_JUNIT) ) )
+    {
+        status = RunUnitTests( myCmdLine.ReadFromStdin() ? cin : in, 
+                               myCmdLine.WriteToStdout() ? cout : out, 
+                               myCmdLine.WriteToDebug(),
+                               SET_IN(myCmdLine.CmdFlags(), CMDFLGS_VERBOSE),
+                               SET_IN(myCmdLine.CmdFlags(), CMDFLGS_CONSOLE) ); 
+    }
+    else if ( status == WS_OK )
     {
         status = RunSub( myCmdLine.ReadFromStdin() ? cin : in, 
                          myCmdLine.WriteToStdout() ? cout : out, 
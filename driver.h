@@ -9,6 +9,10 @@
 //      or in unit test mode where it reads a line and process it, then compares
 //      result with the next line from the input file, and reports an error
 //      if they don't match.
+//      With -tap or -junit, unit test mode runs every case, in parallel,
+//      and reports the results in that format.
+//      In lines mode each line is transformed separately by a pool of
+//      worker threads, and the output lines are written in input order.
 //      If there are errors opening the input or output files or creating the
 //      immediate file, writes an error message to cerr as well as returning
 //      an error status, so it can specify the name of the file.
@@ -16,6 +20,8 @@
 // HISTORY:
 //      14-DEC-12   D.Brown     Created
 //      26-DEC-12   D.Brown     Added immediate command mode
+//      17-OCT-26   D.Brown     Added lines command mode
+//      17-OCT-26   D.Brown     Run unit tests in parallel for -tap and -junit
 
 #ifndef DRIVER_H
 #define DRIVER_H
@@ -57,6 +63,15 @@ private:
                          bool            isVerbose,
                          bool            theDebugToConsole );
 
+    WorkStatus_t RunUnitTests( std::istream  & theInputStream,
+                               std::ostream  & theOutputStream,
+                               bool            theWriteToDebug,
+                               bool            isVerbose,
+                               bool            theDebugToConsole );
+
+    WorkStatus_t RunLines( std::istream  & theInputStream,
+                           std::ostream  & theOutputStream );
+
 
 private:
     const CmdLine & myCmdLine;
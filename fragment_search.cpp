@@ -0,0 +1,236 @@
+// FILE: fragment_search.cpp
+//
+// DESCRIPTION:
+//      Implements module described in fragment_search.h
+//
+// HISTORY:
+//      17-OCT-26   D.Brown     Created
+
+#include "fragment_search.h"
+#include <string.h>
+#include <assert.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define FRAGMENT_SEARCH_X86
+#include <immintrin.h>
+#endif
+
+
+using namespace std;
+
+
+typedef int (*SearchKernel_t)( const TaggedChar_t * theStr,
+                               int theStrLen,
+                               int theStartIx,
+                               const TaggedChar_t * theFrag,
+                               int theFragLen );
+
+
+
+// true if the middle of the fragment (all but the first and last
+// chars, which have already been compared) matches at theStr
+static inline bool MiddleMatches( const TaggedChar_t * theStr,
+                                  const TaggedChar_t * theFrag,
+                                  int theFragLen )
+{
+    return memcmp( theStr + 1, theFrag + 1, theFragLen - 2 ) == 0;
+}
+
+
+
+static int FindFragmentScalar( const TaggedChar_t * theStr,
+                               int theStrLen,
+                               int theStartIx,
+                               const TaggedChar_t * theFrag,
+                               int theFragLen )
+{
+    TaggedChar_t first = theFrag[0];
+    TaggedChar_t last = theFrag[theFragLen-1];
+
+    for ( int i = theStartIx; i + theFragLen <= theStrLen; i++ )
+    {
+        if ( theStr[i] == first &&
+             theStr[i+theFragLen-1] == last &&
+             MiddleMatches( theStr + i, theFrag, theFragLen ) )
+        {
+            return i;
+        }
+    }
+
+    return -1;
+}
+
+
+
+#ifdef FRAGMENT_SEARCH_X86
+
+// Each kernel compares a block of positions at a time, and leaves
+// the positions after the last full block to FindFragmentScalar.
+
+__attribute__((target("sse2")))
+static int FindFragmentSSE2( const TaggedChar_t * theStr,
+                             int theStrLen,
+                             int theStartIx,
+                             const TaggedChar_t * theFrag,
+                             int theFragLen )
+{
+    const int block = 16;
+    __m128i first = _mm_set1_epi8( (char)theFrag[0] );
+    __m128i last = _mm_set1_epi8( (char)theFrag[theFragLen-1] );
+    int i = theStartIx;
+
+    for ( ; i + theFragLen - 1 + block <= theStrLen; i += block )
+    {
+        __m128i at_first =
+            _mm_loadu_si128( (const __m128i *)(theStr + i) );
+        __m128i at_last =
+            _mm_loadu_si128( (const __m128i *)(theStr + i + theFragLen - 1) );
+        unsigned mask = (unsigned)_mm_movemask_epi8(
+                            _mm_and_si128( _mm_cmpeq_epi8( at_first, first ),
+                                           _mm_cmpeq_epi8( at_last, last ) ) );
+
+        for ( ; mask != 0; mask &= mask - 1 )
+        {
+            int pos = i + __builtin_ctz( mask );
+
+            if ( MiddleMatches( theStr + pos, theFrag, theFragLen ) )
+            {
+                return pos;
+            }
+        }
+    }
+
+    return FindFragmentScalar( theStr, theStrLen, i, theFrag, theFragLen );
+}
+
+
+
+__attribute__((target("avx2")))
+static int FindFragmentAVX2( const TaggedChar_t * theStr,
+                             int theStrLen,
+                             int theStartIx,
+                             const TaggedChar_t * theFrag,
+                             int theFragLen )
+{
+    const int block = 32;
+    __m256i first = _mm256_set1_epi8( (char)theFrag[0] );
+    __m256i last = _mm256_set1_epi8( (char)theFrag[theFragLen-1] );
+    int i = theStartIx;
+
+    for ( ; i + theFragLen - 1 + block <= theStrLen; i += block )
+    {
+        __m256i at_first =
+            _mm256_loadu_si256( (const __m256i *)(theStr + i) );
+        __m256i at_last =
+            _mm256_loadu_si256( (const __m256i *)(theStr + i + theFragLen - 1) );
+        unsigned mask = (unsigned)_mm256_movemask_epi8(
+                    _mm256_and_si256( _mm256_cmpeq_epi8( at_first, first ),
+                                      _mm256_cmpeq_epi8( at_last, last ) ) );
+
+        for ( ; mask != 0; mask &= mask - 1 )
+        {
+            int pos = i + __builtin_ctz( mask );
+
+            if ( MiddleMatches( theStr + pos, theFrag, theFragLen ) )
+            {
+                return pos;
+            }
+        }
+    }
+
+    return FindFragmentScalar( theStr, theStrLen, i, theFrag, theFragLen );
+}
+
+
+
+__attribute__((target("avx512bw")))
+static int FindFragmentAVX512( const TaggedChar_t * theStr,
+                               int theStrLen,
+                               int theStartIx,
+                               const TaggedChar_t * theFrag,
+                               int theFragLen )
+{
+    const int block = 64;
+    __m512i first = _mm512_set1_epi8( (char)theFrag[0] );
+    __m512i last = _mm512_set1_epi8( (char)theFrag[theFragLen-1] );
+    int i = theStartIx;
+
+    for ( ; i + theFragLen - 1 + block <= theStrLen; i += block )
+    {
+        __m512i at_first =
+            _mm512_loadu_si512( (const void *)(theStr + i) );
+        __m512i at_last =
+            _mm512_loadu_si512( (const void *)(theStr + i + theFragLen - 1) );
+        unsigned long long mask =
+                    _mm512_cmpeq_epi8_mask( at_first, first ) &
+                    _mm512_cmpeq_epi8_mask( at_last, last );
+
+        for ( ; mask != 0; mask &= mask - 1 )
+        {
+            int pos = i + __builtin_ctzll( mask );
+
+            if ( MiddleMatches( theStr + pos, theFrag, theFragLen ) )
+            {
+                return pos;
+            }
+        }
+    }
+
+    return FindFragmentScalar( theStr, theStrLen, i, theFrag, theFragLen );
+}
+
+#endif // FRAGMENT_SEARCH_X86
+
+
+
+static SearchKernel_t ChooseKernel()
+{
+#ifdef FRAGMENT_SEARCH_X86
+    __builtin_cpu_init();
+
+    if ( __builtin_cpu_supports( "avx512bw" ) )
+    {
+        return FindFragmentAVX512;
+    }
+
+    if ( __builtin_cpu_supports( "avx2" ) )
+    {
+        return FindFragmentAVX2;
+    }
+
+    if ( __builtin_cpu_supports( "sse2" ) )
+    {
+        return FindFragmentSSE2;
+    }
+#endif
+
+    return FindFragmentScalar;
+}
+
+
+
+int FindFragment( const TaggedChar_t * theStr,
+                  int theStrLen,
+                  int theStartIx,
+                  const TaggedChar_t * theFrag,
+                  int theFragLen )
+{
+    static const SearchKernel_t kernel = ChooseKernel();
+
+    assert( theStartIx >= 0 && theFragLen > 0 );
+
+    if ( theStartIx + theFragLen > theStrLen )
+    {
+        return -1;
+    }
+
+    if ( theFragLen == 1 )
+    {
+        const void * p = memchr( theStr + theStartIx, theFrag[0],
+                                 theStrLen - theStartIx );
+
+        return p == 0 ? -1 : (int)((const TaggedChar_t *)p - theStr);
+    }
+
+    return kernel( theStr, theStrLen, theStartIx, theFrag, theFragLen );
+}
@@ -0,0 +1,40 @@
+// FILE: fragment_search.h
+//
+// DESCRIPTION:
+//      Defines FindFragment, which finds the first occurrence of a
+//      fragment of tagged chars in a string.
+//
+//      The search compares the first and the last char of the fragment
+//      with many positions of the string at once, and only compares the
+//      rest of the fragment at positions where both of those match.
+//      On x86 processors the kernel is picked the first time FindFragment
+//      is called, from what the processor supports: AVX-512 (64 positions
+//      per compare), AVX2 (32 positions) or SSE2 (16 positions).  On other
+//      processors, or if the compiler is not g++ compatible, plain C++
+//      is used.
+//
+// HISTORY:
+//      17-OCT-26   D.Brown     Created
+
+#ifndef FRAGMENT_SEARCH_H
+#define FRAGMENT_SEARCH_H
+
+
+#include "tagged_char.h"
+
+
+// Fragments shorter than this are not worth searching for with
+// FindFragment; the first char alone is as good a filter.
+#define MIN_SEARCH_FRAGMENT_LEN 2
+
+
+// Returns the first index >= theStartIx in theStr (which has theStrLen
+// chars) where the theFragLen chars of theFrag occur, or -1 if none.
+int FindFragment( const TaggedChar_t * theStr,
+                  int theStrLen,
+                  int theStartIx,
+                  const TaggedChar_t * theFrag,
+                  int theFragLen );
+
+
+#endif // FRAGMENT_SEARCH_H
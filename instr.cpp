@@ -5,15 +5,28 @@
 //
 // HISTORY:
 //      14-DEC-12   D.Brown     Created
+//      17-OCT-26   D.Brown     Store compiled Pattern
+//      17-OCT-26   D.Brown     Store compiled Replacement
+//      17-OCT-26   D.Brown     Bind a ShapeMatcher to the pattern
+//      17-OCT-26   D.Brown     Added native matcher for markovc
+//      17-OCT-26   D.Brown     Compile the pattern to a PatternCode
+//      17-OCT-26   D.Brown     Read a program from any stream
+//      17-OCT-26   D.Brown     Program holds the shared PrefilterTable
+//      17-OCT-26   D.Brown     A new Program is prepared, with no instructions
 
 #include "instr.h"
 #include "tagged_char.h"
+#include "pattern.h"
+#include "replacement.h"
+#include "shape_matcher.h"
+#include "prefilter.h"
 #include "misc.h"
 #include <vector>
 #include <bitset>
 #include <iostream>
 #include <fstream>
 #include <iomanip>
+#include <assert.h>
 
 
 using namespace std;
@@ -27,7 +40,8 @@ static const char * g_TransitionStr = "->";
 
 
 Instr::Instr() :
-    myLineNumber( 0 )
+    myLineNumber( 0 ),
+    myNativeMatchFn( 0 )
 {
 }
 
@@ -52,6 +66,9 @@ const Instr & Instr::operator = ( const Instr & theOther )
 
     myPattern = theOther.myPattern;
     myPatternCharsUsed = theOther.myPatternCharsUsed;
+    myShapeMatcher = theOther.myShapeMatcher;
+    myPatternCode = theOther.myPatternCode;
+    myNativeMatchFn = theOther.myNativeMatchFn;
 
     myReplacement = theOther.myReplacement;
 
@@ -76,16 +93,21 @@ unsigned Instr::GetLineNumber() const
 
 const TaggedString & Instr::GetPatternStr() const
 {
-    return myPattern;
+    return myPattern.GetStr();
 }
 
 
 
-// Set myPattern to ts
-// Also set myPatternCharsUsed to all chars in ts other than wildcard chars.
+// Compile ts into myPattern
+// Also set myPatternCharsUsed to all chars in ts other than wildcard chars,
+// bind myShapeMatcher to the pattern and compile it to myPatternCode.
+// A native matcher for the previous pattern no longer applies.
 void Instr::PutPatternStr( const TaggedString & ts )
 {
-    myPattern = ts;
+    myPattern.Compile( ts );
+    myShapeMatcher.Bind( myPattern );
+    myPatternCode.Compile( myPattern );
+    myNativeMatchFn = 0;
 
     myPatternCharsUsed.reset();
 
@@ -104,16 +126,58 @@ void Instr::PutPatternStr( const TaggedString & ts )
 
 
 
+const Pattern & Instr::GetPattern() const
+{
+    return myPattern;
+}
+
+
+
+const ShapeMatcher & Instr::GetShapeMatcher() const
+{
+    return myShapeMatcher;
+}
+
+
+
+const PatternCode & Instr::GetPatternCode() const
+{
+    return myPatternCode;
+}
+
+
+
+void Instr::SetNativeMatcher( NativeMatchFn_t theMatchFn )
+{
+    myNativeMatchFn = theMatchFn;
+}
+
+
+
+NativeMatchFn_t Instr::GetNativeMatcher() const
+{
+    return myNativeMatchFn;
+}
+
+
+
 const TaggedString & Instr::GetReplacementStr() const
 {
-    return myReplacement;
+    return myReplacement.GetStr();
 }
 
 
 
 void Instr::PutReplacementStr( const TaggedString & ts )
 {
-    myReplacement = ts;
+    myReplacement.Compile( ts );
+}
+
+
+
+const Replacement & Instr::GetReplacement() const
+{
+    return myReplacement;
 }
 
 
@@ -129,14 +193,14 @@ void Instr::Print( ostream & out,
                    const char * margin ) const
 {
     out << margin << setw(6) <<  myLineNumber << ": ";
-    PrintTaggedString( out, myPattern );
+    PrintTaggedString( out, myPattern.GetStr() );
     out << " " << g_TransitionStr << " ";
-    PrintTaggedString( out, myReplacement );
+    PrintTaggedString( out, myReplacement.GetStr() );
     out << endl;
 }
 
 
-static char ReadAndSkipWhiteSpace( ifstream & thePgmFile,
+static char ReadAndSkipWhiteSpace( istream & thePgmFile,
                                   unsigned & theLineNumber )
 {
     char c;
@@ -182,7 +246,7 @@ static char ReadAndSkipWhiteSpace( ifstream & thePgmFile,
 // reads a string beginning with delimiter theDelimiter
 // and stores it in theStr.
 // returns true = ok, false = error
-static bool ReadTaggedString( ifstream & thePgmFile,
+static bool ReadTaggedString( istream & thePgmFile,
                               TaggedString & theStr,
                               unsigned & theLineNumber,
                               char theDelimiter )
@@ -238,11 +302,12 @@ static bool ReadTaggedString( ifstream & thePgmFile,
 
 // Reads an instruction: <pattern_string> '->' <replacement_string>
 // Returns true if ok, false if error (end-of-file returns true).
-// On error, also prints an error msg to stderr
+// On error, also prints an error msg to theErrors
 static bool ReadAndAppendInstr( Program & theProgram,
-                                ifstream & thePgmFile,
+                                istream & thePgmFile,
                                 unsigned & theLineNumber,
-                                const char * theFileName )
+                                const char * theFileName,
+                                ostream & theErrors )
 {
     bool done = false;
     bool ok = true;
@@ -319,7 +384,7 @@ static bool ReadAndAppendInstr( Program & theProgram,
 
     if ( !ok )
     {
-        cerr << "ERROR: Syntax error at line " << theLineNumber << 
+        theErrors << "ERROR: Syntax error at line " << theLineNumber << 
                 " of program file" << endl << 
                 ". " << theFileName << endl <<
                 ". " << errinfo << endl;
@@ -330,30 +395,96 @@ static bool ReadAndAppendInstr( Program & theProgram,
 
 
 
+Program::Program() :
+    myPrefilter( 0 )
+{
+    Prepare();
+}
+
+
+
+Program::~Program()
+{
+    delete myPrefilter;
+}
+
+
+
+Program::Program( const Program & theOther ) :
+    vector<Instr>( theOther ),
+    myPrefilter( 0 )
+{
+    Prepare();
+}
+
+
+
+const Program & Program::operator = ( const Program & theOther )
+{
+    if ( this != &theOther )
+    {
+        vector<Instr>::operator = ( theOther );
+
+        Prepare();
+    }
+
+    return *this;
+}
+
+
+
+void Program::Prepare()
+{
+    delete myPrefilter;
+    myPrefilter = 0;
+
+    myPrefilter = new PrefilterTable( *this, 0 );
+}
+
+
+
+const PrefilterTable & Program::GetPrefilter() const
+{
+    assert( myPrefilter != 0 );
+
+    return *myPrefilter;
+}
+
+
+
 bool ReadProgram( Program & theProgram,
                   const char * theProgramFileName )
 {
-    bool ok = true;
-
     ifstream in( theProgramFileName );
 
     if ( !in )
     {
         cerr << "ERROR: Unable to open program file '" << 
                  theProgramFileName << "'" << endl;
-        ok = false;
+        return false;
     }
-    else
-    {   
-        unsigned line_number = 1;
 
-        while ( ok && in )
-        {
-            ok = ReadAndAppendInstr( theProgram, in, line_number,
-                                     theProgramFileName );
-        }
+    return ReadProgram( theProgram, in, theProgramFileName, cerr );
+}
+
+
+
+bool ReadProgram( Program & theProgram,
+                  istream & theIn,
+                  const char * theProgramName,
+                  ostream & theErrors )
+{
+    bool ok = true;
+    unsigned line_number = 1;
+
+    while ( ok && theIn )
+    {
+        ok = ReadAndAppendInstr( theProgram, theIn, line_number,
+                                 theProgramName, theErrors );
     }
 
+    theProgram.Prepare();
+
     return ok;
 }
 
@@ -2,19 +2,42 @@
 //
 // DESCRIPTION:
 //      The Instr class contains a single transformation from the program.
-//      This file also defines a Program as a vector of Instr.
+//      This file also defines a Program as a vector of Instr, which
+//      also holds the tables built from all its instructions which every
+//      Work running the program shares, such as its PrefilterTable.
 //
 //      This module is also responsible for reading the program
 //      file and creating the vector of Instr objects, and for
 //      printing a program.
 //
+//      The pattern string is compiled into a Pattern when it is stored,
+//      so the pattern matcher can use the precomputed fragments and
+//      wildcard information.  Likewise the replacement string is compiled
+//      into a Replacement.  If the pattern has a shape with a specialized
+//      matcher, a ShapeMatcher is bound to it, and it is always compiled
+//      to a PatternCode for the PatternVM.  Programs compiled by markovc
+//      also give each instruction a native matcher.
+//
 // HISTORY:
 //      14-DEC-12   D.Brown     Created
+//      17-OCT-26   D.Brown     Store compiled Pattern
+//      17-OCT-26   D.Brown     Store compiled Replacement
+//      17-OCT-26   D.Brown     Bind a ShapeMatcher to the pattern
+//      17-OCT-26   D.Brown     Added native matcher for markovc
+//      17-OCT-26   D.Brown     Compile the pattern to a PatternCode
+//      17-OCT-26   D.Brown     Read a program from any stream
+//      17-OCT-26   D.Brown     Program holds the shared PrefilterTable
+//      17-OCT-26   D.Brown     A new Program is prepared, with no instructions
 
 #ifndef INSTR_H
 #define INSTR_H
 
 #include "tagged_char.h"
+#include "pattern.h"
+#include "replacement.h"
+#include "shape_matcher.h"
+#include "pattern_vm.h"
+#include "work_status.h"
 #include <vector>
 #include <bitset>
 #include <iostream>
@@ -22,6 +45,17 @@
 
 
 
+class WorkData;
+class PrefilterTable;
+
+
+// A matcher generated by markovc for one pattern.  It matches the From
+// String of theWorkData like the PatternVM, and returns WS_OK if
+// matched, or WS_NO_MATCH if not.
+typedef WorkStatus_t (*NativeMatchFn_t)( WorkData & theWorkData );
+
+
+
 class Instr
 {
 public:
@@ -41,10 +75,25 @@ public:
 
     void PutPatternStr( const TaggedString & ts );
 
+    const Pattern & GetPattern() const;
+
+    // the matcher for the shape of the pattern, may be unbound
+    const ShapeMatcher & GetShapeMatcher() const;
+
+    // the pattern compiled for the PatternVM
+    const PatternCode & GetPatternCode() const;
+
+    // the matcher compiled by markovc for the pattern, or 0 if none
+    void SetNativeMatcher( NativeMatchFn_t theMatchFn );
+
+    NativeMatchFn_t GetNativeMatcher() const;
+
     const TaggedString & GetReplacementStr() const;
 
     void PutReplacementStr( const TaggedString & ts );
 
+    const Replacement & GetReplacement() const;
+
     const std::bitset<TAGGED_CHAR_END> & GetPatternCharsUsed() const;
 
     void Print( std::ostream & out,
@@ -53,23 +102,55 @@ public:
 private:
     unsigned myLineNumber;                                  // line # in program file
 
-    TaggedString myPattern;
+    Pattern myPattern;                                      // compiled pattern
     std::bitset<TAGGED_CHAR_END> myPatternCharsUsed;        // excludes wildcards
+    ShapeMatcher myShapeMatcher;                            // bound to myPattern
+    PatternCode myPatternCode;                              // from myPattern
+    NativeMatchFn_t myNativeMatchFn;                        // 0 if none
 
-    TaggedString myReplacement;
+    Replacement myReplacement;                              // compiled replacement
 };
 
 
 
-typedef std::vector<Instr> Program;
+class Program : public std::vector<Instr>
+{
+public:
+    Program();
+
+    ~Program();
+
+    Program( const Program & theOther );
+
+    const Program & operator = ( const Program & theOther );
+
+    // Builds the tables shared by every Work running the program from the
+    // instructions.  Must be called after the instructions are changed,
+    // before the program is run.  ReadProgram calls it, and a new Program
+    // is prepared with no instructions.
+    void Prepare();
 
+    const PrefilterTable & GetPrefilter() const;
+
+private:
+    PrefilterTable * myPrefilter;                           // never 0
+};
 
 
-// reads a program, storing the instructions in theProgram.
-// returns true = ok, false = error.
+
+// reads a program, storing the instructions in theProgram, and
+// prepares it.  returns true = ok, false = error.
 bool ReadProgram( Program & theProgram,
                   const char * theProgramFileName );
 
+// reads a program from theIn, such as an istringstream holding the
+// program text.  Syntax errors are written to theErrors, naming the
+// program theProgramName.  returns true = ok, false = error.
+bool ReadProgram( Program & theProgram,
+                  std::istream & theIn,
+                  const char * theProgramName,
+                  std::ostream & theErrors );
+
 
 // write the program to a file, or if theOutFileName = 0, to stdout
 void PrintProgram( const Program & theProgram,
@@ -0,0 +1,221 @@
+// FILE: libmarkov.cpp
+//
+// DESCRIPTION:
+//      Implements module described in libmarkov.h
+//
+//      No exception may pass into C code, so each function which can
+//      allocate catches them, and returns WS_ERROR_OUT_OF_MEMORY or 0.
+//
+// HISTORY:
+//      17-OCT-26   D.Brown     Created
+
+#include "libmarkov.h"
+#include "markov_engine.h"
+#include "work_status.h"
+#include <stdlib.h>
+#include <string.h>
+
+
+using namespace std;
+
+
+static_assert( MARKOV_OK == WS_OK, "MARKOV_OK must be WS_OK" );
+
+
+struct markov_program
+{
+    MarkovProgram myProgram;
+};
+
+
+struct markov_engine
+{
+    markov_engine( const MarkovProgram & theProgram ) :
+        myEngine( theProgram )
+    {
+    }
+
+    MarkovEngine myEngine;
+};
+
+
+
+// copies theStr to a new buffer for markov_free, ending with a 0.
+// returns false if out of memory.
+static bool CopyOutput( const string & theStr,
+                        char ** theOutput,
+                        size_t * theOutputLength )
+{
+    char * buf = (char *)malloc( theStr.size() + 1 );
+
+    if ( buf == 0 )
+    {
+        *theOutput = 0;
+        *theOutputLength = 0;
+        return false;
+    }
+
+    memcpy( buf, theStr.data(), theStr.size() );
+    buf[theStr.size()] = 0;
+
+    *theOutput = buf;
+    *theOutputLength = theStr.size();
+
+    return true;
+}
+
+
+
+markov_program * markov_program_new( void )
+{
+    try
+    {
+        return new markov_program;
+    }
+    catch ( ... )
+    {
+        return 0;
+    }
+}
+
+
+
+void markov_program_free( markov_program * program )
+{
+    delete program;
+}
+
+
+
+int markov_program_load( markov_program * program,
+                         const char * text,
+                         size_t length )
+{
+    try
+    {
+        return program->myProgram.Load( text, length );
+    }
+    catch ( ... )
+    {
+        return WS_ERROR_OUT_OF_MEMORY;
+    }
+}
+
+
+
+int markov_program_load_file( markov_program * program,
+                              const char * filename )
+{
+    try
+    {
+        return program->myProgram.LoadFile( filename );
+    }
+    catch ( ... )
+    {
+        return WS_ERROR_OUT_OF_MEMORY;
+    }
+}
+
+
+
+const char * markov_program_error( const markov_program * program )
+{
+    return program->myProgram.GetError().c_str();
+}
+
+
+
+markov_engine * markov_engine_new( const markov_program * program )
+{
+    try
+    {
+        return new markov_engine( program->myProgram );
+    }
+    catch ( ... )
+    {
+        return 0;
+    }
+}
+
+
+
+void markov_engine_free( markov_engine * engine )
+{
+    delete engine;
+}
+
+
+
+int markov_transform( markov_engine * engine,
+                      const char * input,
+                      size_t input_length,
+                      char ** output,
+                      size_t * output_length )
+{
+    try
+    {
+        string out;
+
+        WorkStatus_t status = engine->myEngine.Transform( input,
+                                                          input_length,
+                                                          out );
+
+        if ( !CopyOutput( out, output, output_length ) )
+        {
+            status = WS_ERROR_OUT_OF_MEMORY;
+        }
+
+        return status;
+    }
+    catch ( ... )
+    {
+        *output = 0;
+        *output_length = 0;
+        return WS_ERROR_OUT_OF_MEMORY;
+    }
+}
+
+
+
+int markov_transform_batch( markov_engine * engine,
+                            size_t count,
+                            const char * const * inputs,
+                            const size_t * input_lengths,
+                            char ** outputs,
+                            size_t * output_lengths,
+                            int * statuses )
+{
+    int first_error = MARKOV_OK;
+
+    for ( size_t i = 0; i < count; i++ )
+    {
+        int status = markov_transform( engine, inputs[i], input_lengths[i],
+                                       &outputs[i], &output_lengths[i] );
+
+        if ( statuses != 0 )
+        {
+            statuses[i] = status;
+        }
+
+        if ( first_error == MARKOV_OK )
+        {
+            first_error = status;
+        }
+    }
+
+    return first_error;
+}
+
+
+
+void markov_free( char * output )
+{
+    free( output );
+}
+
+
+
+const char * markov_status_str( int status )
+{
+    return GetWorkStatusStr( (WorkStatus_t)status );
+}
@@ -0,0 +1,93 @@
+/* FILE: libmarkov.h
+ *
+ * DESCRIPTION:
+ *      The C interface of libmarkov, a thin layer over MarkovProgram and
+ *      MarkovEngine (see markov_engine.h).  It can be used from C or any
+ *      language with a C foreign function interface.
+ *
+ *      The program and engine are opaque handles.  Functions which can
+ *      fail return MARKOV_OK or a nonzero status, which is one of the
+ *      WorkStatus_t codes of work_status.h; markov_status_str names it.
+ *      Output buffers are allocated by the library, end with a 0 which
+ *      isn't counted in their length, and are freed with markov_free.
+ *
+ *      As for the classes, a program can be shared by the engines of
+ *      any number of threads, but each engine is used by one thread.
+ *
+ * HISTORY:
+ *      17-OCT-26   D.Brown     Created
+ */
+
+#ifndef LIBMARKOV_H
+#define LIBMARKOV_H
+
+#include <stddef.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+
+#define MARKOV_OK 0
+
+
+typedef struct markov_program markov_program;
+typedef struct markov_engine markov_engine;
+
+
+/* Returns a new program with no instructions, or 0 if out of memory. */
+markov_program * markov_program_new( void );
+
+void markov_program_free( markov_program * program );
+
+/* Reads the program from length chars of the source text. */
+int markov_program_load( markov_program * program,
+                         const char * text,
+                         size_t length );
+
+/* Reads the program from a program file. */
+int markov_program_load_file( markov_program * program,
+                              const char * filename );
+
+/* The error messages of the last load, "" if none. */
+const char * markov_program_error( const markov_program * program );
+
+
+/* Returns a new engine for program, or 0 if out of memory.  The program
+ * must not be freed or loaded again until the engine is freed. */
+markov_engine * markov_engine_new( const markov_program * program );
+
+void markov_engine_free( markov_engine * engine );
+
+/* Transforms input_length chars of input, text as in an input file of
+ * markov, and sets *output to the text markov would write for it.  The
+ * output is set even if the transformation returns an error. */
+int markov_transform( markov_engine * engine,
+                      const char * input,
+                      size_t input_length,
+                      char ** output,
+                      size_t * output_length );
+
+/* Transforms count inputs, as markov_transform, continuing after any
+ * errors.  statuses may be 0, otherwise it gets the status of each.
+ * Returns the first status which isn't MARKOV_OK, or MARKOV_OK. */
+int markov_transform_batch( markov_engine * engine,
+                            size_t count,
+                            const char * const * inputs,
+                            const size_t * input_lengths,
+                            char ** outputs,
+                            size_t * output_lengths,
+                            int * statuses );
+
+/* Frees an output of markov_transform or markov_transform_batch. */
+void markov_free( char * output );
+
+/* Returns the name of a status, such as "ERROR_NO_MATCHING_XFORMS". */
+const char * markov_status_str( int status );
+
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif /* LIBMARKOV_H */
@@ -0,0 +1,197 @@
+/* FILE: libmarkov_test.c
+ *
+ * DESCRIPTION:
+ *      A test of the C interface of libmarkov, run by make check.
+ *
+ *      Syntax: libmarkov_test [<program_file> <input> ...]
+ *
+ *      Loads the program file, and transforms each input, then all of
+ *      them again as one batch.  For each transform it writes what
+ *      "markov <program_file> -i <input>" writes: the output text to
+ *      stdout, then the error, if any, to stderr.  With no program file,
+ *      transforms "abc" with a new program, which has no instructions,
+ *      as "markov /dev/null -i abc" does.
+ *
+ *      It also checks that loading a program with a syntax error fails,
+ *      with an error message.  It writes nothing more unless a check
+ *      fails, when it returns 1.
+ *
+ * HISTORY:
+ *      17-OCT-26   D.Brown     Created
+ *      17-OCT-26   D.Brown     Test a program file, a batch and a syntax
+ *                              error
+ */
+
+#include "libmarkov.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+
+/* Writes output and status as markov -i does, and frees output. */
+static void WriteResult( char * output,
+                         size_t output_length,
+                         int status )
+{
+    if ( output != 0 )
+    {
+        fwrite( output, 1, output_length, stdout );
+        markov_free( output );
+    }
+
+    fflush( stdout );
+
+    if ( status != MARKOV_OK )
+    {
+        fprintf( stderr, "Driver returns error %s\n",
+                 markov_status_str( status ) );
+    }
+}
+
+
+
+/* Transforms each of the count inputs one at a time, then as a batch,
+ * writing the results of each.  Returns 0 if the batch returns the first
+ * error of the inputs. */
+static int TransformInputs( markov_engine * engine,
+                            size_t count,
+                            const char * const * inputs )
+{
+    size_t * lengths = calloc( count + 1, sizeof(size_t) );
+    char ** outputs = calloc( count + 1, sizeof(char *) );
+    size_t * output_lengths = calloc( count + 1, sizeof(size_t) );
+    int * statuses = calloc( count + 1, sizeof(int) );
+    int first_error = MARKOV_OK;
+    int batch_status = MARKOV_OK;
+    size_t i;
+
+    if ( lengths == 0 || outputs == 0 || output_lengths == 0 ||
+         statuses == 0 )
+    {
+        fprintf( stderr, "ERROR: out of memory\n" );
+        free( lengths );
+        free( outputs );
+        free( output_lengths );
+        free( statuses );
+        return 1;
+    }
+
+    for ( i = 0; i < count; i++ )
+    {
+        lengths[i] = strlen( inputs[i] );
+
+        statuses[i] = markov_transform( engine, inputs[i], lengths[i],
+                                        &outputs[i], &output_lengths[i] );
+
+        WriteResult( outputs[i], output_lengths[i], statuses[i] );
+
+        if ( first_error == MARKOV_OK )
+        {
+            first_error = statuses[i];
+        }
+    }
+
+    batch_status = markov_transform_batch( engine, count, inputs, lengths,
+                                           outputs, output_lengths,
+                                           statuses );
+
+    for ( i = 0; i < count; i++ )
+    {
+        WriteResult( outputs[i], output_lengths[i], statuses[i] );
+    }
+
+    free( lengths );
+    free( outputs );
+    free( output_lengths );
+    free( statuses );
+
+    if ( batch_status != first_error )
+    {
+        fprintf( stderr, "FAILED: batch returns %s, not %s\n",
+                 markov_status_str( batch_status ),
+                 markov_status_str( first_error ) );
+        return 1;
+    }
+
+    return 0;
+}
+
+
+
+/* Returns 0 if loading a program with a syntax error fails as it should. */
+static int CheckSyntaxError( void )
+{
+    static const char text[] = "\"*\" -> \"a[*]\"\n\"a[*]\" ->\n";
+    markov_program * program = markov_program_new();
+    int failed = 1;
+
+    if ( program != 0 )
+    {
+        int status = markov_program_load( program, text, strlen( text ) );
+
+        failed = status == MARKOV_OK ||
+                 strcmp( markov_status_str( status ),
+                         "ERROR_PROGRAM_SYNTAX" ) != 0 ||
+                 markov_program_error( program )[0] == 0;
+
+        markov_program_free( program );
+    }
+
+    if ( failed )
+    {
+        fprintf( stderr, "FAILED: a syntax error doesn't fail the load\n" );
+    }
+
+    return failed;
+}
+
+
+
+int main( int argc,
+          char * argv[] )
+{
+    static const char * const empty_inputs[] = { "abc" };
+    markov_program * program = markov_program_new();
+    markov_engine * engine = 0;
+    int failed = 0;
+
+    if ( program == 0 )
+    {
+        fprintf( stderr, "ERROR: out of memory\n" );
+        return 1;
+    }
+
+    if ( argc > 1 &&
+         markov_program_load_file( program, argv[1] ) != MARKOV_OK )
+    {
+        fprintf( stderr, "%s", markov_program_error( program ) );
+        markov_program_free( program );
+        return 1;
+    }
+
+    engine = markov_engine_new( program );
+
+    if ( engine == 0 )
+    {
+        fprintf( stderr, "ERROR: out of memory\n" );
+        markov_program_free( program );
+        return 1;
+    }
+
+    if ( argc > 1 )
+    {
+        failed |= TransformInputs( engine, argc - 2,
+                                   (const char * const *)argv + 2 );
+    }
+    else
+    {
+        failed |= TransformInputs( engine, 1, empty_inputs );
+    }
+
+    failed |= CheckSyntaxError();
+
+    markov_engine_free( engine );
+    markov_program_free( program );
+
+    return failed;
+}
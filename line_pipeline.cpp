@@ -0,0 +1,159 @@
+// FILE: line_pipeline.cpp
+//
+// DESCRIPTION:
+//      Implements module described in line_pipeline.h
+//
+// HISTORY:
+//      17-OCT-26   D.Brown     Created
+
+#include "line_pipeline.h"
+
+
+using namespace std;
+
+
+
+// moves theFrom to theTo, swapping the lines and output so they
+// aren't copied
+static void MoveBatch( LineBatch & theFrom,
+                       LineBatch & theTo )
+{
+    theTo.mySeq = theFrom.mySeq;
+    theTo.myLines.clear();
+    theTo.myLines.swap( theFrom.myLines );
+    theTo.myOutput.clear();
+    theTo.myOutput.swap( theFrom.myOutput );
+    theTo.myStatus = theFrom.myStatus;
+}
+
+
+
+LinePipeline::LinePipeline( size_t theMaxInFlight ) :
+    myMaxInFlight( theMaxInFlight > 0 ? theMaxInFlight : 1 ),
+    myNumRead( 0 ),
+    myNumWritten( 0 ),
+    myInputEnded( false ),
+    myAborted( false )
+{
+}
+
+
+
+LinePipeline::~LinePipeline()
+{
+}
+
+
+
+bool LinePipeline::PushInput( LineBatch & theBatch )
+{
+    unique_lock<mutex> lock( myMutex );
+
+    while ( !myAborted && myNumRead - myNumWritten >= myMaxInFlight )
+    {
+        myRoomReady.wait( lock );
+    }
+
+    if ( myAborted )
+    {
+        return false;
+    }
+
+    theBatch.mySeq = myNumRead++;
+    myInput.push_back( LineBatch() );
+    MoveBatch( theBatch, myInput.back() );
+    myInputReady.notify_one();
+
+    return true;
+}
+
+
+
+void LinePipeline::EndInput()
+{
+    lock_guard<mutex> lock( myMutex );
+
+    myInputEnded = true;
+    myInputReady.notify_all();
+    myOutputReady.notify_all();
+}
+
+
+
+bool LinePipeline::PopInput( LineBatch & theBatch )
+{
+    unique_lock<mutex> lock( myMutex );
+
+    while ( !myAborted && myInput.empty() && !myInputEnded )
+    {
+        myInputReady.wait( lock );
+    }
+
+    if ( myAborted || myInput.empty() )
+    {
+        return false;
+    }
+
+    MoveBatch( myInput.front(), theBatch );
+    myInput.pop_front();
+
+    return true;
+}
+
+
+
+void LinePipeline::PushOutput( LineBatch & theBatch )
+{
+    lock_guard<mutex> lock( myMutex );
+
+    MoveBatch( theBatch, myOutput[theBatch.mySeq] );
+
+    if ( theBatch.mySeq == myNumWritten )
+    {
+        myOutputReady.notify_one();
+    }
+}
+
+
+
+bool LinePipeline::PopOutput( LineBatch & theBatch )
+{
+    unique_lock<mutex> lock( myMutex );
+    map<size_t, LineBatch>::iterator next;
+
+    for ( ;; )
+    {
+        next = myOutput.find( myNumWritten );
+
+        if ( next != myOutput.end() )
+        {
+            break;
+        }
+
+        if ( myAborted || ( myInputEnded && myNumWritten == myNumRead ) )
+        {
+            return false;
+        }
+
+        myOutputReady.wait( lock );
+    }
+
+    MoveBatch( next->second, theBatch );
+    myOutput.erase( next );
+    myNumWritten++;
+    myRoomReady.notify_one();
+
+    return true;
+}
+
+
+
+void LinePipeline::Abort()
+{
+    lock_guard<mutex> lock( myMutex );
+
+    myAborted = true;
+    myInputReady.notify_all();
+    myOutputReady.notify_all();
+    myRoomReady.notify_all();
+}
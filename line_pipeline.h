@@ -0,0 +1,98 @@
+// FILE: line_pipeline.h
+//
+// DESCRIPTION:
+//      Defines class LinePipeline, which passes batches of lines between
+//      the threads of the -lines mode (see Driver::RunLines):
+//          - the reader thread splits the input into lines, and calls
+//            PushInput for each batch of them,
+//          - each worker thread calls PopInput for a batch, transforms
+//            its lines, writes them to the batch's output text and calls
+//            PushOutput,
+//          - the writer calls PopOutput, which returns the batches in
+//            the order they were read, holding back any which were
+//            finished early in a reorder buffer.
+//
+//      The reader waits while theMaxInFlight batches have been read but
+//      not yet written, so the memory used doesn't grow with the input
+//      when the workers or the writer fall behind.
+//
+//      When the writer finds an error it calls Abort, after which the
+//      reader and the workers stop at their next call.
+//
+// HISTORY:
+//      17-OCT-26   D.Brown     Created
+
+#ifndef LINE_PIPELINE_H
+#define LINE_PIPELINE_H
+
+
+#include "tagged_char.h"
+#include "work_status.h"
+#include <vector>
+#include <string>
+#include <deque>
+#include <map>
+#include <mutex>
+#include <condition_variable>
+
+
+struct LineBatch
+{
+    size_t mySeq;                       // number of the batch in the input
+    std::vector<TaggedString> myLines;  // the input lines
+    std::string myOutput;               // output text of the lines done
+    WorkStatus_t myStatus;              // WS_OK, or error of last line done
+};
+
+
+class LinePipeline
+{
+public:
+    LinePipeline( size_t theMaxInFlight );
+
+    ~LinePipeline();
+
+private:
+    LinePipeline( const LinePipeline & theOther );
+
+    const LinePipeline & operator = ( const LinePipeline & theOther );
+
+public:
+    // Called by the reader: sets theBatch.mySeq and queues it for the
+    // workers, first waiting for room.  theBatch is left empty.
+    // Returns false if aborted.
+    bool PushInput( LineBatch & theBatch );
+
+    // Called by the reader after its last PushInput.
+    void EndInput();
+
+    // Called by a worker: waits for a batch and moves it to theBatch.
+    // Returns false once all the input has been taken, or if aborted.
+    bool PopInput( LineBatch & theBatch );
+
+    // Called by a worker: puts theBatch in the reorder buffer.
+    void PushOutput( LineBatch & theBatch );
+
+    // Called by the writer: waits for the next batch in input order
+    // and moves it to theBatch.  Returns false after the last batch.
+    bool PopOutput( LineBatch & theBatch );
+
+    // Stops the reader and the workers.
+    void Abort();
+
+private:
+    std::mutex myMutex;
+    std::condition_variable myInputReady;   // PopInput waits for this
+    std::condition_variable myOutputReady;  // PopOutput waits for this
+    std::condition_variable myRoomReady;    // PushInput waits for this
+    size_t myMaxInFlight;
+    size_t myNumRead;                       // batches pushed by the reader
+    size_t myNumWritten;                    // batches popped by the writer
+    bool myInputEnded;
+    bool myAborted;
+    std::deque<LineBatch> myInput;
+    std::map<size_t, LineBatch> myOutput;   // the reorder buffer, by mySeq
+};
+
+
+#endif // LINE_PIPELINE_H
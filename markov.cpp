@@ -7,7 +7,9 @@
 #include "instr.h"
 #include "driver.h"
 #include "work_status.h"
+#include "server.h"
 #include <vector>
+#include <deque>
 
 using namespace std;
 
@@ -17,6 +19,44 @@ using namespace std;
 
 
 
+// Serve mode: reads each program to serve, then answers requests until
+// stopped.  A deque keeps the programs in place as more are added.
+static int Serve( const CmdLine & theCmdLine )
+{
+    const vector<const char *> & filenames =
+        theCmdLine.ServedProgramFileNames();
+    deque<Program> programs;
+    Server server( theCmdLine.SocketName() );
+
+    for ( size_t i = 0; i < filenames.size(); i++ )
+    {
+        programs.push_back( Program() );
+
+        if ( !ReadProgram( programs.back(), filenames[i] ) )
+        {
+            return EXIT_ERROR;
+        }
+
+        if ( server.AddProgram( filenames[i], programs.back() ) != WS_OK )
+        {
+            return EXIT_ERROR;
+        }
+    }
+
+    WorkStatus_t ws = server.Run();
+
+    if ( ws != WS_OK )
+    {
+        cerr << "Server returns error " <<
+                 GetWorkStatusStr(ws) << endl;
+        return EXIT_ERROR;
+    }
+
+    return EXIT_OK;
+}
+
+
+
 int main(int argc, char* argv[])
 {
     CmdLine cmd_line;
@@ -37,7 +77,12 @@ int main(int argc, char* argv[])
         return EXIT_OK;
     }
 
-    vector<Instr> program;
+    if ( cmd_line.CmdMode() == CMDMODE_SERVE )
+    {
+        return Serve( cmd_line );
+    }
+
+    Program program;
 
     bool ok = ReadProgram( program, cmd_line.ProgramFileName() );
 
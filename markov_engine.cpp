@@ -0,0 +1,167 @@
+// FILE: markov_engine.cpp
+//
+// DESCRIPTION:
+//      Implements module described in markov_engine.h
+//
+// HISTORY:
+//      17-OCT-26   D.Brown     Created
+//      17-OCT-26   D.Brown     MarkovEngine can run a Program
+//      17-OCT-26   D.Brown     Prepare the Program when its file is missing
+
+#include "markov_engine.h"
+#include "work.h"
+#include "tagged_io.h"
+#include <sstream>
+#include <fstream>
+
+
+using namespace std;
+
+
+
+MarkovProgram::MarkovProgram()
+{
+}
+
+
+
+MarkovProgram::~MarkovProgram()
+{
+}
+
+
+
+WorkStatus_t MarkovProgram::Load( const char * theText,
+                                  size_t theLength,
+                                  const char * theName )
+{
+    istringstream in( string( theText, theLength ) );
+    ostringstream errors;
+
+    myProgram.clear();
+
+    bool ok = ReadProgram( myProgram, in, theName, errors );
+
+    myError = errors.str();
+
+    return ok ? WS_OK : WS_ERROR_PROGRAM_SYNTAX;
+}
+
+
+
+WorkStatus_t MarkovProgram::LoadFile( const char * theFileName )
+{
+    ifstream in( theFileName );
+
+    myProgram.clear();
+
+    if ( !in )
+    {
+        myProgram.Prepare();
+
+        myError = "ERROR: Unable to open program file '";
+        myError.append( theFileName );
+        myError.append( "'\n" );
+
+        return WS_ERROR_CANT_OPEN_PROGRAM_FILE;
+    }
+
+    ostringstream errors;
+
+    bool ok = ReadProgram( myProgram, in, theFileName, errors );
+
+    myError = errors.str();
+
+    return ok ? WS_OK : WS_ERROR_PROGRAM_SYNTAX;
+}
+
+
+
+const string & MarkovProgram::GetError() const
+{
+    return myError;
+}
+
+
+
+const Program & MarkovProgram::GetProgram() const
+{
+    return myProgram;
+}
+
+
+
+MarkovEngine::MarkovEngine( const MarkovProgram & theProgram ) :
+    myWorkPool( theProgram.GetProgram(), false, false )
+{
+}
+
+
+
+MarkovEngine::MarkovEngine( const Program & theProgram ) :
+    myWorkPool( theProgram, false, false )
+{
+}
+
+
+
+MarkovEngine::~MarkovEngine()
+{
+}
+
+
+
+WorkStatus_t MarkovEngine::Transform( const char * theInput,
+                                      size_t theLength,
+                                      string & theOutput )
+{
+    // read and write the text as Driver::RunSub does in full file mode
+    istringstream in( string( theInput, theLength ) );
+    unsigned line_number = 1;
+
+    myInput.clear();
+    ReadTaggedString( in, myInput, line_number, false, false, false );
+
+    Work & work = myWorkPool.Acquire();
+
+    WorkStatus_t status = work.DoTransformations( myInput, myOutput );
+
+    myWorkPool.Release( work );
+
+    ostringstream out;
+
+    WriteTaggedString( out, myOutput, true );
+
+    theOutput = out.str();
+
+    return status;
+}
+
+
+
+WorkStatus_t MarkovEngine::TransformBatch( const string * theInputs,
+                                           size_t theNumInputs,
+                                           string * theOutputs,
+                                           WorkStatus_t * theStatuses )
+{
+    WorkStatus_t first_error = WS_OK;
+
+    for ( size_t i = 0; i < theNumInputs; i++ )
+    {
+        WorkStatus_t status = Transform( theInputs[i].data(),
+                                         theInputs[i].size(),
+                                         theOutputs[i] );
+
+        if ( theStatuses != 0 )
+        {
+            theStatuses[i] = status;
+        }
+
+        if ( first_error == WS_OK )
+        {
+            first_error = status;
+        }
+    }
+
+    return first_error;
+}
@@ -0,0 +1,112 @@
+// FILE: markov_engine.h
+//
+// DESCRIPTION:
+//      The C++ interface of libmarkov, for running Markov programs from
+//      another program without the markov command line:
+//          MarkovProgram   - a program, read from its source text in
+//                            memory or from a program file
+//          MarkovEngine    - runs a MarkovProgram on input text in
+//                            memory, keeping its Work between inputs
+//
+//      The input and output are text as in the input and output files of
+//      markov in full file mode, so an engine's output for an input is
+//      exactly what markov writes for an input file holding it.
+//
+//      A MarkovProgram is only read by its engines, so any number of
+//      engines on different threads can share one, but it must not be
+//      loaded again while it has engines.  A MarkovEngine is not locked,
+//      so each thread needs its own.
+//
+//      libmarkov.h is the C interface to these classes.
+//
+// HISTORY:
+//      17-OCT-26   D.Brown     Created
+//      17-OCT-26   D.Brown     MarkovEngine can run a Program
+
+#ifndef MARKOV_ENGINE_H
+#define MARKOV_ENGINE_H
+
+
+#include "instr.h"
+#include "work_pool.h"
+#include "work_status.h"
+#include <string>
+
+
+class MarkovProgram
+{
+public:
+    MarkovProgram();
+
+    ~MarkovProgram();
+
+private:
+    MarkovProgram( const MarkovProgram & theOther );
+
+    const MarkovProgram & operator = ( const MarkovProgram & theOther );
+
+public:
+    // Reads the program from theLength chars of theText, the source as
+    // in a program file, replacing any program loaded before.  Returns
+    // WS_OK, or WS_ERROR_PROGRAM_SYNTAX, in which case GetError describes
+    // the error, naming the program theName.
+    WorkStatus_t Load( const char * theText,
+                       size_t theLength,
+                       const char * theName = "<memory>" );
+
+    // Same as Load, reading the program file theFileName.  Returns
+    // WS_ERROR_CANT_OPEN_PROGRAM_FILE if it can't be opened.
+    WorkStatus_t LoadFile( const char * theFileName );
+
+    // The error messages of the last Load or LoadFile, empty if none.
+    const std::string & GetError() const;
+
+    const Program & GetProgram() const;
+
+private:
+    Program myProgram;
+    std::string myError;
+};
+
+
+
+class MarkovEngine
+{
+public:
+    MarkovEngine( const MarkovProgram & theProgram );
+
+    // for a Program the caller built, such as a compiled program
+    MarkovEngine( const Program & theProgram );
+
+    ~MarkovEngine();
+
+private:
+    MarkovEngine( const MarkovEngine & theOther );
+
+    const MarkovEngine & operator = ( const MarkovEngine & theOther );
+
+public:
+    // Transforms theLength chars of theInput, setting theOutput to the
+    // output text.  Returns the status of Work::DoTransformations, and
+    // theOutput is set even if it is an error.
+    WorkStatus_t Transform( const char * theInput,
+                            size_t theLength,
+                            std::string & theOutput );
+
+    // Transforms each of theNumInputs strings of theInputs to the same
+    // element of theOutputs, and sets the same element of theStatuses
+    // (if not 0) to its status.  Every input is transformed even after
+    // an error.  Returns the first status which isn't WS_OK, or WS_OK.
+    WorkStatus_t TransformBatch( const std::string * theInputs,
+                                 size_t theNumInputs,
+                                 std::string * theOutputs,
+                                 WorkStatus_t * theStatuses = 0 );
+
+private:
+    WorkPool myWorkPool;
+    TaggedString myInput;
+    TaggedString myOutput;
+};
+
+
+#endif // MARKOV_ENGINE_H
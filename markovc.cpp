@@ -0,0 +1,59 @@
+// markovc.cpp : Defines the entry point for the Markov program compiler.
+//
+// Syntax: markovc <program_file> <output_file>
+//
+// Reads the Markov program in program_file and writes it as a C++ source
+// file (see program_compiler.h) to output_file, or to stdout if
+// output_file is omitted.
+
+
+#include "instr.h"
+#include "program_compiler.h"
+#include <iostream>
+#include <fstream>
+#include <vector>
+
+using namespace std;
+
+
+#define EXIT_OK    0
+#define EXIT_ERROR 100
+
+
+
+int main(int argc, char* argv[])
+{
+    if ( argc < 2 || argc > 3 )
+    {
+        cerr << "Syntax: markovc <program_file> <output_file>" << endl <<
+                endl;
+        cerr << "output_file can be omitted to write to stdout." << endl;
+        return EXIT_ERROR;
+    }
+
+    Program program;
+
+    if ( !ReadProgram( program, argv[1] ) )
+    {
+        return EXIT_ERROR;
+    }
+
+    if ( argc < 3 )
+    {
+        WriteCompiledProgram( program, argv[1], cout );
+        return EXIT_OK;
+    }
+
+    ofstream out( argv[2] );
+
+    if ( !out )
+    {
+        cerr << "ERROR: Unable to open output file '" << argv[2] << "'" <<
+                endl;
+        return EXIT_ERROR;
+    }
+
+    WriteCompiledProgram( program, argv[1], out );
+
+    return out ? EXIT_OK : EXIT_ERROR;
+}
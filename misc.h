@@ -20,6 +20,8 @@ typedef signed char SByte_t;
 
 typedef unsigned long BitSet_t;
 
+typedef unsigned long long UInt64_t;
+
 #define SET_BIT(element) (1<<(element))
 
 #define SET_IN(set, element) (((1<<(element)) & (set)) != 0)
@@ -0,0 +1,298 @@
+// FILE: pattern.cpp
+//
+// DESCRIPTION:
+//      Implements module described in pattern.h
+//
+// HISTORY:
+//      17-OCT-26   D.Brown     Created, split out of work_data.cpp
+//      17-OCT-26   D.Brown     Added GetMinMatchLength
+//      17-OCT-26   D.Brown     Added IsLiteral
+//      17-OCT-26   D.Brown     Added GetRepeatedChars
+//      17-OCT-26   D.Brown     Added GetBigrams
+
+#include "pattern.h"
+#include "tagged_char.h"
+#include "misc.h"
+#include <algorithm>
+#include <assert.h>
+
+
+using namespace std;
+
+
+
+Pattern::Pattern() :
+    myMinMatchLength( 0 ),
+    myIsLiteral( false )
+{
+    myOneCharWildcardsBefore.push_back( 0 );
+}
+
+
+
+Pattern::~Pattern()
+{
+}
+
+
+
+Pattern::Pattern( const Pattern & theOther )
+{
+    *this = theOther;
+}
+
+
+
+const Pattern & Pattern::operator = ( const Pattern & theOther )
+{
+    myStr = theOther.myStr;
+    myFragments = theOther.myFragments;
+    myWildcardTypes = theOther.myWildcardTypes;
+    myOneCharWildcardsBefore = theOther.myOneCharWildcardsBefore;
+    myMinMatchLength = theOther.myMinMatchLength;
+    myRepeatedChars = theOther.myRepeatedChars;
+    myBigrams = theOther.myBigrams;
+    myIsLiteral = theOther.myIsLiteral;
+
+    return *this;
+}
+
+
+
+// split a pattern string into fragments which consist either of
+// the largest number of consecutive non-wildcard characters, or
+// a single fixed wildcard ?.$% character (meaning the caller
+// at this point can figure out the characters in the search
+// string by consulting the wildcard fragment table).
+// a wildcard other than * becomes fixed after the first
+// non-wildcard character after the first occurrence of that
+// wildcard character.  Until then, it should be included in a
+// floating fragment with other contigous wildcards.
+static void SplitPatternIntoFragments( const TaggedString & pat,
+                                       std::vector<PatternFragment> & vpatfrag )
+{
+    int patlen = (int)pat.size();
+    int start = 0;
+    int len = 0;
+    BitSet_t wildcard_used = 0;
+    BitSet_t not_yet_fixed = 0;
+    vpatfrag.clear();
+
+    for ( int pi = 0; pi < patlen; pi++ )
+    {
+        Wildcard_t wt = ToWildcard( pat[pi] );
+
+        if ( wt == WC_END )
+        {
+            len++;
+            not_yet_fixed = 0;  // all wildcards previously seen are fixed
+        }
+        else
+        {
+            if ( len != 0 )
+            {
+                PatternFragment ff = { start, len };
+                vpatfrag.push_back( ff );
+            }
+
+            start = pi + 1;
+            len = 0;
+
+            if ( WildcardIsUnique(wt) )
+            {
+                if ( (wildcard_used & SET_BIT(wt)) != 0 &&
+                     (not_yet_fixed & SET_BIT(wt)) == 0 )
+                {   // we have seen this before, and it is fixed
+                    PatternFragment ff = { pi, -1 };
+                    vpatfrag.push_back( ff );
+                }
+                else
+                {   // this wildcard is not yet fixed
+                    wildcard_used |= SET_BIT(wt);
+                    not_yet_fixed |= SET_BIT(wt);
+                }
+            }
+        }
+    }
+
+    if ( len != 0 )
+    {
+        PatternFragment pf = { start, len };
+        vpatfrag.push_back( pf );
+    }
+}
+
+
+
+void Pattern::Compile( const TaggedString & thePatternStr )
+{
+    myStr = thePatternStr;
+
+    SplitPatternIntoFragments( myStr, myFragments );
+
+    size_t len = myStr.size();
+    int one_char_wildcards = 0;
+    int char_counts[TAGGED_CHAR_END] = { 0 };
+    myMinMatchLength = 0;
+    myIsLiteral = len != 0;
+
+    myWildcardTypes.resize( len );
+    myOneCharWildcardsBefore.resize( len + 1 );
+
+    for ( size_t i = 0; i < len; i++ )
+    {
+        Wildcard_t wt = ToWildcard( myStr[i] );
+
+        myWildcardTypes[i] = (UByte_t)wt;
+        myOneCharWildcardsBefore[i] = one_char_wildcards;
+
+        if ( wt != WC_END && WildcardMatches1Char(wt) )
+        {
+            one_char_wildcards++;
+        }
+
+        if ( wt == WC_END || WildcardMatches1Char(wt) )
+        {
+            myMinMatchLength++;
+        }
+
+        if ( wt != WC_END )
+        {
+            myIsLiteral = false;
+        }
+        else
+        {
+            char_counts[myStr[i]]++;
+        }
+    }
+
+    myOneCharWildcardsBefore[len] = one_char_wildcards;
+
+    myRepeatedChars.clear();
+
+    for ( int ci = 0; ci < TAGGED_CHAR_END; ci++ )
+    {
+        if ( char_counts[ci] > 1 )
+        {
+            PatternCharCount cc = { (TaggedChar_t)ci, char_counts[ci] };
+            myRepeatedChars.push_back( cc );
+        }
+    }
+
+    myBigrams.clear();
+
+    for ( size_t f = 0; f < myFragments.size(); f++ )
+    {
+        const PatternFragment & frag = myFragments[f];
+
+        for ( int i = frag.myStart; i + 1 < frag.myStart + frag.myLength; i++ )
+        {
+            myBigrams.push_back( myStr[i] * TAGGED_CHAR_END + myStr[i + 1] );
+        }
+    }
+
+    sort( myBigrams.begin(), myBigrams.end() );
+    myBigrams.erase( unique( myBigrams.begin(), myBigrams.end() ),
+                     myBigrams.end() );
+}
+
+
+
+const TaggedString & Pattern::GetStr() const
+{
+    return myStr;
+}
+
+
+
+int Pattern::GetLength() const
+{
+    return (int)myStr.size();
+}
+
+
+
+int Pattern::GetNumFragments() const
+{
+    return (int)myFragments.size();
+}
+
+
+
+const PatternFragment & Pattern::GetFragment( size_t frag_ix ) const
+{
+    assert( frag_ix < myFragments.size() );
+
+    return myFragments[frag_ix];
+}
+
+
+
+Wildcard_t Pattern::GetWildcardType( int pat_ix ) const
+{
+    if ( pat_ix < 0 || pat_ix >= (int)myWildcardTypes.size() )
+    {
+        return WC_END;
+    }
+
+    return (Wildcard_t)myWildcardTypes[pat_ix];
+}
+
+
+
+int Pattern::MinWildcardSpan( int pat_from,
+                              int pat_to ) const
+{
+    assert( pat_from >= 0 && pat_to <= GetLength() );
+
+    if ( pat_from >= pat_to )
+    {
+        return 0;
+    }
+
+    return myOneCharWildcardsBefore[pat_to] -
+           myOneCharWildcardsBefore[pat_from];
+}
+
+
+
+int Pattern::MaxWildcardSpan( int pat_from,
+                              int pat_to ) const
+{
+    int len_so_far = MinWildcardSpan( pat_from, pat_to );
+
+    if ( pat_from < pat_to && len_so_far != pat_to - pat_from )
+    {   // at least one of these matches more than one char
+        return -1;
+    }
+
+    return len_so_far;
+}
+
+
+
+int Pattern::GetMinMatchLength() const
+{
+    return myMinMatchLength;
+}
+
+
+
+const vector<PatternCharCount> & Pattern::GetRepeatedChars() const
+{
+    return myRepeatedChars;
+}
+
+
+
+const vector<int> & Pattern::GetBigrams() const
+{
+    return myBigrams;
+}
+
+
+
+bool Pattern::IsLiteral() const
+{
+    return myIsLiteral;
+}
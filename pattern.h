@@ -0,0 +1,155 @@
+// FILE: pattern.h
+//
+// DESCRIPTION:
+//      Defines class Pattern, which is the compiled form of the pattern
+//      string of a transformation.  It is built once when the program is
+//      read, and is read-only while pattern matching, so none of this
+//      information needs to be recomputed every time a transformation
+//      is attempted.
+//
+//      The compiled pattern contains:
+//
+//          myStr:                  The pattern string itself.
+//
+//          myFragments:            This is a vector which describes the
+//                                  start and length in the pattern string
+//                                  of each contiguous set of non-wildcard
+//                                  characters, or of a single unique
+//                                  wildcard character which is already
+//                                  fixed (by having at least one non-wildcard
+//                                  character between it and the first
+//                                  occurrence of the same wildcard).
+//
+//          myWildcardTypes:        This is a vector indexed by position in
+//                                  the pattern string which contains the
+//                                  Wildcard_t of the char at that position,
+//                                  or WC_END if it isn't a wildcard.
+//
+//          myMinMatchLength:       The fewest From String characters any
+//                                  match can span: one for each
+//                                  non-wildcard character and each ?.
+//
+//          myRepeatedChars:        The non-wildcard characters which occur
+//                                  more than once in the pattern, with how
+//                                  many times.  The fragments match
+//                                  separate chars of the From String, so
+//                                  it must have at least that many of
+//                                  each.  Chars which occur once are left
+//                                  to the set of chars used (see
+//                                  Instr::GetPatternCharsUsed).
+//
+//          myBigrams:              The pairs of adjacent chars in the
+//                                  fragments (see TAGGED_BIGRAM_END).
+//                                  Each of them must occur in the From
+//                                  String for the pattern to match.
+//
+//          myOneCharWildcardsBefore:
+//                                  This is a vector with one more element
+//                                  than the pattern string, which gives the
+//                                  number of ?. wildcards in the pattern
+//                                  before each position.  This permits the
+//                                  span of the wildcards in any gap between
+//                                  fragments to be computed without
+//                                  rescanning the pattern.
+//
+// HISTORY:
+//      17-OCT-26   D.Brown     Created, split out of work_data.h
+//      17-OCT-26   D.Brown     Added GetMinMatchLength
+//      17-OCT-26   D.Brown     Added IsLiteral
+//      17-OCT-26   D.Brown     Added GetRepeatedChars
+//      17-OCT-26   D.Brown     Added GetBigrams
+
+#ifndef PATTERN_H
+#define PATTERN_H
+
+
+#include "tagged_char.h"
+#include "misc.h"
+#include <vector>
+
+
+// This identifies either a set of contiguous non-wildcard characters
+// in the pattern, or a single already-matched unique wildcard char.
+struct PatternFragment
+{
+    int     myStart;
+    int     myLength;       // -1 means this is a wildcard char
+};
+
+
+// a non-wildcard character and how many times it occurs in a pattern
+struct PatternCharCount
+{
+    TaggedChar_t    myChar;
+    int             myCount;
+};
+
+
+class Pattern
+{
+public:
+    Pattern();
+
+    ~Pattern();
+
+    Pattern( const Pattern & theOther );
+
+    const Pattern & operator = ( const Pattern & theOther );
+
+    // Sets the pattern string to thePatternStr, splits it into
+    // fragments and computes the wildcard information.
+    void Compile( const TaggedString & thePatternStr );
+
+    const TaggedString & GetStr() const;
+
+    int GetLength() const;
+
+    // Gets the number of fragments the pattern has been split into.
+    // Note that gaps containing wildcards before the fragments are not counted.
+    int GetNumFragments() const;
+
+    const PatternFragment & GetFragment( size_t frag_ix ) const;
+
+    // Returns the wildcard type of the char at pat_ix, or WC_END if
+    // it isn't a wildcard (or pat_ix is past the end of the pattern).
+    Wildcard_t GetWildcardType( int pat_ix ) const;
+
+    // how many wildcards in this series are single-character wildcards?
+    int MinWildcardSpan( int pat_from,
+                         int pat_to ) const;
+
+    // if any of these are *$% return -1 otherwise return count of ?.
+    int MaxWildcardSpan( int pat_from,
+                         int pat_to ) const;
+
+    // Returns the length of the shortest From String this could match.
+    int GetMinMatchLength() const;
+
+    // Returns the non-wildcard chars which occur more than once in the
+    // pattern, and their counts.
+    const std::vector<PatternCharCount> & GetRepeatedChars() const;
+
+    // Returns the bigrams of the fragments, in increasing order.
+    const std::vector<int> & GetBigrams() const;
+
+    // Returns true if the pattern is not empty and has no wildcards,
+    // so it matches its leftmost occurrence in the From String.
+    bool IsLiteral() const;
+
+private:
+    TaggedString myStr;
+
+    // spans of contiguous non-wildcard characters in the pattern
+    // or single already matched wildcard characters in pattern
+    std::vector<PatternFragment> myFragments;
+
+    std::vector<UByte_t> myWildcardTypes;           // Wildcard_t per char
+    std::vector<int> myOneCharWildcardsBefore;      // # of ?. before index
+    int myMinMatchLength;
+    std::vector<PatternCharCount> myRepeatedChars;  // in order of char
+    std::vector<int> myBigrams;                     // no duplicates
+    bool myIsLiteral;
+};
+
+
+#endif // PATTERN_H
@@ -0,0 +1,735 @@
+// FILE: pattern_vm.cpp
+//
+// DESCRIPTION:
+//      Implements module described in pattern_vm.h
+//
+// HISTORY:
+//      17-OCT-26   D.Brown     Created
+//      17-OCT-26   D.Brown     Untagged wildcards stop at the next tagged char
+//      17-OCT-26   D.Brown     Remember the states which failed
+//      17-OCT-26   D.Brown     Only allocate the choice points which can be used
+//      17-OCT-26   D.Brown     Added PatternVM::Reset
+//      17-OCT-26   D.Brown     Run can be traced for the verbose log
+
+#include "pattern_vm.h"
+#include "work_data.h"
+#include "tagged_char.h"
+#include <algorithm>
+#include <assert.h>
+
+
+using namespace std;
+
+
+// An untagged wildcard spanning at least this many chars is cut short at
+// the next tagged char before its spans are tried.  Shorter spans are
+// cheaper to just try.
+static const int MIN_UNTAGGED_CAP_SPAN = 16;
+
+// Failed states are only remembered once a match has backtracked this
+// many times, as most matches finish long before the memo would pay.
+static const size_t MEMO_MIN_BACKTRACKS = 256;
+
+// No more failed states than this are remembered in one match.
+static const size_t MAX_FAILURES = 1 << 20;
+
+
+
+PatternCode::PatternCode() :
+    myMaxChoicePoints( 0 )
+{
+}
+
+
+
+PatternCode::~PatternCode()
+{
+}
+
+
+
+PatternCode::PatternCode( const PatternCode & theOther )
+{
+    *this = theOther;
+}
+
+
+
+const PatternCode & PatternCode::operator = ( const PatternCode & theOther )
+{
+    myOps = theOther.myOps;
+    myMaxChoicePoints = theOther.myMaxChoicePoints;
+
+    return *this;
+}
+
+
+
+// Each fragment is placed before the gap in front of it is filled, and
+// the gap after the last fragment is filled last.
+void PatternCode::Compile( const Pattern & thePattern )
+{
+    int num_frags = thePattern.GetNumFragments();
+    int pat_len = thePattern.GetLength();
+
+    myOps.clear();
+
+    if ( num_frags == 0 )
+    {
+        AppendOp( PO_WHOLE, 0, thePattern.MaxWildcardSpan( 0, pat_len ) );
+        CompileGap( thePattern, 0, pat_len );
+        AppendOp( PO_END, 0, 0 );
+        SetUniqueMasks();
+        return;
+    }
+
+    int prev_end = 0;           // end of the previous fragment in the pattern
+
+    for ( int f = 0; f < num_frags; f++ )
+    {
+        const PatternFragment & frag = thePattern.GetFragment( f );
+
+        if ( f == 0 )
+        {
+            AppendOp( PO_SEEK_FIRST, f,
+                      thePattern.MaxWildcardSpan( 0, frag.myStart ) );
+        }
+        else
+        {   // a wildcard fragment is compared with the wildcard's first
+            // occurrence
+            AppendOp( prev_end == frag.myStart ? PO_VERIFY : PO_SEEK, f, 0,
+                      frag.myLength < 0 ?
+                            thePattern.GetWildcardType( frag.myStart ) :
+                            WC_END );
+        }
+
+        CompileGap( thePattern, prev_end, frag.myStart );
+        AppendOp( PO_NEXT, f, 0 );
+
+        // a fixed wildcard fragment is one char of the pattern
+        prev_end = frag.myStart + (frag.myLength < 0 ? 1 : frag.myLength);
+    }
+
+    AppendOp( PO_TRAIL, num_frags,
+              thePattern.MaxWildcardSpan( prev_end, pat_len ) );
+    CompileGap( thePattern, prev_end, pat_len );
+    AppendOp( PO_END, 0, 0 );
+    SetUniqueMasks();
+}
+
+
+
+size_t PatternCode::GetNumOps() const
+{
+    return myOps.size();
+}
+
+
+
+const PatternOp & PatternCode::GetOp( size_t theOpIx ) const
+{
+    assert( theOpIx < myOps.size() );
+
+    return myOps[theOpIx];
+}
+
+
+
+size_t PatternCode::GetMaxChoicePoints() const
+{
+    return myMaxChoicePoints;
+}
+
+
+
+bool PatternCode::CanRepeatStates() const
+{
+    return myMaxChoicePoints >= 2;
+}
+
+
+
+void PatternCode::CompileGap( const Pattern & thePattern,
+                              int thePatFrom,
+                              int thePatTo )
+{
+    for ( int pi = thePatFrom; pi < thePatTo; pi++ )
+    {
+        AppendGapOp( thePattern.GetWildcardType( pi ), pi + 1 == thePatTo,
+                     thePattern.MinWildcardSpan( pi + 1, thePatTo ) );
+    }
+}
+
+
+
+void PatternCode::AppendOp( PatternOpCode_t theOpCode,
+                            int theFragIx,
+                            int theSpan,
+                            Wildcard_t theWildcard )
+{
+    PatternOp op = { (UByte_t)theOpCode, (UByte_t)theWildcard, false, false,
+                     false, theFragIx, theSpan, 0 };
+
+    myOps.push_back( op );
+}
+
+
+
+void PatternCode::AppendGapOp( Wildcard_t theWildcard,
+                               bool isLastInGap,
+                               int theSpan )
+{
+    assert( theWildcard != WC_END );    // gaps only contain wildcards
+
+    PatternOp op = { (UByte_t)(WildcardMatches1Char(theWildcard) ?
+                                    PO_GAP_ONE : PO_GAP_VAR),
+                     (UByte_t)theWildcard,
+                     isLastInGap,
+                     WildcardMatchesOnlyUntagged(theWildcard),
+                     WildcardIsUnique(theWildcard),
+                     0,
+                     theSpan,
+                     0 };
+
+    myOps.push_back( op );
+}
+
+
+
+void PatternCode::SetUniqueMasks()
+{
+    int mask = 0;
+    size_t num_choice_ops = 0;
+
+    for ( size_t i = myOps.size(); i-- > 0; )
+    {
+        PatternOp & op = myOps[i];
+        Wildcard_t wt = (Wildcard_t)op.myWildcard;
+
+        if ( wt != WC_END && WildcardIsUnique( wt ) )
+        {
+            mask |= 1 << wt;
+        }
+
+        op.myUniqueMask = mask;
+
+        if ( op.myOpCode == PO_SEEK_FIRST || op.myOpCode == PO_SEEK ||
+             op.myOpCode == PO_VERIFY ||
+             (op.myOpCode == PO_GAP_VAR && !op.myIsLastInGap) )
+        {
+            num_choice_ops++;
+        }
+    }
+
+    myMaxChoicePoints = num_choice_ops;
+}
+
+
+
+PatternVM::PatternVM()
+{
+}
+
+
+
+PatternVM::~PatternVM()
+{
+}
+
+
+
+const char * GetPatternOpName( PatternOpCode_t theOpCode )
+{
+    static const char * names[PO_NUM_OPCODES] =
+    {
+        "WHOLE", "SEEK_FIRST", "SEEK", "VERIFY", "TRAIL",
+        "GAP_ONE", "GAP_VAR", "NEXT", "END"
+    };
+
+    return theOpCode < PO_NUM_OPCODES ? names[theOpCode] : "???";
+}
+
+
+
+PatternTracer::~PatternTracer()
+{
+}
+
+
+
+WorkStatus_t PatternVM::Run( const PatternCode & theCode,
+                             WorkData & theWorkData )
+{
+    return RunCode<false>( theCode, theWorkData, 0 );
+}
+
+
+
+WorkStatus_t PatternVM::Run( const PatternCode & theCode,
+                             WorkData & theWorkData,
+                             PatternTracer & theTracer )
+{
+    return RunCode<true>( theCode, theWorkData, &theTracer );
+}
+
+
+
+// The gaps are placed in the From String as follows:
+//
+// If there are no fragments, and there are any *$% wildcards, the gap
+// is the entire From String, otherwise it starts at the beginning of the
+// From String and its length is the number of ?. wildcards.  i.e. "*"
+// matches the entire string, "?" only the first char of the string.
+//
+// If there are any *$% wildcards in the gap before the first fragment,
+// the gap is everything from the beginning of the From String to the
+// start of the fragment, otherwise it is the ?. wildcards just before
+// the fragment.  i.e. for "*A" the * matches everything before the first
+// occurrence of A, and for ".A" the . matches the char before the first A.
+//
+// The gap after the last fragment is likewise everything after the
+// fragment if it has any *$% wildcards, otherwise its ?. wildcards.
+template <bool IsTraced>
+WorkStatus_t PatternVM::RunCode( const PatternCode & theCode,
+                                 WorkData & theWorkData,
+                                 PatternTracer * theTracer )
+{
+    // Nothing is allocated while the code runs, except for remembering
+    // failed states.  The trail only grows past one entry per op when a
+    // PO_SEEK moves along the From String inside a state on the trail.
+    if ( myChoicePoints.size() < theCode.GetMaxChoicePoints() )
+    {
+        myChoicePoints.resize( theCode.GetMaxChoicePoints() );
+    }
+
+    if ( myTrail.capacity() < theCode.GetNumOps() )
+    {
+        myTrail.reserve( theCode.GetNumOps() );
+    }
+
+    if ( !myTrail.empty() || !myFailures.empty() )
+    {
+        myTrail.clear();
+        myFailures.clear();
+        myLeftOccurrences.clear();
+    }
+
+    const int from_len = (int)theWorkData.GetFromStr().size();
+    size_t num_choice_points = 0;
+    size_t num_backtracks = 0;
+    bool remember_failures = false;
+    State s = { 0, -1, 0, 0, 0 };
+
+    for ( ;; )
+    {
+        const PatternOp & op = theCode.GetOp( s.myPC );
+        bool ok = true;
+        bool matched = false;
+
+        if ( remember_failures &&
+             (op.myOpCode == PO_SEEK || op.myOpCode == PO_VERIFY ||
+              op.myOpCode == PO_GAP_VAR) )
+        {   // skip the op if this state already failed
+            ok = EnterState( op, s, num_choice_points, theWorkData );
+        }
+
+        if ( ok )
+        {
+            switch ( op.myOpCode )
+            {
+            case PO_WHOLE:
+                s.myFsFixedIx = from_len;
+                s.myFsWildIx = op.mySpan == -1 ? 0 : op.mySpan;
+                s.myFsWildEndIx = s.myFsFixedIx;
+                theWorkData.UnmatchFromString( s.myFsWildIx );
+                break;
+
+            case PO_SEEK_FIRST:
+            case PO_SEEK:
+            case PO_VERIFY:
+                ok = op.myOpCode == PO_VERIFY ?
+                        theWorkData.VerifyPatFragPos( op.myFragIx,
+                                                      s.myFsFixedIx ) :
+                        theWorkData.AdvancePatFragPos( op.myFragIx,
+                                                       s.myFsFixedIx );
+
+                if ( ok )
+                {
+                    s.myFsFixedIx = theWorkData.GetPatFragPosInFromStr(
+                                                                op.myFragIx );
+
+                    if ( op.myOpCode == PO_SEEK_FIRST || s.myFsLeftIx < 0 ||
+                         s.myFsLeftIx > s.myFsFixedIx )
+                    {
+                        s.myFsLeftIx = s.myFsFixedIx;
+                    }
+
+                    if ( op.myOpCode == PO_SEEK_FIRST )
+                    {
+                        s.myFsWildIx = op.mySpan == -1 ?
+                                            0 : s.myFsFixedIx - op.mySpan;
+                    }
+
+                    s.myFsWildEndIx = s.myFsFixedIx;
+                    theWorkData.UnmatchFromString( s.myFsWildIx );
+
+                    int len = theWorkData.GetPatFragLengthInFromStr(
+                                                                op.myFragIx );
+                    assert( len >= 0 );
+
+                    if ( s.myFsFixedIx + len < from_len )
+                    {   // try the following occurrence of the fragment later
+                        assert( num_choice_points < myChoicePoints.size() );
+                        State & next = myChoicePoints[num_choice_points++];
+                        next = s;
+                        next.myFsFixedIx++;
+                    }
+                }
+                break;
+
+            case PO_TRAIL:
+            {
+                int prev_start;
+                int prev_len;
+                theWorkData.GetPatFragStartLengthInFromStr( op.myFragIx - 1,
+                                                            prev_start,
+                                                            prev_len );
+                assert( prev_start >= 0 && prev_len >= 0 );
+
+                s.myFsWildIx = prev_start + prev_len;
+                s.myFsFixedIx = op.mySpan == -1 ?
+                                    from_len : s.myFsWildIx + op.mySpan;
+                s.myFsWildEndIx = s.myFsFixedIx;
+                theWorkData.UnmatchFromString( s.myFsWildIx );
+                break;
+            }
+
+            case PO_GAP_ONE:
+                theWorkData.UnmatchFromString( s.myFsWildIx );
+
+                if ( s.myFsWildIx == s.myFsWildEndIx ||
+                     s.myFsWildIx == s.myFsFixedIx )
+                {
+                    ok = false;
+                    break;
+                }
+
+                s.myFsWildEndIx = s.myFsWildIx + 1;
+                ok = MatchWildcard( op, s, theWorkData );
+                break;
+
+            case PO_GAP_VAR:
+                theWorkData.UnmatchFromString( s.myFsWildIx );
+
+                // leave 1 char for each ?. after this wildcard in the gap
+                s.myFsWildEndIx = max( s.myFsWildIx,
+                                       min( s.myFsWildEndIx,
+                                            s.myFsFixedIx - op.mySpan ) );
+
+                if ( op.myIsUntagged &&
+                     s.myFsWildEndIx - s.myFsWildIx >= MIN_UNTAGGED_CAP_SPAN )
+                {   // spans past the next tagged char can't match, so don't
+                    // try them one at a time
+                    s.myFsWildEndIx = min( s.myFsWildEndIx,
+                                           theWorkData.GetNextTaggedPos(
+                                                            s.myFsWildIx ) );
+                }
+
+                if ( !op.myIsLastInGap && s.myFsWildEndIx > s.myFsWildIx )
+                {   // try one char less later
+                    assert( num_choice_points < myChoicePoints.size() );
+                    State & next = myChoicePoints[num_choice_points++];
+                    next = s;
+                    next.myFsWildEndIx--;
+                }
+
+                ok = MatchWildcard( op, s, theWorkData );
+                break;
+
+            case PO_NEXT:
+            {
+                int len = theWorkData.GetPatFragLengthInFromStr( op.myFragIx );
+                assert( len >= 0 );
+
+                s.myFsWildIx = s.myFsFixedIx + len;
+                s.myFsWildEndIx = s.myFsWildIx;
+                s.myFsFixedIx = s.myFsWildIx;
+                break;
+            }
+
+            case PO_END:
+            {
+                int fs_left = s.myFsLeftIx >= 0 ? s.myFsLeftIx : s.myFsWildIx;
+
+                if ( fs_left > s.myFsFixedIx )
+                {   // the gap after a wildcard fragment starts after its
+                    // first occurrence, which can be before the matched
+                    // chars, so the prefix would overlap the suffix
+                    ok = false;
+                    break;
+                }
+
+                theWorkData.SetPrefixAndSuffix( fs_left, s.myFsFixedIx );
+                matched = true;
+                break;
+            }
+
+            default:
+                assert( false );
+                return WS_NO_MATCH;
+            }
+        }
+
+        if ( IsTraced )
+        {
+            theTracer->TraceOp( theCode, s.myPC,
+                                matched ? WS_OK :
+                                    ok ? WS_CONTINUE : WS_NO_MATCH,
+                                s, myChoicePoints.data(), num_choice_points );
+        }
+
+        if ( matched )
+        {
+            return WS_OK;
+        }
+        else if ( ok )
+        {
+            s.myPC++;
+        }
+        else if ( num_choice_points == 0 )
+        {
+            return WS_NO_MATCH;
+        }
+        else
+        {
+            s = myChoicePoints[--num_choice_points];
+
+            if ( remember_failures )
+            {
+                RecordFailures( num_choice_points, theWorkData );
+            }
+            else if ( ++num_backtracks == MEMO_MIN_BACKTRACKS )
+            {
+                remember_failures = theCode.CanRepeatStates();
+            }
+        }
+    }
+}
+
+
+
+void PatternVM::Reset( size_t theMaxKeptLength )
+{
+    myTrail.clear();
+    myLeftOccurrences.clear();
+
+    if ( myFailures.size() > theMaxKeptLength )
+    {
+        FailureMap().swap( myFailures );
+        std::vector<Occurrence>().swap( myLeftOccurrences );
+    }
+    else
+    {
+        myFailures.clear();
+    }
+}
+
+
+
+bool PatternVM::MatchWildcard( const PatternOp & theOp,
+                               State & theState,
+                               WorkData & theWorkData )
+{
+    if ( theOp.myIsLastInGap &&
+         theState.myFsWildEndIx != theState.myFsFixedIx )
+    {   // this is the last wildcard in gap, and gap is not filled
+        return false;
+    }
+
+    const TaggedString & fs = theWorkData.GetFromStr();
+    Wildcard_t wt = (Wildcard_t)theOp.myWildcard;
+    int matched_len = theState.myFsWildEndIx - theState.myFsWildIx;
+
+    if ( theState.myFsWildEndIx > (int)fs.size() )
+    {   // a ?. after the last fragment, past the end of the From String
+        return false;
+    }
+
+    if ( theOp.myIsUntagged &&
+         !theWorkData.FromSubstringIsUntagged( theState.myFsWildIx,
+                                               theState.myFsWildEndIx ) )
+    {
+        return false;
+    }
+
+    if ( theOp.myIsUnique &&
+         theWorkData.GetFirstWildcardOccurrence( wt ) >= 0 )
+    {   // must match the first occurrence
+        if ( !theWorkData.CompareSubstringWithWildcard(
+                                wt, theState.myFsWildIx, matched_len ) )
+        {
+            return false;
+        }
+    }
+    else
+    {
+        theWorkData.FoundWildcard( wt, theState.myFsWildIx, matched_len );
+    }
+
+    if ( theState.myFsLeftIx < 0 ||
+         theState.myFsLeftIx > theState.myFsWildIx )
+    {   // mark leftmost matched character in this From String
+        theState.myFsLeftIx = theState.myFsWildIx;
+    }
+
+    // advance to next wildcard in gap
+    theState.myFsWildIx = theState.myFsWildEndIx;
+    theState.myFsWildEndIx = theState.myFsFixedIx;
+
+    return true;
+}
+
+
+
+size_t PatternVM::StateHash::operator () ( const State & theState ) const
+{
+    size_t h = theState.myPC;
+
+    h = h * 1000003 + (size_t)theState.myFsLeftIx;
+    h = h * 1000003 + (size_t)theState.myFsWildIx;
+    h = h * 1000003 + (size_t)theState.myFsWildEndIx;
+    h = h * 1000003 + (size_t)theState.myFsFixedIx;
+
+    return h;
+}
+
+
+
+bool PatternVM::StateEqual::operator () ( const State & theState1,
+                                          const State & theState2 ) const
+{
+    return theState1.myPC == theState2.myPC &&
+           theState1.myFsLeftIx == theState2.myFsLeftIx &&
+           theState1.myFsWildIx == theState2.myFsWildIx &&
+           theState1.myFsWildEndIx == theState2.myFsWildEndIx &&
+           theState1.myFsFixedIx == theState2.myFsFixedIx;
+}
+
+
+
+bool PatternVM::EnterState( const PatternOp & theOp,
+                            const State & theState,
+                            size_t theNumChoicePoints,
+                            WorkData & theWorkData )
+{
+    // see pattern_vm.h for when a state can be remembered
+    for ( int w = 0; w < WC_END; w++ )
+    {
+        if ( (theOp.myUniqueMask & (1 << w)) != 0 &&
+             theWorkData.GetFirstWildcardOccurrence( (Wildcard_t)w ) >= 0 )
+        {
+            return true;
+        }
+    }
+
+    int num_occurrences = theWorkData.GetNumWildcardsUsed();
+
+    if ( num_occurrences > 0 )
+    {
+        int start;
+        int len;
+
+        theWorkData.GetWildcardSubstringInfo( num_occurrences - 1, start,
+                                              len );
+
+        if ( start + len > theState.myFsWildIx )
+        {
+            return true;
+        }
+    }
+
+    State key = GetFailureKey( theOp, theState );
+    FailureMap::const_iterator it = myFailures.find( key );
+
+    if ( it != myFailures.end() )
+    {
+        const Failure & failure = it->second;
+
+        for ( size_t i = 0; i < failure.myNumOccurrences; i++ )
+        {
+            const Occurrence & occ =
+                        myLeftOccurrences[failure.myFirstOccurrence + i];
+
+            theWorkData.FoundWildcard( occ.myWildcard, occ.myStartIx,
+                                       occ.myLength );
+        }
+
+        return false;
+    }
+
+    TrailEntry entry = { key, theNumChoicePoints, num_occurrences };
+    myTrail.push_back( entry );
+
+    return true;
+}
+
+
+
+void PatternVM::RecordFailures( size_t theNumChoicePoints,
+                                WorkData & theWorkData )
+{
+    int num_occurrences = theWorkData.GetNumWildcardsUsed();
+
+    while ( !myTrail.empty() &&
+            myTrail.back().myNumChoicePoints > theNumChoicePoints )
+    {
+        const TrailEntry & entry = myTrail.back();
+
+        if ( myFailures.size() < MAX_FAILURES )
+        {
+            Failure failure = { myLeftOccurrences.size(), 0 };
+
+            // the occurrences stored after the state was reached, which
+            // are still there
+            for ( int wo = entry.myNumOccurrences; wo < num_occurrences;
+                  wo++ )
+            {
+                Occurrence occ;
+
+                occ.myWildcard = theWorkData.GetWildcardType( wo );
+                theWorkData.GetWildcardSubstringInfo( wo, occ.myStartIx,
+                                                      occ.myLength );
+                myLeftOccurrences.push_back( occ );
+                failure.myNumOccurrences++;
+            }
+
+            myFailures.insert( FailureMap::value_type( entry.myState,
+                                                       failure ) );
+        }
+
+        myTrail.pop_back();
+    }
+}
+
+
+
+PatternVM::State PatternVM::GetFailureKey( const PatternOp & theOp,
+                                           const State & theState ) const
+{
+    State key = theState;
+
+    // The leftmost matched char is only used by PO_END, and once it is
+    // before myFsWildIx nothing after can change it or make PO_END fail.
+    if ( key.myFsLeftIx >= 0 && key.myFsLeftIx <= key.myFsWildIx )
+    {
+        key.myFsLeftIx = -2;
+    }
+
+    // PO_SEEK and PO_VERIFY set myFsWildEndIx before using it
+    if ( theOp.myOpCode != PO_GAP_VAR )
+    {
+        key.myFsWildEndIx = -1;
+    }
+
+    return key;
+}
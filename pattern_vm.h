@@ -0,0 +1,316 @@
+// FILE: pattern_vm.h
+//
+// DESCRIPTION:
+//      Defines class PatternCode, which is a pattern compiled to a short
+//      program of PatternOps, and class PatternVM, which runs it to match
+//      the From String.
+//
+//      The code follows the pattern from left to right.  For each
+//      fragment it has an op which places the fragment, then one op for
+//      each wildcard in the gap before the fragment, then PO_NEXT which
+//      moves past the fragment.  The gap after the last fragment follows,
+//      then PO_END.  For example $a*b is:
+//
+//          PO_SEEK_FIRST 0, PO_GAP_VAR $, PO_NEXT,
+//          PO_SEEK 1, PO_GAP_VAR *, PO_NEXT, PO_TRAIL, PO_END
+//
+//      Everything which only depends on the pattern (which fragment,
+//      the span of the wildcards in a gap, whether a wildcard is the last
+//      one in its gap) is worked out when the code is compiled.
+//
+//      PatternVM runs the code straight through, keeping a choice point
+//      for each op which could be retried: the next position of a placed
+//      fragment, or one char less for a $%* wildcard.  A choice point
+//      only holds the registers; the alternative itself (where the
+//      fragment occurs next, or whether the shorter wildcard matches) is
+//      worked out when the VM backtracks to it.  When an op fails it
+//      resumes from the most recent choice point.  Since the code only
+//      runs forwards there is at most one choice point per op which can
+//      save one, so the choice point stack is allocated once, with
+//      PatternCode::GetMaxChoicePoints entries, however long the From
+//      String is.
+//
+//      The VM is the one general pattern matcher.  The ShapeMatchers and
+//      the native matchers of markovc find the same match as it does, and
+//      leave the same wildcard occurrences in the WorkData.
+//
+//      For the verbose log, Run can be given a PatternTracer, which is
+//      called after each op with the registers and the choice points.
+//      Run is a template on whether it is traced, so the untraced VM has
+//      no tracing code in it at all.
+//
+//      A pattern with several fragments separated by $%* can reach the
+//      same state (op and From String indexes) along many paths, and
+//      without help would fail from it again each time, which takes
+//      exponential time.  So once a match has backtracked
+//      MEMO_MIN_BACKTRACKS times, PatternVM remembers the states at
+//      PO_SEEK, PO_VERIFY and PO_GAP_VAR which failed, and fails at once
+//      when it gets to one again.  A state is known to have failed when
+//      the VM backtracks to a choice point saved before it was reached.
+//
+//      A state is only remembered when what happens after it can't depend
+//      on how it was reached:
+//
+//          - No unique wildcard used at or after the op may have an
+//            occurrence yet, since it would be compared with it.
+//
+//          - The last wildcard occurrence must end at or before the
+//            state's myFsWildIx, so that the UnmatchFromString calls after
+//            the op (which are never before myFsWildIx) can't remove the
+//            occurrences stored before it.
+//
+//      A failed state can still leave occurrences behind, which
+//      UnmatchFromString doesn't remove because they end before where the
+//      match resumes.  These are kept with the state and stored again
+//      when it is skipped, so the WorkData is left as without the memo.
+//
+// HISTORY:
+//      17-OCT-26   D.Brown     Created
+//      17-OCT-26   D.Brown     Remember the states which failed
+//      17-OCT-26   D.Brown     Added GetMaxChoicePoints
+//      17-OCT-26   D.Brown     Added PatternVM::Reset
+//      17-OCT-26   D.Brown     Added PatternTracer
+
+#ifndef PATTERN_VM_H
+#define PATTERN_VM_H
+
+
+#include "pattern.h"
+#include "work_status.h"
+#include "misc.h"
+#include <vector>
+#include <unordered_map>
+
+
+class WorkData;
+
+
+enum PatternOpCode_t
+{
+    PO_WHOLE,           // no fragments, the gap is the whole From String
+    PO_SEEK_FIRST,      // place the first fragment at its next position
+    PO_SEEK,            // place a fragment at its next position
+    PO_VERIFY,          // place a fragment right after the previous one
+    PO_TRAIL,           // the gap after the last fragment
+    PO_GAP_ONE,         // a ? or . wildcard in the gap
+    PO_GAP_VAR,         // a $, % or * wildcard in the gap
+    PO_NEXT,            // move past the placed fragment
+    PO_END,             // the pattern matched
+
+    PO_NUM_OPCODES
+};
+
+
+// the name of theOpCode without the PO_, for the verbose log
+const char * GetPatternOpName( PatternOpCode_t theOpCode );
+
+
+struct PatternOp
+{
+    UByte_t myOpCode;       // PatternOpCode_t
+    UByte_t myWildcard;     // Wildcard_t of PO_GAP_ONE and PO_GAP_VAR, or
+                            //   of the wildcard fragment placed by
+                            //   PO_SEEK and PO_VERIFY, otherwise WC_END
+    bool    myIsLastInGap;  // PO_GAP_ONE and PO_GAP_VAR: must fill the gap
+    bool    myIsUntagged;   // the wildcard only matches untagged chars
+    bool    myIsUnique;     // the wildcard must match its first occurrence
+    int     myFragIx;       // the fragment placed or moved past
+    int     mySpan;         // PO_WHOLE, PO_SEEK_FIRST, PO_TRAIL: the
+                            //   Pattern::MaxWildcardSpan of the gap;
+                            // PO_GAP_VAR: the Pattern::MinWildcardSpan
+                            //   of the wildcards after it in the gap
+    int     myUniqueMask;   // bit w is set if unique Wildcard_t w is used
+                            //   by this op or one after it
+};
+
+
+class PatternCode
+{
+public:
+    PatternCode();
+
+    ~PatternCode();
+
+    PatternCode( const PatternCode & theOther );
+
+    const PatternCode & operator = ( const PatternCode & theOther );
+
+    void Compile( const Pattern & thePattern );
+
+    size_t GetNumOps() const;
+
+    const PatternOp & GetOp( size_t theOpIx ) const;
+
+    // Returns how many choice points running the code can need at once,
+    // which is the number of ops which can save one.
+    size_t GetMaxChoicePoints() const;
+
+    // Returns true if there are at least two ops which save choice
+    // points, so the same state could be reached more than once.
+    bool CanRepeatStates() const;
+
+private:
+    // appends the ops for the wildcards from thePatFrom up to thePatTo
+    void CompileGap( const Pattern & thePattern,
+                     int thePatFrom,
+                     int thePatTo );
+
+    void AppendOp( PatternOpCode_t theOpCode,
+                   int theFragIx,
+                   int theSpan,
+                   Wildcard_t theWildcard = WC_END );
+
+    void AppendGapOp( Wildcard_t theWildcard,
+                      bool isLastInGap,
+                      int theSpan );
+
+    // sets myUniqueMask and myMaxChoicePoints once the ops are appended
+    void SetUniqueMasks();
+
+private:
+    std::vector<PatternOp> myOps;
+    size_t myMaxChoicePoints;
+};
+
+
+// the registers of the PatternVM, which are saved in each choice point
+struct PatternVMRegisters
+{
+    size_t myPC;                // next op
+    int    myFsLeftIx;          // leftmost matched char or -1
+    int    myFsWildIx;          // start of the current wildcard
+    int    myFsWildEndIx;       // max end of the current wildcard
+    int    myFsFixedIx;         // start of the fragment
+};
+
+
+// The interface of the verbose log to PatternVM::Run.
+class PatternTracer
+{
+public:
+    virtual ~PatternTracer();
+
+    // Called after op thePC of theCode has run.  theStatus is WS_CONTINUE
+    // if the op succeeded, WS_NO_MATCH if it failed (and the VM will
+    // backtrack, if it has any choice points), or WS_OK if the pattern
+    // matched.  theRegisters are as the op left them, and theChoicePoints
+    // are the theNumChoicePoints saved, most recent last.
+    virtual void TraceOp( const PatternCode & theCode,
+                          size_t thePC,
+                          WorkStatus_t theStatus,
+                          const PatternVMRegisters & theRegisters,
+                          const PatternVMRegisters * theChoicePoints,
+                          size_t theNumChoicePoints ) = 0;
+};
+
+
+class PatternVM
+{
+public:
+    PatternVM();
+
+    ~PatternVM();
+
+private:
+    PatternVM( const PatternVM & theOther );
+
+    const PatternVM & operator = ( const PatternVM & theOther );
+
+public:
+    // Matches theCode, which was compiled from the current pattern of
+    // theWorkData, with its From String.  Stores the wildcard occurrences
+    // and the prefix and suffix in theWorkData.
+    // Returns WS_OK if matched, or WS_NO_MATCH if not.
+    WorkStatus_t Run( const PatternCode & theCode,
+                      WorkData & theWorkData );
+
+    // Same as Run, calling theTracer after each op.
+    WorkStatus_t Run( const PatternCode & theCode,
+                      WorkData & theWorkData,
+                      PatternTracer & theTracer );
+
+    // Drops the failed states of the last Run, and frees the memory
+    // they used if there were more than theMaxKeptLength of them.
+    void Reset( size_t theMaxKeptLength );
+
+private:
+    typedef PatternVMRegisters State;
+
+    struct StateHash
+    {
+        size_t operator () ( const State & theState ) const;
+    };
+
+    struct StateEqual
+    {
+        bool operator () ( const State & theState1,
+                           const State & theState2 ) const;
+    };
+
+    // the occurrences a failed state left behind are
+    // myLeftOccurrences[myFirstOccurrence] on
+    struct Failure
+    {
+        size_t myFirstOccurrence;
+        size_t myNumOccurrences;
+    };
+
+    struct Occurrence
+    {
+        Wildcard_t myWildcard;
+        int        myStartIx;
+        int        myLength;
+    };
+
+    // a state which hasn't failed yet, and how things were when it
+    // was reached
+    struct TrailEntry
+    {
+        State  myState;
+        size_t myNumChoicePoints;
+        int    myNumOccurrences;
+    };
+
+    typedef std::unordered_map<State, Failure, StateHash, StateEqual>
+            FailureMap;
+
+    // Runs theCode; theTracer is only used if IsTraced.
+    template <bool IsTraced>
+    WorkStatus_t RunCode( const PatternCode & theCode,
+                          WorkData & theWorkData,
+                          PatternTracer * theTracer );
+
+    // Checks and stores the wildcard of theOp from theState.myFsWildIx up
+    // to theState.myFsWildEndIx.
+    bool MatchWildcard( const PatternOp & theOp,
+                        State & theState,
+                        WorkData & theWorkData );
+
+    // Called when op theOp is about to run from theState, while
+    // remembering failed states.  If theState already failed, stores the
+    // occurrences it left behind and returns false.  Otherwise adds it to
+    // myTrail if it can be remembered, and returns true.
+    bool EnterState( const PatternOp & theOp,
+                     const State & theState,
+                     size_t theNumChoicePoints,
+                     WorkData & theWorkData );
+
+    // Called after backtracking to choice point theNumChoicePoints.
+    // Every state on myTrail reached after it was saved has failed.
+    void RecordFailures( size_t theNumChoicePoints,
+                         WorkData & theWorkData );
+
+    // Returns theState as the key of myFailures, without the registers
+    // which can't change what happens after op theOp.
+    State GetFailureKey( const PatternOp & theOp,
+                         const State & theState ) const;
+
+private:
+    std::vector<State> myChoicePoints;      // never shrinks
+    FailureMap myFailures;                  // for the current Run
+    std::vector<Occurrence> myLeftOccurrences;
+    std::vector<TrailEntry> myTrail;
+};
+
+
+#endif // PATTERN_VM_H
@@ -0,0 +1,262 @@
+// FILE: prefilter.cpp
+//
+// DESCRIPTION:
+//      Implements module described in prefilter.h
+//
+// HISTORY:
+//      17-OCT-26   D.Brown     Created
+//      17-OCT-26   D.Brown     Choose the TestBlock kernel at run time
+
+#include "prefilter.h"
+#include "instr.h"
+#include "misc.h"
+#include <assert.h>
+
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#define PREFILTER_X86
+#include <immintrin.h>
+#endif
+
+
+using namespace std;
+
+
+typedef unsigned (*TestBlockKernel_t)(
+                        const UInt64_t theWords[][RULES_PER_BLOCK],
+                        const CharSetWords & theCharsUsed );
+
+
+
+void CharSetToWords( const bitset<TAGGED_CHAR_END> & theCharSet,
+                     CharSetWords & theWords )
+{
+    for ( size_t w = 0; w < CHARSET_WORDS; w++ )
+    {
+        UInt64_t word = 0;
+
+        for ( size_t b = 0; b < 64; b++ )
+        {
+            if ( theCharSet.test( w * 64 + b ) )
+            {
+                word |= (UInt64_t)1 << b;
+            }
+        }
+
+        theWords.myWords[w] = word;
+    }
+}
+
+
+
+PrefilterTable::PrefilterTable( const Program & theProgram,
+                                size_t theFirstRule ) :
+    myFirstRule( theFirstRule ),
+    myEndRule( max( theFirstRule, theProgram.size() ) )
+{
+    size_t num_rules = myEndRule - myFirstRule;
+    size_t num_blocks = (num_rules + RULES_PER_BLOCK - 1) / RULES_PER_BLOCK;
+
+    myCharBlocks.resize( num_blocks );
+    myMinLengths.resize( myEndRule, 0 );
+
+    for ( size_t i = 0; i < num_blocks * RULES_PER_BLOCK; i++ )
+    {
+        CharBlock & block = myCharBlocks[i / RULES_PER_BLOCK];
+        size_t lane = i % RULES_PER_BLOCK;
+        CharSetWords words;
+
+        if ( i < num_rules )
+        {
+            const Instr & instr = theProgram[myFirstRule + i];
+            CharSetToWords( instr.GetPatternCharsUsed(), words );
+            myMinLengths[myFirstRule + i] =
+                    instr.GetPattern().GetMinMatchLength();
+        }
+        else
+        {   // padding after the last rule never passes
+            for ( size_t w = 0; w < CHARSET_WORDS; w++ )
+            {
+                words.myWords[w] = ~(UInt64_t)0;
+            }
+        }
+
+        for ( size_t w = 0; w < CHARSET_WORDS; w++ )
+        {
+            block.myWords[w][lane] = words.myWords[w];
+        }
+    }
+}
+
+
+
+PrefilterTable::~PrefilterTable()
+{
+}
+
+
+
+// Each kernel tests the RULES_PER_BLOCK rules of theWords, one block of
+// myCharBlocks, and returns a bit mask of the rules which pass.  A rule
+// passes if (pattern_chars & ~chars_used) is zero in every word.
+
+static unsigned TestBlockScalar( const UInt64_t theWords[][RULES_PER_BLOCK],
+                                 const CharSetWords & theCharsUsed )
+{
+    unsigned mask = 0;
+
+    for ( size_t lane = 0; lane < RULES_PER_BLOCK; lane++ )
+    {
+        UInt64_t fail = 0;
+
+        for ( size_t w = 0; w < CHARSET_WORDS; w++ )
+        {
+            fail |= theWords[w][lane] & ~theCharsUsed.myWords[w];
+        }
+
+        if ( fail == 0 )
+        {
+            mask |= 1 << lane;
+        }
+    }
+
+    return mask;
+}
+
+
+
+#ifdef PREFILTER_X86
+
+__attribute__((target("sse2")))
+static unsigned TestBlockSSE2( const UInt64_t theWords[][RULES_PER_BLOCK],
+                               const CharSetWords & theCharsUsed )
+{
+    unsigned mask = 0;
+
+    for ( size_t half = 0; half < RULES_PER_BLOCK; half += 2 )
+    {
+        __m128i fail = _mm_setzero_si128();
+
+        for ( size_t w = 0; w < CHARSET_WORDS; w++ )
+        {
+            __m128i pat = _mm_load_si128( (const __m128i *)&theWords[w][half] );
+            __m128i used = _mm_set1_epi64x( (long long)theCharsUsed.myWords[w] );
+            fail = _mm_or_si128( fail, _mm_andnot_si128( used, pat ) );
+        }
+
+        // SSE2 has no 64-bit compare, so both 32-bit halves must be zero
+        unsigned zero32 = (unsigned)_mm_movemask_ps( _mm_castsi128_ps(
+                            _mm_cmpeq_epi32( fail, _mm_setzero_si128() ) ) );
+
+        if ( (zero32 & 0x3) == 0x3 )
+        {
+            mask |= 1 << half;
+        }
+
+        if ( (zero32 & 0xC) == 0xC )
+        {
+            mask |= 2 << half;
+        }
+    }
+
+    return mask;
+}
+
+
+
+__attribute__((target("avx2")))
+static unsigned TestBlockAVX2( const UInt64_t theWords[][RULES_PER_BLOCK],
+                               const CharSetWords & theCharsUsed )
+{
+    __m256i fail = _mm256_setzero_si256();
+
+    for ( size_t w = 0; w < CHARSET_WORDS; w++ )
+    {
+        __m256i pat = _mm256_load_si256( (const __m256i *)theWords[w] );
+        __m256i used = _mm256_set1_epi64x( (long long)theCharsUsed.myWords[w] );
+        fail = _mm256_or_si256( fail, _mm256_andnot_si256( used, pat ) );
+    }
+
+    __m256i pass = _mm256_cmpeq_epi64( fail, _mm256_setzero_si256() );
+
+    return (unsigned)_mm256_movemask_pd( _mm256_castsi256_pd( pass ) );
+}
+
+#endif // PREFILTER_X86
+
+
+
+static TestBlockKernel_t ChooseKernel()
+{
+#ifdef PREFILTER_X86
+    __builtin_cpu_init();
+
+    if ( __builtin_cpu_supports( "avx2" ) )
+    {
+        return TestBlockAVX2;
+    }
+
+    if ( __builtin_cpu_supports( "sse2" ) )
+    {
+        return TestBlockSSE2;
+    }
+#endif
+
+    return TestBlockScalar;
+}
+
+
+
+unsigned PrefilterTable::TestBlock( size_t theBlockIx,
+                                    const CharSetWords & theCharsUsed ) const
+{
+    static const TestBlockKernel_t kernel = ChooseKernel();
+
+    return kernel( myCharBlocks[theBlockIx].myWords, theCharsUsed );
+}
+
+
+
+size_t PrefilterTable::FindFirst( size_t theRule,
+                                  const CharSetWords & theCharsUsed ) const
+{
+    assert( theRule >= myFirstRule );
+
+    size_t num_rules = myEndRule - myFirstRule;
+    size_t r = theRule - myFirstRule;
+
+    while ( r < num_rules )
+    {
+        size_t block_ix = r / RULES_PER_BLOCK;
+        size_t lane = r % RULES_PER_BLOCK;
+        unsigned mask = TestBlock( block_ix, theCharsUsed ) >> lane;
+
+        for ( ; mask != 0; mask >>= 1, lane++ )
+        {
+            if ( (mask & 1) != 0 )
+            {
+                r = block_ix * RULES_PER_BLOCK + lane;
+                return r < num_rules ? myFirstRule + r : myEndRule;
+            }
+        }
+
+        r = (block_ix + 1) * RULES_PER_BLOCK;
+    }
+
+    return myEndRule;
+}
+
+
+
+int PrefilterTable::GetMinLength( size_t theRule ) const
+{
+    assert( theRule < myMinLengths.size() );
+
+    return myMinLengths[theRule];
+}
+
+
+
+size_t PrefilterTable::GetEndRule() const
+{
+    return myEndRule;
+}
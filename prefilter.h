@@ -0,0 +1,112 @@
+// FILE: prefilter.h
+//
+// DESCRIPTION:
+//      Defines class PrefilterTable, which holds the information needed
+//      to quickly reject the instructions of a program which cannot match
+//      a From String, without looking at the instructions themselves.
+//      It depends only on the program, so each Program builds one when
+//      it is prepared, and every Work running the program shares it.
+//
+//      The table is stored as a structure of arrays so the rules can be
+//      tested several at a time:
+//
+//          myCharBlocks:           The non-wildcard characters used by each
+//                                  pattern, as a 256-bit set stored in four
+//                                  64-bit words.  The rules are grouped in
+//                                  blocks of RULES_PER_BLOCK, and each block
+//                                  stores word 0 of every rule in the block,
+//                                  then word 1, etc., so one vector load
+//                                  gets the same word of several rules.
+//                                  Each block is aligned to a cache line.
+//
+//          myMinLengths:           The length of the shortest From String
+//                                  each pattern could match.
+//
+//      FindFirst uses AVX2 (4 rules per instruction) or SSE2 (2 rules per
+//      instruction) if the CPU has them, otherwise plain C++, as chosen
+//      at run time, like FindFragment.
+//
+//      FindFirst is only called when RuleIndex builds the candidates for
+//      a set of characters it hasn't cached, so it costs the most while
+//      a program is warming up, and with inputs whose steps keep making
+//      new sets of characters.
+//
+// HISTORY:
+//      17-OCT-26   D.Brown     Created
+//      17-OCT-26   D.Brown     Built once by the Program
+//      17-OCT-26   D.Brown     Choose the TestBlock kernel at run time
+
+#ifndef PREFILTER_H
+#define PREFILTER_H
+
+
+#include "tagged_char.h"
+#include "instr.h"
+#include "misc.h"
+#include <vector>
+#include <bitset>
+
+
+#define CHARSET_WORDS   (TAGGED_CHAR_END / 64)  // 64-bit words in a char set
+#define RULES_PER_BLOCK 4
+
+
+// a set of tagged characters, in the form used by PrefilterTable
+struct CharSetWords
+{
+    UInt64_t myWords[CHARSET_WORDS];
+};
+
+
+// converts theCharSet to theWords
+void CharSetToWords( const std::bitset<TAGGED_CHAR_END> & theCharSet,
+                     CharSetWords & theWords );
+
+
+class PrefilterTable
+{
+public:
+    // theFirstRule is the first instruction in theProgram in the table.
+    PrefilterTable( const Program & theProgram,
+                    size_t theFirstRule );
+
+    ~PrefilterTable();
+
+private:
+    PrefilterTable( const PrefilterTable & theOther );
+
+    const PrefilterTable & operator = ( const PrefilterTable & theOther );
+
+public:
+    // Returns the first instruction >= theRule whose non-wildcard
+    // pattern characters are all in theCharsUsed, or the size
+    // of the program if there are none.
+    size_t FindFirst( size_t theRule,
+                      const CharSetWords & theCharsUsed ) const;
+
+    // Returns the length of the shortest From String instruction
+    // theRule could match.
+    int GetMinLength( size_t theRule ) const;
+
+    // Returns the instruction after the last one in the table.
+    size_t GetEndRule() const;
+
+private:
+    struct alignas(64) CharBlock
+    {
+        UInt64_t myWords[CHARSET_WORDS][RULES_PER_BLOCK];
+    };
+
+    // returns a bit mask of the rules in block theBlockIx which pass
+    unsigned TestBlock( size_t theBlockIx,
+                        const CharSetWords & theCharsUsed ) const;
+
+private:
+    size_t myFirstRule;
+    size_t myEndRule;                   // size of program
+    std::vector<CharBlock> myCharBlocks;
+    std::vector<int> myMinLengths;      // indexed by instruction
+};
+
+
+#endif // PREFILTER_H
@@ -0,0 +1,289 @@
+// FILE: program_compiler.cpp
+//
+// DESCRIPTION:
+//      Implements module described in program_compiler.h
+//
+// HISTORY:
+//      17-OCT-26   D.Brown     Created
+
+#include "program_compiler.h"
+#include "shape_matcher.h"
+#include "tagged_char.h"
+#include "misc.h"
+#include <iostream>
+#include <iomanip>
+#include <sstream>
+#include <string>
+
+using namespace std;
+
+
+
+static const StrTabElement_t g_WildcardNames[] =
+{
+    { WC_QM,    "WC_QM" },
+    { WC_DOT,   "WC_DOT" },
+    { WC_DS,    "WC_DS" },
+    { WC_PCT,   "WC_PCT" },
+    { WC_STAR,  "WC_STAR" },
+    { WC_END,   "WC_END" },
+    { -1,       0 }
+};
+
+
+
+// returns the gap policy of shape_templates.h for a ShapeMatcher shape char
+static const char * GetGapPolicyName( char theKind )
+{
+    switch ( theKind )
+    {
+    case 'N':   return "NoGap";
+    case 'A':   return "AnyGap";
+    case 'U':   return "UntaggedGap";
+    case 'O':   return "OneGap";
+    case 'P':   return "OneUntaggedGap";
+    }
+
+    return 0;
+}
+
+
+
+// returns theStr as a C++ string literal
+static string QuoteString( const char * theStr )
+{
+    string quoted = "\"";
+
+    for ( const char * p = theStr; *p != 0; p++ )
+    {
+        if ( *p == '"' || *p == '\\' )
+        {
+            quoted += '\\';
+        }
+
+        quoted += *p;
+    }
+
+    return quoted + "\"";
+}
+
+
+
+// Writes an array of the chars of theStr followed by a 0, so it is
+// never empty.
+static void WriteCharArray( ostream & theOut,
+                            const string & theName,
+                            const TaggedChar_t * theChars,
+                            size_t theLen )
+{
+    theOut << "static const TaggedChar_t " << theName << "[] =" << endl;
+    theOut << "{";
+
+    for ( size_t i = 0; i < theLen; i++ )
+    {
+        theOut << (i % 10 == 0 ? "\n    " : " ") << "0x" << hex <<
+                  setw(2) << setfill('0') << (unsigned)theChars[i] <<
+                  dec << setfill(' ') << ",";
+    }
+
+    theOut << (theLen % 10 == 0 ? "\n    " : " ") << "0" << endl;
+    theOut << "};" << endl << endl;
+}
+
+
+
+static void WriteLiteralMatcher( ostream & theOut,
+                                 size_t theRuleIx,
+                                 const Pattern & thePattern )
+{
+    size_t len = thePattern.GetLength();
+
+    theOut << "static WorkStatus_t MatchRule" << theRuleIx <<
+              "( WorkData & theWorkData )" << endl;
+    theOut << "{" << endl;
+    theOut << "    int pos = theWorkData.FindSubstring( g_Pattern" <<
+              theRuleIx << ", " << len << ", 0 );" << endl << endl;
+    theOut << "    if ( pos < 0 )" << endl;
+    theOut << "    {" << endl;
+    theOut << "        return WS_NO_MATCH;" << endl;
+    theOut << "    }" << endl << endl;
+    theOut << "    theWorkData.SetPrefixAndSuffix( pos, pos + " << len <<
+              " );" << endl << endl;
+    theOut << "    return WS_OK;" << endl;
+    theOut << "}" << endl << endl;
+}
+
+
+
+static void WriteShapeMatcher( ostream & theOut,
+                               size_t theRuleIx,
+                               const ShapeMatcher & theShapeMatcher )
+{
+    const TaggedString & chars = theShapeMatcher.GetFragmentChars();
+    const vector<ShapeFragment> & frags = theShapeMatcher.GetFragments();
+    const vector<ShapeGap> & gaps = theShapeMatcher.GetGaps();
+    const string & shape = theShapeMatcher.GetShape();
+
+    ostringstream name;
+    name << "g_FragmentChars" << theRuleIx;
+    WriteCharArray( theOut, name.str(), &chars[0], chars.size() );
+
+    theOut << "static const ShapeFragment g_Fragments" << theRuleIx <<
+              "[] =" << endl;
+    theOut << "{" << endl;
+
+    for ( size_t i = 0; i < frags.size(); i++ )
+    {
+        theOut << "    { " << frags[i].myStart << ", " <<
+                  frags[i].myLength << " }," << endl;
+    }
+
+    theOut << "};" << endl << endl;
+
+    theOut << "static const ShapeGap g_Gaps" << theRuleIx << "[] =" << endl;
+    theOut << "{" << endl;
+
+    for ( size_t i = 0; i < gaps.size(); i++ )
+    {
+        const ShapeGap & gap = gaps[i];
+
+        theOut << "    { " << gap.myNumWildcards << ", { " <<
+            strtab_ValueToString( g_WildcardNames, gap.myWildcards[0] ) <<
+            ", " <<
+            strtab_ValueToString( g_WildcardNames, gap.myWildcards[1] ) <<
+            " } }," << endl;
+    }
+
+    theOut << "};" << endl << endl;
+
+    theOut << "static WorkStatus_t MatchRule" << theRuleIx <<
+              "( WorkData & theWorkData )" << endl;
+    theOut << "{" << endl;
+    theOut << "    ShapeMatchState state( theWorkData, g_FragmentChars" <<
+              theRuleIx << ", g_Fragments" << theRuleIx << ", g_Gaps" <<
+              theRuleIx << " );" << endl << endl;
+    theOut << "    if ( !MatchShape<";
+
+    for ( size_t i = 0; i < shape.size(); i++ )
+    {
+        theOut << (i == 0 ? "" : ", ") << GetGapPolicyName( shape[i] );
+    }
+
+    theOut << ">( state ) )" << endl;
+    theOut << "    {" << endl;
+    theOut << "        return WS_NO_MATCH;" << endl;
+    theOut << "    }" << endl << endl;
+    theOut << "    theWorkData.SetPrefixAndSuffix( state.myMatchStart, " <<
+              "state.myMatchEnd );" << endl << endl;
+    theOut << "    return WS_OK;" << endl;
+    theOut << "}" << endl << endl;
+}
+
+
+
+// Writes the strings and the native matcher of theInstr.
+// Returns false if it has no native matcher.
+static bool WriteRule( ostream & theOut,
+                       size_t theRuleIx,
+                       const Instr & theInstr )
+{
+    const Pattern & pat = theInstr.GetPattern();
+    const TaggedString & pat_str = theInstr.GetPatternStr();
+    const TaggedString & rep_str = theInstr.GetReplacementStr();
+
+    theOut << "//" << string( 76, '-' ) << endl;
+    theOut << "// rule " << theRuleIx << endl << "//";
+    theInstr.Print( theOut, "" );
+    theOut << endl;
+
+    ostringstream name;
+    name << "g_Pattern" << theRuleIx;
+    WriteCharArray( theOut, name.str(),
+                    pat_str.empty() ? 0 : &pat_str[0], pat_str.size() );
+
+    name.str( "" );
+    name << "g_Replacement" << theRuleIx;
+    WriteCharArray( theOut, name.str(),
+                    rep_str.empty() ? 0 : &rep_str[0], rep_str.size() );
+
+    if ( pat.IsLiteral() )
+    {
+        WriteLiteralMatcher( theOut, theRuleIx, pat );
+        return true;
+    }
+
+    if ( theInstr.GetShapeMatcher().IsBound() )
+    {
+        WriteShapeMatcher( theOut, theRuleIx, theInstr.GetShapeMatcher() );
+        return true;
+    }
+
+    return false;
+}
+
+
+
+void WriteCompiledProgram( const Program & theProgram,
+                           const char * theProgramFileName,
+                           ostream & theOut )
+{
+    theOut << "// Generated by markovc from " << theProgramFileName <<
+              ", do not edit." << endl << endl;
+    theOut << "#include \"compiled_program.h\"" << endl;
+    theOut << "#include \"shape_templates.h\"" << endl;
+    theOut << "#include \"work_data.h\"" << endl;
+    theOut << "#include \"work_status.h\"" << endl << endl << endl;
+
+    vector<bool> has_matcher( theProgram.size() );
+
+    for ( size_t i = 0; i < theProgram.size(); i++ )
+    {
+        has_matcher[i] = WriteRule( theOut, i, theProgram[i] );
+    }
+
+    theOut << "//" << string( 76, '-' ) << endl << endl;
+
+    if ( theProgram.empty() )
+    {
+        theOut << "static const CompiledRule * g_Rules = 0;" << endl;
+        theOut << "static const size_t g_NumRules = 0;" << endl;
+    }
+    else
+    {
+        theOut << "static const CompiledRule g_Rules[] =" << endl;
+        theOut << "{" << endl;
+
+        for ( size_t i = 0; i < theProgram.size(); i++ )
+        {
+            theOut << "    { " << theProgram[i].GetLineNumber() <<
+                      ", g_Pattern" << i << ", " <<
+                      theProgram[i].GetPatternStr().size() <<
+                      ", g_Replacement" << i << ", " <<
+                      theProgram[i].GetReplacementStr().size() << ", ";
+
+            if ( has_matcher[i] )
+            {
+                theOut << "MatchRule" << i;
+            }
+            else
+            {
+                theOut << "0";
+            }
+
+            theOut << " }," << endl;
+        }
+
+        theOut << "};" << endl << endl;
+        theOut << "static const size_t g_NumRules =" << endl;
+        theOut << "    sizeof(g_Rules) / sizeof(g_Rules[0]);" << endl;
+    }
+
+    theOut << endl << endl;
+    theOut << "int main( int argc, char * argv[] )" << endl;
+    theOut << "{" << endl;
+    theOut << "    return RunCompiledProgram( g_Rules, g_NumRules," << endl;
+    theOut << "                               " <<
+              QuoteString( theProgramFileName ) << "," << endl;
+    theOut << "                               argc, argv );" << endl;
+    theOut << "}" << endl;
+}
@@ -0,0 +1,36 @@
+// FILE: program_compiler.h
+//
+// DESCRIPTION:
+//      Defines WriteCompiledProgram, which markovc uses to translate a
+//      Markov program into a C++ source file.  Linked with the runtime
+//      objects and compiled_program.o, the source file is a standalone
+//      program which runs the Markov program like markov does.
+//
+//      Each rule gets a native matcher with its pattern hard-coded:
+//      literal patterns search for their chars directly, and patterns
+//      with a ShapeMatcher shape instantiate MatchShape for that shape
+//      with the fragments and gaps in static arrays.  Rules whose pattern
+//      has no such matcher are left to the PatternVM.  The pattern
+//      and replacement strings are written out as well, since the rule
+//      index, the prefilter and the replacement are built from them when
+//      the program starts.
+//
+// HISTORY:
+//      17-OCT-26   D.Brown     Created
+
+#ifndef PROGRAM_COMPILER_H
+#define PROGRAM_COMPILER_H
+
+
+#include "instr.h"
+#include <iostream>
+
+
+// Writes the C++ source for theProgram, compiled from theProgramFileName,
+// to theOut.
+void WriteCompiledProgram( const Program & theProgram,
+                           const char * theProgramFileName,
+                           std::ostream & theOut );
+
+
+#endif // PROGRAM_COMPILER_H
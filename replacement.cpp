@@ -0,0 +1,117 @@
+// FILE: replacement.cpp
+//
+// DESCRIPTION:
+//      Implements module described in replacement.h
+//
+// HISTORY:
+//      17-OCT-26   D.Brown     Created
+
+#include "replacement.h"
+#include "tagged_char.h"
+#include <assert.h>
+
+
+using namespace std;
+
+
+
+Replacement::Replacement() :
+    myLiteralLength( 0 )
+{
+}
+
+
+
+Replacement::~Replacement()
+{
+}
+
+
+
+Replacement::Replacement( const Replacement & theOther )
+{
+    *this = theOther;
+}
+
+
+
+const Replacement & Replacement::operator = ( const Replacement & theOther )
+{
+    myStr = theOther.myStr;
+    myOps = theOther.myOps;
+    myLiteralLength = theOther.myLiteralLength;
+
+    return *this;
+}
+
+
+
+void Replacement::Compile( const TaggedString & theReplacementStr )
+{
+    int uses[WC_END];
+
+    for ( size_t i = 0; i < WC_END; i++ )
+    {
+        uses[i] = 0;
+    }
+
+    myStr = theReplacementStr;
+    myOps.clear();
+    myLiteralLength = 0;
+
+    int len = (int)myStr.size();
+    int start = 0;
+
+    for ( int i = 0; i <= len; i++ )
+    {
+        Wildcard_t wt = i < len ? ToWildcard( myStr[i] ) : WC_END;
+
+        if ( i == len || wt != WC_END )
+        {
+            if ( i > start )
+            {   // span of ordinary characters before this one
+                ReplacementOp op = { WC_END, start, i - start, 0 };
+                myOps.push_back( op );
+                myLiteralLength += i - start;
+            }
+
+            if ( wt != WC_END )
+            {
+                ReplacementOp op = { wt, i, 1, uses[wt]++ };
+                myOps.push_back( op );
+            }
+
+            start = i + 1;
+        }
+    }
+}
+
+
+
+const TaggedString & Replacement::GetStr() const
+{
+    return myStr;
+}
+
+
+
+int Replacement::GetNumOps() const
+{
+    return (int)myOps.size();
+}
+
+
+
+const ReplacementOp & Replacement::GetOp( size_t op_ix ) const
+{
+    assert( op_ix < myOps.size() );
+
+    return myOps[op_ix];
+}
+
+
+
+int Replacement::GetLiteralLength() const
+{
+    return myLiteralLength;
+}
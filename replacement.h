@@ -0,0 +1,72 @@
+// FILE: replacement.h
+//
+// DESCRIPTION:
+//      Defines class Replacement, which is the compiled form of the
+//      replacement string of a transformation.  It is built once when
+//      the program is read.
+//
+//      The replacement string is compiled into a list of operations,
+//      each of which either copies a span of consecutive non-wildcard
+//      characters from the replacement string, or copies the substring
+//      of the From String matched by a wildcard.
+//
+//      A wildcard operation records how many times the same wildcard
+//      has already been used in the replacement string.  This is how
+//      multiple "*" wildcards are resolved: the Nth use of "*" copies the
+//      Nth substring matched by "*" in the pattern, wrapping around if
+//      there are more "*" in the replacement than in the pattern.
+//
+// HISTORY:
+//      17-OCT-26   D.Brown     Created
+
+#ifndef REPLACEMENT_H
+#define REPLACEMENT_H
+
+
+#include "tagged_char.h"
+#include <vector>
+
+
+// A single operation of a compiled replacement.
+struct ReplacementOp
+{
+    Wildcard_t  myWildcardType;     // WC_END means copy a span of the
+                                    // replacement string
+    int         myStart;            // start of span in replacement string
+    int         myLength;           // length of span in replacement string
+    int         myUseIx;            // # of earlier uses of this wildcard
+};
+
+
+class Replacement
+{
+public:
+    Replacement();
+
+    ~Replacement();
+
+    Replacement( const Replacement & theOther );
+
+    const Replacement & operator = ( const Replacement & theOther );
+
+    // Sets the replacement string to theReplacementStr and splits
+    // it into operations.
+    void Compile( const TaggedString & theReplacementStr );
+
+    const TaggedString & GetStr() const;
+
+    int GetNumOps() const;
+
+    const ReplacementOp & GetOp( size_t op_ix ) const;
+
+    // total number of non-wildcard chars copied by all the operations
+    int GetLiteralLength() const;
+
+private:
+    TaggedString myStr;
+    std::vector<ReplacementOp> myOps;
+    int myLiteralLength;
+};
+
+
+#endif // REPLACEMENT_H
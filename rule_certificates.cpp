@@ -0,0 +1,165 @@
+// FILE: rule_certificates.cpp
+//
+// DESCRIPTION:
+//      Implements module described in rule_certificates.h
+//
+// HISTORY:
+//      17-OCT-26   D.Brown     Created
+
+#include "rule_certificates.h"
+#include "work_data.h"
+#include "fragment_search.h"
+#include <algorithm>
+#include <assert.h>
+
+
+using namespace std;
+
+
+// If more edits than this are recorded, the certificates are all dropped
+// so the edits don't have to be kept
+static const size_t MAX_EDITS = 4096;
+
+
+
+RuleCertificates::RuleCertificates( const Program & theProgram ) :
+    myProgram( theProgram )
+{
+    Certificate none = { 0, 0, 0 };
+    myCertificates.resize( theProgram.size(), none );
+}
+
+
+
+RuleCertificates::~RuleCertificates()
+{
+}
+
+
+
+void RuleCertificates::Clear()
+{
+    for ( size_t i = 0; i < myCertificates.size(); i++ )
+    {
+        myCertificates[i].myLength = 0;
+    }
+
+    myEdits.clear();
+}
+
+
+
+bool RuleCertificates::Certify( size_t theRule,
+                                WorkData & theWorkData )
+{
+    assert( theRule < myCertificates.size() );
+
+    const Pattern & pat = myProgram[theRule].GetPattern();
+    const TaggedString & pat_str = pat.GetStr();
+    int num_frags = pat.GetNumFragments();
+
+    // A single char fragment is always in the From String, as RuleIndex
+    // only selects instructions whose pattern chars are all there.
+    for ( int f = 0; f < num_frags; f++ )
+    {
+        const PatternFragment & frag = pat.GetFragment( f );
+
+        if ( frag.myLength > 1 &&
+             theWorkData.FindSubstring( &pat_str[frag.myStart],
+                                        frag.myLength, 0 ) < 0 )
+        {
+            Certificate & cert = myCertificates[theRule];
+            cert.myChars = &pat_str[frag.myStart];
+            cert.myLength = frag.myLength;
+            cert.myNumEdits = myEdits.size();
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+
+bool RuleCertificates::Holds( size_t theRule,
+                              WorkData & theWorkData )
+{
+    Certificate & cert = myCertificates[theRule];
+
+    if ( cert.myLength == 0 )
+    {
+        return false;
+    }
+
+    if ( cert.myNumEdits == myEdits.size() )
+    {
+        return true;
+    }
+
+    // merge the edits since the certificate was checked into one range
+    // [lo, hi) of the From String, moving it as each edit changes the
+    // length of the From String before it
+    int lo = myEdits[cert.myNumEdits].myStart;
+    int hi = lo + myEdits[cert.myNumEdits].myLength;
+
+    for ( size_t e = cert.myNumEdits + 1; e < myEdits.size(); e++ )
+    {
+        const Edit & edit = myEdits[e];
+        int old_end = edit.myStart + edit.myOldLength;
+        int new_end = edit.myStart + edit.myLength;
+        int shift = edit.myLength - edit.myOldLength;
+
+        if ( lo >= old_end )
+        {
+            lo += shift;
+        }
+        else if ( lo > edit.myStart )
+        {
+            lo = edit.myStart;
+        }
+
+        if ( hi >= old_end )
+        {
+            hi += shift;
+        }
+        else if ( hi > edit.myStart )
+        {
+            hi = new_end;
+        }
+
+        lo = min( lo, edit.myStart );
+        hi = max( hi, new_end );
+    }
+
+    // the fragment can only have appeared where it overlaps the range,
+    // or straddles it if the edits only removed chars
+    const TaggedString & fs = theWorkData.GetFromStr();
+    int first = max( 0, lo - cert.myLength + 1 );
+    int end = min( (int)fs.size(), max( hi, lo + 1 ) + cert.myLength - 1 );
+
+    if ( end - first >= cert.myLength &&
+         FindFragment( &fs[0], end, first, cert.myChars,
+                       cert.myLength ) >= 0 )
+    {
+        cert.myLength = 0;
+        return false;
+    }
+
+    cert.myNumEdits = myEdits.size();
+
+    return true;
+}
+
+
+
+void RuleCertificates::AddEdit( WorkData & theWorkData )
+{
+    if ( myEdits.size() >= MAX_EDITS )
+    {
+        Clear();
+    }
+
+    Edit edit;
+    theWorkData.GetLastEdit( edit.myStart, edit.myLength, edit.myOldLength );
+    myEdits.push_back( edit );
+}
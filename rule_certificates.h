@@ -0,0 +1,97 @@
+// FILE: rule_certificates.h
+//
+// DESCRIPTION:
+//      Defines class RuleCertificates, which remembers why instructions
+//      failed to match the From String, so they aren't tried again
+//      until a step could have changed that.
+//
+//      When an instruction fails, Certify looks for a fragment of its
+//      pattern (a run of non-wildcard chars) which doesn't occur anywhere
+//      in the From String.  If there is one, that is the certificate: the
+//      pattern can't match until the fragment occurs.  A step only
+//      changes the chars in its edit window (see WorkData::GetLastEdit),
+//      so after a step the fragment can only occur somewhere overlapping
+//      the window.
+//
+//      The certificates aren't checked after every step.  Each step only
+//      adds its edit window to myEdits, and each certificate remembers how
+//      many of the edits it has been checked against.  When the
+//      instruction is next a candidate, Holds merges the windows of the
+//      edits since then into one range and searches just that range for
+//      the fragment, which costs about the size of the edits rather than
+//      the size of the From String.
+//
+//      A certificate only depends on the From String, so it doesn't
+//      matter which matcher found that the instruction failed.
+//
+// HISTORY:
+//      17-OCT-26   D.Brown     Created
+
+#ifndef RULE_CERTIFICATES_H
+#define RULE_CERTIFICATES_H
+
+
+#include "tagged_char.h"
+#include "instr.h"
+#include <vector>
+
+
+class WorkData;
+
+
+class RuleCertificates
+{
+public:
+    RuleCertificates( const Program & theProgram );
+
+    ~RuleCertificates();
+
+private:
+    RuleCertificates( const RuleCertificates & theOther );
+
+    const RuleCertificates & operator = ( const RuleCertificates & theOther );
+
+public:
+    // Drops all the certificates, for a new From String.
+    void Clear();
+
+    // Called after instruction theRule failed to match the From String
+    // of theWorkData.  Looks for a fragment of its pattern which isn't in
+    // the From String, and if there is one keeps it as the certificate.
+    // Returns true if theRule was certified.
+    bool Certify( size_t theRule,
+                  WorkData & theWorkData );
+
+    // Returns true if theRule has a certificate which still holds for
+    // the From String of theWorkData, so it can't match.  Drops the
+    // certificate if the steps since it was checked could have made the
+    // fragment occur.
+    bool Holds( size_t theRule,
+                WorkData & theWorkData );
+
+    // Called after each step, to record the edit made to the From String.
+    void AddEdit( WorkData & theWorkData );
+
+private:
+    struct Certificate
+    {
+        const TaggedChar_t * myChars;   // the missing fragment
+        int myLength;                   // 0 if not certified
+        size_t myNumEdits;              // edits it has been checked against
+    };
+
+    struct Edit
+    {
+        int myStart;
+        int myLength;                   // chars inserted
+        int myOldLength;                // chars removed
+    };
+
+private:
+    const Program & myProgram;
+    std::vector<Certificate> myCertificates;    // indexed by instruction
+    std::vector<Edit> myEdits;                  // since Clear
+};
+
+
+#endif // RULE_CERTIFICATES_H
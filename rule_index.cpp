@@ -0,0 +1,93 @@
+// FILE: rule_index.cpp
+//
+// DESCRIPTION:
+//      Implements module described in rule_index.h
+//
+// HISTORY:
+//      17-OCT-26   D.Brown     Created
+//      17-OCT-26   D.Brown     Build lists with PrefilterTable
+//      17-OCT-26   D.Brown     Use the PrefilterTable of the Program
+
+#include "rule_index.h"
+#include "instr.h"
+
+
+using namespace std;
+
+
+// If the cache has more than this many sets of characters it is cleared
+static const size_t MAX_CACHED_CHAR_SETS = 4096;
+
+
+
+RuleIndex::RuleIndex( const Program & theProgram,
+                      size_t theFirstRule ) :
+    myPrefilter( theProgram.GetPrefilter() ),
+    myFirstRule( theFirstRule )
+{
+}
+
+
+
+RuleIndex::~RuleIndex()
+{
+}
+
+
+
+const RuleList & RuleIndex::GetCandidates(
+                        const bitset<TAGGED_CHAR_END> & theCharsUsed )
+{
+    CharSetMap::iterator it = myCache.find( theCharsUsed );
+
+    if ( it == myCache.end() )
+    {
+        if ( myCache.size() >= MAX_CACHED_CHAR_SETS )
+        {
+            Clear();
+        }
+
+        it = myCache.insert( CharSetMap::value_type( theCharsUsed,
+                                                     RuleList() ) ).first;
+
+        BuildCandidates( theCharsUsed, it->second );
+    }
+
+    return it->second;
+}
+
+
+
+void RuleIndex::Clear()
+{
+    myCache.clear();
+}
+
+
+
+int RuleIndex::GetMinLength( size_t theRule ) const
+{
+    return myPrefilter.GetMinLength( theRule );
+}
+
+
+
+// an instruction is a candidate if all the non-wildcard characters
+// in its pattern are in theCharsUsed
+void RuleIndex::BuildCandidates( const bitset<TAGGED_CHAR_END> & theCharsUsed,
+                                 RuleList & theCandidates ) const
+{
+    CharSetWords chars_used;
+    CharSetToWords( theCharsUsed, chars_used );
+
+    theCandidates.clear();
+
+    size_t end_rule = myPrefilter.GetEndRule();
+
+    for ( size_t i = myPrefilter.FindFirst( myFirstRule, chars_used );
+          i < end_rule;
+          i = myPrefilter.FindFirst( i + 1, chars_used ) )
+    {
+        theCandidates.push_back( i );
+    }
+}
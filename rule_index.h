@@ -0,0 +1,85 @@
+// FILE: rule_index.h
+//
+// DESCRIPTION:
+//      Defines class RuleIndex, which selects the instructions of a
+//      program which could possibly match a From String, based only on
+//      the set of characters used by the From String.
+//
+//      An instruction can only match if every non-wildcard character in
+//      its pattern is somewhere in the From String.  Most steps of a
+//      program only change a few characters, so the set of characters in
+//      the From String repeats over and over.  RuleIndex caches, for each
+//      set of characters seen, the list of instructions from the exit step
+//      on which pass that check, in program order.  The Work class then
+//      only has to try those instructions.
+//
+//      The cache is limited to MAX_CACHED_CHAR_SETS sets of characters,
+//      and is cleared if it grows past that.  New lists are built by
+//      scanning the PrefilterTable of the Program, which also supplies the
+//      minimum From String length of each instruction.  The table is
+//      shared by every Work running the program; only the cache belongs
+//      to a RuleIndex.
+//
+// HISTORY:
+//      17-OCT-26   D.Brown     Created
+//      17-OCT-26   D.Brown     Build lists with PrefilterTable
+//      17-OCT-26   D.Brown     Use the PrefilterTable of the Program
+
+#ifndef RULE_INDEX_H
+#define RULE_INDEX_H
+
+
+#include "tagged_char.h"
+#include "instr.h"
+#include "prefilter.h"
+#include <vector>
+#include <bitset>
+#include <unordered_map>
+
+
+typedef std::vector<size_t> RuleList;
+
+
+class RuleIndex
+{
+public:
+    // theFirstRule is the first instruction in theProgram to be indexed.
+    // theProgram must be prepared.
+    RuleIndex( const Program & theProgram,
+               size_t theFirstRule );
+
+    ~RuleIndex();
+
+private:
+    RuleIndex( const RuleIndex & theOther );
+
+    const RuleIndex & operator = ( const RuleIndex & theOther );
+
+public:
+    // Returns the instructions which could match a From String using the
+    // characters in theCharsUsed.  The list remains valid until the
+    // next call.
+    const RuleList & GetCandidates(
+                        const std::bitset<TAGGED_CHAR_END> & theCharsUsed );
+
+    void Clear();
+
+    // Returns the length of the shortest From String instruction
+    // theRule could match.
+    int GetMinLength( size_t theRule ) const;
+
+private:
+    void BuildCandidates( const std::bitset<TAGGED_CHAR_END> & theCharsUsed,
+                          RuleList & theCandidates ) const;
+
+private:
+    typedef std::unordered_map<std::bitset<TAGGED_CHAR_END>, RuleList>
+        CharSetMap;
+
+    const PrefilterTable & myPrefilter;     // from the Program
+    size_t myFirstRule;
+    CharSetMap myCache;
+};
+
+
+#endif // RULE_INDEX_H
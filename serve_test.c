@@ -0,0 +1,258 @@
+/* FILE: serve_test.c
+ *
+ * DESCRIPTION:
+ *      A client of markov -serve, run by make check (see server.h for the
+ *      protocol).
+ *
+ *      Syntax: serve_test <socket> <program> <input> ...
+ *
+ *      Connects to the socket, waiting up to 5 seconds for the server to
+ *      start, and sends a transform request for each program and input
+ *      pair, then a statistics request.  For each transform it writes
+ *      what "markov <program>.mkv -i <input>" writes: the output text to
+ *      stdout, then the error, if any, to stderr.  It checks that the
+ *      statistics name each program which was found, and returns 1 if
+ *      they don't, or if the connection fails.
+ *
+ * HISTORY:
+ *      17-OCT-26   D.Brown     Created
+ */
+
+#include "libmarkov.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+
+
+#define CONNECT_TRIES       50
+#define CONNECT_WAIT_USEC   100000
+
+
+
+static int SendAll( int sock,
+                    const char * data,
+                    size_t length )
+{
+    while ( length > 0 )
+    {
+        ssize_t n = write( sock, data, length );
+
+        if ( n <= 0 )
+        {
+            return 0;
+        }
+
+        data += n;
+        length -= n;
+    }
+
+    return 1;
+}
+
+
+
+static int ReceiveAll( int sock,
+                       char * data,
+                       size_t length )
+{
+    while ( length > 0 )
+    {
+        ssize_t n = read( sock, data, length );
+
+        if ( n <= 0 )
+        {
+            return 0;
+        }
+
+        data += n;
+        length -= n;
+    }
+
+    return 1;
+}
+
+
+
+static int SendNumber( int sock,
+                       size_t number )
+{
+    unsigned char buf[4];
+
+    buf[0] = (unsigned char)( ( number >> 24 ) & 0xff );
+    buf[1] = (unsigned char)( ( number >> 16 ) & 0xff );
+    buf[2] = (unsigned char)( ( number >> 8 ) & 0xff );
+    buf[3] = (unsigned char)( number & 0xff );
+
+    return SendAll( sock, (const char *)buf, sizeof(buf) );
+}
+
+
+
+static int ReceiveNumber( int sock,
+                          size_t * number )
+{
+    unsigned char buf[4];
+
+    if ( !ReceiveAll( sock, (char *)buf, sizeof(buf) ) )
+    {
+        return 0;
+    }
+
+    *number = ( (size_t)buf[0] << 24 ) | ( (size_t)buf[1] << 16 ) |
+              ( (size_t)buf[2] << 8 ) | (size_t)buf[3];
+
+    return 1;
+}
+
+
+
+/* Receives a response, setting *status and *text, which the caller frees.
+ * Returns 0 if the connection fails. */
+static int ReceiveResponse( int sock,
+                            int * status,
+                            char ** text )
+{
+    size_t number = 0;
+    size_t length = 0;
+
+    if ( !ReceiveNumber( sock, &number ) || !ReceiveNumber( sock, &length ) )
+    {
+        return 0;
+    }
+
+    *status = (int)number;
+    *text = malloc( length + 1 );
+
+    if ( *text == 0 || !ReceiveAll( sock, *text, length ) )
+    {
+        free( *text );
+        *text = 0;
+        return 0;
+    }
+
+    (*text)[length] = 0;
+
+    return 1;
+}
+
+
+
+static int Connect( const char * name )
+{
+    struct sockaddr_un addr;
+    int tries;
+
+    if ( strlen( name ) >= sizeof(addr.sun_path) )
+    {
+        return -1;
+    }
+
+    memset( &addr, 0, sizeof(addr) );
+    addr.sun_family = AF_UNIX;
+    strcpy( addr.sun_path, name );
+
+    for ( tries = 0; tries < CONNECT_TRIES; tries++ )
+    {
+        int sock = socket( AF_UNIX, SOCK_STREAM, 0 );
+
+        if ( sock < 0 )
+        {
+            return -1;
+        }
+
+        if ( connect( sock, (struct sockaddr *)&addr, sizeof(addr) ) == 0 )
+        {
+            return sock;
+        }
+
+        close( sock );
+        usleep( CONNECT_WAIT_USEC );
+    }
+
+    return -1;
+}
+
+
+
+int main( int argc,
+          char * argv[] )
+{
+    int sock;
+    int status = 0;
+    char * text = 0;
+    char * is_found;
+    int i;
+
+    if ( argc < 2 || argc % 2 != 0 )
+    {
+        fprintf( stderr,
+                 "Syntax: serve_test <socket> <program> <input> ...\n" );
+        return 1;
+    }
+
+    is_found = calloc( argc, 1 );
+    sock = Connect( argv[1] );
+
+    if ( is_found == 0 || sock < 0 )
+    {
+        fprintf( stderr, "FAILED: can't connect to %s\n", argv[1] );
+        return 1;
+    }
+
+    for ( i = 2; i < argc; i += 2 )
+    {
+        if ( !SendAll( sock, "T", 1 ) ||
+             !SendNumber( sock, strlen( argv[i] ) ) ||
+             !SendAll( sock, argv[i], strlen( argv[i] ) ) ||
+             !SendNumber( sock, strlen( argv[i + 1] ) ) ||
+             !SendAll( sock, argv[i + 1], strlen( argv[i + 1] ) ) ||
+             !ReceiveResponse( sock, &status, &text ) )
+        {
+            fprintf( stderr, "FAILED: transform request\n" );
+            return 1;
+        }
+
+        fputs( text, stdout );
+        fflush( stdout );
+        free( text );
+
+        is_found[i] = strcmp( markov_status_str( status ),
+                              "ERROR_UNKNOWN_PROGRAM" ) != 0;
+
+        if ( status != MARKOV_OK )
+        {
+            fprintf( stderr, "Driver returns error %s\n",
+                     markov_status_str( status ) );
+        }
+    }
+
+    if ( !SendAll( sock, "S", 1 ) ||
+         !ReceiveResponse( sock, &status, &text ) )
+    {
+        fprintf( stderr, "FAILED: statistics request\n" );
+        return 1;
+    }
+
+    for ( i = 2; i < argc; i += 2 )
+    {
+        char line_start[1100];
+
+        snprintf( line_start, sizeof(line_start), "\n%s ", argv[i] );
+
+        if ( is_found[i] && argv[i][0] != 0 &&
+             strstr( text, line_start ) == 0 )
+        {
+            fprintf( stderr, "FAILED: no statistics for %s\n", argv[i] );
+            status = -1;
+        }
+    }
+
+    free( text );
+    free( is_found );
+    close( sock );
+
+    return status == MARKOV_OK ? 0 : 1;
+}
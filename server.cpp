@@ -0,0 +1,908 @@
+// FILE: server.cpp
+//
+// DESCRIPTION:
+//      Implements module described in server.h
+//
+// HISTORY:
+//      17-OCT-26   D.Brown     Created
+//      17-OCT-26   D.Brown     Write the responses from PollConnections,
+//                              without blocking
+//      17-OCT-26   D.Brown     AddProgram rejects a name already served
+//      17-OCT-26   D.Brown     Serve mode is only built with POSIX sockets
+//      17-OCT-26   D.Brown     A request which runs out of memory is answered
+//                              with WS_ERROR_OUT_OF_MEMORY
+
+#include "server.h"
+#include "markov_engine.h"
+#include <iostream>
+#include <sstream>
+#include <iomanip>
+#include <thread>
+
+// the server uses Unix domain sockets, poll and signals, which Windows
+// doesn't have in this form, so there Run just reports an error
+#if !defined(_WIN32)
+#define SERVER_POSIX
+#endif
+
+#ifdef SERVER_POSIX
+#include <errno.h>
+#include <fcntl.h>
+#include <poll.h>
+#include <signal.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#endif
+
+
+using namespace std;
+
+
+// A request with a longer program name or input closes the connection,
+// so a bad client can't make the server buffer without limit.
+#define MAX_NAME_LENGTH     1024
+#define MAX_INPUT_LENGTH    (64 * 1024 * 1024)
+
+// the length of a request type and of a number
+#define TYPE_LENGTH         1
+#define NUMBER_LENGTH       4
+
+// After a signal, the longest wait for the clients to read the responses
+// to their last requests.
+#define STOP_SECONDS        5
+
+
+struct ServedProgram
+{
+    string myName;
+    const Program * myProgram;
+
+    // guarded by Server::myStatisticsMutex
+    size_t myNumRequests;
+    size_t myNumErrors;
+    size_t myInputBytes;
+    size_t myOutputBytes;
+    double myTransformSeconds;
+};
+
+
+struct Connection
+{
+    int mySocket;
+    string myBuffer;            // received, not yet dispatched
+    string myOutput;            // the response being written
+    size_t myOutputPos;         // how much of myOutput has been written
+    bool myIsBusy;              // a request is with the workers
+
+    bool IsWriting() const { return myOutputPos < myOutput.size(); }
+};
+
+
+struct ServerRequest
+{
+    Connection * myConnection;
+    char myType;
+    size_t myProgram;           // index in myPrograms, or its size if unknown
+    string myInput;
+};
+
+
+struct ServerResponse
+{
+    Connection * myConnection;
+    string myText;
+};
+
+
+#ifdef SERVER_POSIX
+
+// The write end of the wake pipe of the running Server, for the signal
+// handler, which can't be given it any other way.
+static int g_StopPipe = -1;
+
+
+
+static void HandleStopSignal( int )
+{
+    int saved_errno = errno;
+
+    if ( g_StopPipe >= 0 )
+    {
+        char c = 'S';
+        ssize_t n = write( g_StopPipe, &c, 1 );
+        (void)n;
+    }
+
+    errno = saved_errno;
+}
+
+
+
+static size_t GetNumber( const string & theBuffer,
+                         size_t thePos )
+{
+    const unsigned char * p = (const unsigned char *)theBuffer.data() + thePos;
+
+    return ( (size_t)p[0] << 24 ) | ( (size_t)p[1] << 16 ) |
+           ( (size_t)p[2] << 8 ) | (size_t)p[3];
+}
+
+
+
+static void PutNumber( string & theBuffer,
+                       size_t theNumber )
+{
+    theBuffer.push_back( (char)( ( theNumber >> 24 ) & 0xff ) );
+    theBuffer.push_back( (char)( ( theNumber >> 16 ) & 0xff ) );
+    theBuffer.push_back( (char)( ( theNumber >> 8 ) & 0xff ) );
+    theBuffer.push_back( (char)( theNumber & 0xff ) );
+}
+
+#endif // SERVER_POSIX
+
+
+
+Server::Server( const char * theSocketName ) :
+    mySocketName( theSocketName ),
+    myListenSocket( -1 ),
+    myIsStopping( false )
+{
+    myWakePipe[0] = -1;
+    myWakePipe[1] = -1;
+}
+
+
+
+Server::~Server()
+{
+    for ( size_t i = 0; i < myPrograms.size(); i++ )
+    {
+        delete myPrograms[i];
+    }
+}
+
+
+
+WorkStatus_t Server::AddProgram( const char * theFileName,
+                                 const Program & theProgram )
+{
+    string name( theFileName );
+
+    size_t slash = name.rfind( '/' );
+
+    if ( slash != string::npos )
+    {
+        name.erase( 0, slash + 1 );
+    }
+
+    size_t dot = name.rfind( '.' );
+
+    if ( dot != string::npos && dot > 0 )
+    {
+        name.erase( dot );
+    }
+
+    for ( size_t i = 0; i < myPrograms.size(); i++ )
+    {
+        if ( myPrograms[i]->myName == name )
+        {
+            cerr << "ERROR: Program file '" << theFileName <<
+                    "' has the same name, '" << name <<
+                    "', as another served program" << endl;
+            return WS_ERROR_DUPLICATE_PROGRAM;
+        }
+    }
+
+    ServedProgram * program = new ServedProgram;
+
+    program->myName = name;
+    program->myProgram = &theProgram;
+    program->myNumRequests = 0;
+    program->myNumErrors = 0;
+    program->myInputBytes = 0;
+    program->myOutputBytes = 0;
+    program->myTransformSeconds = 0.0;
+
+    myPrograms.push_back( program );
+
+    return WS_OK;
+}
+
+
+
+#ifndef SERVER_POSIX
+
+WorkStatus_t Server::Run()
+{
+    cerr << "ERROR: Serve mode is not supported on this system" << endl;
+    return WS_ERROR_CANT_OPEN_SOCKET;
+}
+
+#else // SERVER_POSIX
+
+WorkStatus_t Server::Run()
+{
+    if ( !OpenSocket() )
+    {
+        return WS_ERROR_CANT_OPEN_SOCKET;
+    }
+
+    struct sigaction action;
+    struct sigaction old_int_action;
+    struct sigaction old_term_action;
+
+    memset( &action, 0, sizeof(action) );
+    action.sa_handler = HandleStopSignal;
+    sigemptyset( &action.sa_mask );
+
+    g_StopPipe = myWakePipe[1];
+    sigaction( SIGINT, &action, &old_int_action );
+    sigaction( SIGTERM, &action, &old_term_action );
+
+    myStartTime = chrono::steady_clock::now();
+
+    unsigned num_workers = thread::hardware_concurrency();
+
+    if ( num_workers == 0 )
+    {
+        num_workers = 1;
+    }
+
+    cerr << "Serving " << myPrograms.size() << " program(s) on " <<
+            mySocketName << " with " << num_workers << " worker(s)" << endl;
+
+    vector<thread> workers;
+
+    for ( unsigned i = 0; i < num_workers; i++ )
+    {
+        workers.push_back( thread( &Server::AnswerRequests, this ) );
+    }
+
+    PollConnections();
+
+    // the workers finish the requests they have, then return.  the
+    // clients still waiting for a response see the connection end now,
+    // rather than when the workers are done.
+    {
+        lock_guard<mutex> lock( myMutex );
+        myIsStopping = true;
+    }
+
+    myRequestReady.notify_all();
+
+    for ( size_t i = 0; i < myConnections.size(); i++ )
+    {
+        shutdown( myConnections[i]->mySocket, SHUT_RDWR );
+    }
+
+    for ( size_t i = 0; i < workers.size(); i++ )
+    {
+        workers[i].join();
+    }
+
+    sigaction( SIGINT, &old_int_action, 0 );
+    sigaction( SIGTERM, &old_term_action, 0 );
+    g_StopPipe = -1;
+
+    for ( size_t i = 0; i < myConnections.size(); i++ )
+    {
+        close( myConnections[i]->mySocket );
+        delete myConnections[i];
+    }
+
+    myConnections.clear();
+    myFinished.clear();
+
+    close( myListenSocket );
+    close( myWakePipe[0] );
+    close( myWakePipe[1] );
+    unlink( mySocketName );
+
+    cerr << GetStatistics();
+
+    return WS_OK;
+}
+
+
+
+bool Server::OpenSocket()
+{
+    struct sockaddr_un addr;
+
+    if ( strlen( mySocketName ) >= sizeof(addr.sun_path) )
+    {
+        cerr << "ERROR: Socket name '" << mySocketName <<
+                "' is too long" << endl;
+        return false;
+    }
+
+    memset( &addr, 0, sizeof(addr) );
+    addr.sun_family = AF_UNIX;
+    strcpy( addr.sun_path, mySocketName );
+
+    myListenSocket = socket( AF_UNIX, SOCK_STREAM, 0 );
+
+    int ok = ( myListenSocket >= 0 ) ? 0 : -1;
+
+    if ( ok == 0 )
+    {
+        ok = bind( myListenSocket, (struct sockaddr *)&addr, sizeof(addr) );
+
+        if ( ok != 0 && errno == EADDRINUSE )
+        {
+            // replace the socket of a server which has gone, but not
+            // one which is still answering
+            int probe = socket( AF_UNIX, SOCK_STREAM, 0 );
+
+            if ( probe >= 0 &&
+                 connect( probe, (struct sockaddr *)&addr, sizeof(addr) ) != 0 &&
+                 errno == ECONNREFUSED )
+            {
+                unlink( mySocketName );
+                ok = bind( myListenSocket, (struct sockaddr *)&addr,
+                           sizeof(addr) );
+            }
+            else
+            {
+                errno = EADDRINUSE;
+            }
+
+            if ( probe >= 0 )
+            {
+                close( probe );
+            }
+        }
+    }
+
+    if ( ok == 0 )
+    {
+        ok = listen( myListenSocket, SOMAXCONN );
+    }
+
+    if ( ok == 0 )
+    {
+        ok = fcntl( myListenSocket, F_SETFL, O_NONBLOCK );
+    }
+
+    if ( ok == 0 )
+    {
+        ok = pipe( myWakePipe );
+    }
+
+    if ( ok == 0 )
+    {
+        // a worker never waits to wake PollConnections, which is already
+        // awake if the pipe is full
+        ok = fcntl( myWakePipe[1], F_SETFL, O_NONBLOCK );
+    }
+
+    if ( ok != 0 )
+    {
+        cerr << "ERROR: Unable to listen on socket '" << mySocketName <<
+                "': " << strerror( errno ) << endl;
+
+        if ( myListenSocket >= 0 )
+        {
+            close( myListenSocket );
+            myListenSocket = -1;
+        }
+
+        return false;
+    }
+
+    return true;
+}
+
+
+
+void Server::PollConnections()
+{
+    vector<struct pollfd> fds;
+    vector<Connection *> polled;
+    bool stop = false;
+    chrono::steady_clock::time_point stop_time;
+
+    for ( ;; )
+    {
+        int timeout_ms = -1;
+
+        // after a signal, only the responses still to come are written,
+        // for up to STOP_SECONDS
+        if ( stop )
+        {
+            bool done = true;
+
+            for ( size_t i = 0; i < myConnections.size() && done; i++ )
+            {
+                done = !myConnections[i]->myIsBusy &&
+                       !myConnections[i]->IsWriting();
+            }
+
+            chrono::duration<double> waited = chrono::steady_clock::now() -
+                                              stop_time;
+
+            timeout_ms = (int)( ( STOP_SECONDS - waited.count() ) * 1000 );
+
+            if ( done || timeout_ms <= 0 )
+            {
+                break;
+            }
+        }
+
+        fds.clear();
+        polled.clear();
+
+        struct pollfd fd;
+
+        fd.fd = myWakePipe[0];
+        fd.events = POLLIN;
+        fd.revents = 0;
+        fds.push_back( fd );
+
+        fd.fd = myListenSocket;
+        fd.events = stop ? 0 : POLLIN;
+        fds.push_back( fd );
+
+        for ( size_t i = 0; i < myConnections.size(); i++ )
+        {
+            if ( myConnections[i]->IsWriting() )
+            {
+                fd.events = POLLOUT;
+            }
+            else if ( !myConnections[i]->myIsBusy && !stop )
+            {
+                fd.events = POLLIN;
+            }
+            else
+            {
+                continue;
+            }
+
+            fd.fd = myConnections[i]->mySocket;
+            fds.push_back( fd );
+            polled.push_back( myConnections[i] );
+        }
+
+        if ( poll( &fds[0], fds.size(), timeout_ms ) < 0 )
+        {
+            if ( errno == EINTR )
+            {
+                continue;
+            }
+
+            cerr << "ERROR: poll failed: " << strerror( errno ) << endl;
+            break;
+        }
+
+        if ( fds[0].revents != 0 )
+        {
+            char wake[64];
+            ssize_t n = read( myWakePipe[0], wake, sizeof(wake) );
+
+            for ( ssize_t i = 0; i < n && !stop; i++ )
+            {
+                if ( wake[i] == 'S' )
+                {
+                    stop = true;
+                    stop_time = chrono::steady_clock::now();
+                }
+            }
+        }
+
+        // start writing the responses the workers have made.  the
+        // connections which have been answered can send the next
+        // request, which may already be buffered.
+        vector<ServerResponse> finished;
+
+        {
+            lock_guard<mutex> lock( myMutex );
+            finished.swap( myFinished );
+        }
+
+        for ( size_t i = 0; i < finished.size(); i++ )
+        {
+            Connection * connection = finished[i].myConnection;
+
+            connection->myIsBusy = false;
+            connection->myOutput.swap( finished[i].myText );
+            connection->myOutputPos = 0;
+
+            if ( !WriteConnection( *connection ) ||
+                 ( !stop && !DispatchRequest( *connection ) ) )
+            {
+                CloseConnection( connection );
+            }
+        }
+
+        for ( size_t i = 0; i < polled.size(); i++ )
+        {
+            if ( fds[i + 2].revents != 0 )
+            {
+                bool ok = polled[i]->IsWriting() ?
+                              WriteConnection( *polled[i] ) :
+                              ReadConnection( *polled[i] );
+
+                if ( !ok || ( !stop && !DispatchRequest( *polled[i] ) ) )
+                {
+                    CloseConnection( polled[i] );
+                }
+            }
+        }
+
+        if ( !stop && fds[1].revents != 0 )
+        {
+            int sock = accept( myListenSocket, 0, 0 );
+
+            if ( sock >= 0 && fcntl( sock, F_SETFL, O_NONBLOCK ) != 0 )
+            {
+                close( sock );
+                sock = -1;
+            }
+
+            if ( sock >= 0 )
+            {
+                Connection * connection = new Connection;
+
+                connection->mySocket = sock;
+                connection->myOutputPos = 0;
+                connection->myIsBusy = false;
+
+                myConnections.push_back( connection );
+            }
+        }
+    }
+}
+
+
+
+bool Server::ReadConnection( Connection & theConnection )
+{
+    char buf[65536];
+
+    ssize_t n = recv( theConnection.mySocket, buf, sizeof(buf), 0 );
+
+    if ( n < 0 && ( errno == EINTR || errno == EAGAIN ||
+                    errno == EWOULDBLOCK ) )
+    {
+        return true;
+    }
+
+    if ( n <= 0 )
+    {
+        return false;
+    }
+
+    theConnection.myBuffer.append( buf, n );
+
+    return true;
+}
+
+
+
+bool Server::WriteConnection( Connection & theConnection )
+{
+    while ( theConnection.IsWriting() )
+    {
+        ssize_t n = send( theConnection.mySocket,
+                          theConnection.myOutput.data() +
+                              theConnection.myOutputPos,
+                          theConnection.myOutput.size() -
+                              theConnection.myOutputPos,
+                          MSG_NOSIGNAL );
+
+        if ( n < 0 )
+        {
+            if ( errno == EINTR )
+            {
+                continue;
+            }
+
+            return errno == EAGAIN || errno == EWOULDBLOCK;
+        }
+
+        theConnection.myOutputPos += n;
+    }
+
+    theConnection.myOutput.clear();
+    theConnection.myOutputPos = 0;
+
+    return true;
+}
+
+
+
+bool Server::DispatchRequest( Connection & theConnection )
+{
+    const string & buf = theConnection.myBuffer;
+
+    if ( buf.empty() || theConnection.myIsBusy || theConnection.IsWriting() )
+    {
+        return true;
+    }
+
+    ServerRequest request;
+
+    request.myConnection = &theConnection;
+    request.myType = buf[0];
+    request.myProgram = 0;
+
+    size_t length = TYPE_LENGTH;
+
+    if ( request.myType == 'T' )
+    {
+        if ( buf.size() < length + NUMBER_LENGTH )
+        {
+            return true;
+        }
+
+        size_t name_length = GetNumber( buf, length );
+
+        if ( name_length > MAX_NAME_LENGTH )
+        {
+            return false;
+        }
+
+        size_t name_pos = length + NUMBER_LENGTH;
+
+        length = name_pos + name_length;
+
+        if ( buf.size() < length + NUMBER_LENGTH )
+        {
+            return true;
+        }
+
+        size_t input_length = GetNumber( buf, length );
+
+        if ( input_length > MAX_INPUT_LENGTH )
+        {
+            return false;
+        }
+
+        size_t input_pos = length + NUMBER_LENGTH;
+
+        length = input_pos + input_length;
+
+        if ( buf.size() < length )
+        {
+            return true;
+        }
+
+        if ( name_length > 0 )
+        {
+            request.myProgram = myPrograms.size();
+
+            for ( size_t i = 0; i < myPrograms.size(); i++ )
+            {
+                if ( myPrograms[i]->myName.compare( 0, string::npos,
+                         buf, name_pos, name_length ) == 0 )
+                {
+                    request.myProgram = i;
+                    break;
+                }
+            }
+        }
+
+        request.myInput.assign( buf, input_pos, input_length );
+    }
+    else if ( request.myType != 'S' )
+    {
+        return false;
+    }
+
+    theConnection.myBuffer.erase( 0, length );
+    theConnection.myIsBusy = true;
+
+    {
+        lock_guard<mutex> lock( myMutex );
+        myRequests.push_back( request );
+    }
+
+    myRequestReady.notify_one();
+
+    return true;
+}
+
+
+
+void Server::CloseConnection( Connection * theConnection )
+{
+    for ( size_t i = 0; i < myConnections.size(); i++ )
+    {
+        if ( myConnections[i] == theConnection )
+        {
+            myConnections.erase( myConnections.begin() + i );
+            break;
+        }
+    }
+
+    close( theConnection->mySocket );
+    delete theConnection;
+}
+
+
+
+void Server::AnswerRequests()
+{
+    // this worker's engine for each program, made when first needed
+    vector<MarkovEngine *> engines( myPrograms.size(), 0 );
+    ServerRequest request;
+    string output;
+    string response;
+
+    for ( ;; )
+    {
+        {
+            unique_lock<mutex> lock( myMutex );
+
+            while ( myRequests.empty() && !myIsStopping )
+            {
+                myRequestReady.wait( lock );
+            }
+
+            if ( myRequests.empty() )
+            {
+                break;
+            }
+
+            request.myConnection = myRequests.front().myConnection;
+            request.myType = myRequests.front().myType;
+            request.myProgram = myRequests.front().myProgram;
+            request.myInput.swap( myRequests.front().myInput );
+            myRequests.pop_front();
+        }
+
+        WorkStatus_t status = WS_OK;
+
+        output.clear();
+
+        if ( request.myType == 'S' )
+        {
+            output = GetStatistics();
+        }
+        else if ( request.myProgram >= myPrograms.size() )
+        {
+            status = WS_ERROR_UNKNOWN_PROGRAM;
+        }
+        else
+        {
+            ServedProgram & program = *myPrograms[request.myProgram];
+
+            chrono::steady_clock::time_point start =
+                chrono::steady_clock::now();
+
+            try
+            {
+                if ( engines[request.myProgram] == 0 )
+                {
+                    engines[request.myProgram] =
+                        new MarkovEngine( *program.myProgram );
+                }
+
+                status = engines[request.myProgram]->Transform(
+                             request.myInput.data(), request.myInput.size(),
+                             output );
+            }
+            catch ( ... )
+            {
+                // out of memory: only this request fails.  the engine may
+                // have stopped part way, so the next request gets a new one.
+                delete engines[request.myProgram];
+                engines[request.myProgram] = 0;
+                string().swap( output );
+                status = WS_ERROR_OUT_OF_MEMORY;
+            }
+
+            chrono::duration<double> seconds =
+                chrono::steady_clock::now() - start;
+
+            CountRequest( program, request.myInput.size(), output.size(),
+                          seconds.count(), status );
+        }
+
+        try
+        {
+            response.clear();
+            PutNumber( response, status );
+            PutNumber( response, output.size() );
+            response.append( output );
+        }
+        catch ( ... )
+        {
+            string().swap( output );
+            string().swap( response );
+            PutNumber( response, WS_ERROR_OUT_OF_MEMORY );
+            PutNumber( response, 0 );
+        }
+
+        FinishRequest( request.myConnection, response );
+    }
+
+    for ( size_t i = 0; i < engines.size(); i++ )
+    {
+        delete engines[i];
+    }
+}
+
+
+
+void Server::FinishRequest( Connection * theConnection,
+                            string & theResponse )
+{
+    {
+        lock_guard<mutex> lock( myMutex );
+
+        myFinished.push_back( ServerResponse() );
+        myFinished.back().myConnection = theConnection;
+        myFinished.back().myText.swap( theResponse );
+    }
+
+    char c = 'W';
+    ssize_t n = write( myWakePipe[1], &c, 1 );
+    (void)n;
+}
+
+
+
+#endif // SERVER_POSIX
+
+
+
+void Server::CountRequest( ServedProgram & theProgram,
+                           size_t theInputLength,
+                           size_t theOutputLength,
+                           double theSeconds,
+                           WorkStatus_t theStatus )
+{
+    lock_guard<mutex> lock( myStatisticsMutex );
+
+    theProgram.myNumRequests++;
+    theProgram.myInputBytes += theInputLength;
+    theProgram.myOutputBytes += theOutputLength;
+    theProgram.myTransformSeconds += theSeconds;
+
+    if ( theStatus != WS_OK )
+    {
+        theProgram.myNumErrors++;
+    }
+}
+
+
+
+// one line for each program: its counts, the average time of a transform,
+// and its requests per second since the server started
+string Server::GetStatistics()
+{
+    chrono::duration<double> elapsed = chrono::steady_clock::now() -
+                                       myStartTime;
+    ostringstream out;
+
+    out << setw(16) << left << "program" << right <<
+           setw(10) << "requests" << setw(8) << "errors" <<
+           setw(14) << "input bytes" << setw(14) << "output bytes" <<
+           setw(12) << "avg ms" << setw(12) << "req/s" << '\n';
+
+    lock_guard<mutex> lock( myStatisticsMutex );
+
+    for ( size_t i = 0; i < myPrograms.size(); i++ )
+    {
+        const ServedProgram & program = *myPrograms[i];
+
+        double avg_ms = ( program.myNumRequests > 0 ) ?
+            1000.0 * program.myTransformSeconds / program.myNumRequests : 0.0;
+        double per_second = ( elapsed.count() > 0.0 ) ?
+            program.myNumRequests / elapsed.count() : 0.0;
+
+        out << setw(16) << left << program.myName << right <<
+               setw(10) << program.myNumRequests <<
+               setw(8) << program.myNumErrors <<
+               setw(14) << program.myInputBytes <<
+               setw(14) << program.myOutputBytes <<
+               fixed << setprecision(3) <<
+               setw(12) << avg_ms <<
+               setw(12) << per_second << '\n';
+    }
+
+    return out.str();
+}
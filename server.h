@@ -0,0 +1,149 @@
+// FILE: server.h
+//
+// DESCRIPTION:
+//      Defines class Server, which runs the serve mode, markov -serve.
+//      It serves one or more Markov programs on a Unix domain socket,
+//      so a client can transform its inputs without starting markov and
+//      reading the program for each one.
+//
+//      Protocol: numbers are 32 bit unsigned, most significant byte
+//      first.  A request is a byte giving its type, followed by:
+//          'T' - transform: the length and chars of the name of the
+//                program (empty for the first program), then the
+//                length and chars of the input text
+//          'S' - statistics: nothing
+//      The response to each request is its WorkStatus_t, then the length
+//      and chars of the output text, or of the statistics text for 'S'.
+//      The input and output text are as for markov in full file mode.
+//      If there is no program with the name, the status is
+//      WS_ERROR_UNKNOWN_PROGRAM.  A client can send any number of requests
+//      on a connection, and gets the responses in the same order.  A
+//      request which doesn't follow the protocol closes the connection.
+//
+//      One thread accepts the connections, reads the requests and
+//      writes the responses, and a fixed pool of worker threads, one for
+//      each hardware thread, transforms them.  Each worker keeps a
+//      MarkovEngine for each program it has run, so the Work for it is
+//      ready for the next request.  Only one request of a connection is
+//      handled at a time, and the next isn't started until the response
+//      has been written, which keeps the responses in order.  The
+//      connections are non-blocking, so a client which doesn't read its
+//      responses holds up only itself.
+//
+//      SIGINT or SIGTERM stops the server, after the requests being
+//      transformed are answered, waiting up to STOP_SECONDS for their
+//      clients to read the responses.  The statistics are then written to
+//      std::cerr.
+//
+// HISTORY:
+//      17-OCT-26   D.Brown     Created
+//      17-OCT-26   D.Brown     Write the responses from PollConnections,
+//                              without blocking
+//      17-OCT-26   D.Brown     AddProgram rejects a name already served
+
+#ifndef SERVER_H
+#define SERVER_H
+
+
+#include "instr.h"
+#include "work_status.h"
+#include <vector>
+#include <deque>
+#include <string>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+
+
+struct ServedProgram;
+struct Connection;
+struct ServerRequest;
+struct ServerResponse;
+
+
+class Server
+{
+public:
+    Server( const char * theSocketName );
+
+    ~Server();
+
+private:
+    Server( const Server & theOther );
+
+    const Server & operator = ( const Server & theOther );
+
+public:
+    // Serves theProgram, read from theFileName.  Requests name it by the
+    // file name without its directory or extension.  Must be called
+    // before Run, and theProgram must last until Run returns.  Returns
+    // WS_OK, or WS_ERROR_DUPLICATE_PROGRAM if a program with the same
+    // name has been added, which requests couldn't choose between.
+    WorkStatus_t AddProgram( const char * theFileName,
+                             const Program & theProgram );
+
+    // Serves requests until stopped by a signal.  Returns WS_OK, or
+    // WS_ERROR_CANT_OPEN_SOCKET if it can't listen on the socket.
+    WorkStatus_t Run();
+
+private:
+    bool OpenSocket();
+
+    // The thread which calls Run: accepts connections, reads their
+    // requests and writes their responses until a signal arrives, then
+    // until the requests being answered have been written.
+    void PollConnections();
+
+    // Reads what the client of theConnection has sent.  Returns false
+    // when it has closed the connection.
+    bool ReadConnection( Connection & theConnection );
+
+    // Writes as much of the response of theConnection as its socket
+    // takes without waiting.  Returns false if the client has gone.
+    bool WriteConnection( Connection & theConnection );
+
+    // Queues the first request buffered for theConnection for the
+    // workers if it is complete, and its last response has been
+    // written.  Returns false if it is invalid.
+    bool DispatchRequest( Connection & theConnection );
+
+    // Closes and deletes theConnection.
+    void CloseConnection( Connection * theConnection );
+
+    // A worker thread: answers the queued requests.
+    void AnswerRequests();
+
+    // Called by a worker when it has answered the request of
+    // theConnection, to pass theResponse to PollConnections.  Swaps
+    // theResponse, rather than copying it.
+    void FinishRequest( Connection * theConnection,
+                        std::string & theResponse );
+
+    // Adds the request counts and times of one request of theProgram.
+    void CountRequest( ServedProgram & theProgram,
+                       size_t theInputLength,
+                       size_t theOutputLength,
+                       double theSeconds,
+                       WorkStatus_t theStatus );
+
+    std::string GetStatistics();
+
+private:
+    const char * mySocketName;
+    int myListenSocket;
+    int myWakePipe[2];              // wakes PollConnections
+    std::vector<ServedProgram *> myPrograms;
+    std::vector<Connection *> myConnections;
+    std::chrono::steady_clock::time_point myStartTime;
+
+    std::mutex myMutex;             // guards the following
+    std::condition_variable myRequestReady;
+    std::deque<ServerRequest> myRequests;
+    std::vector<ServerResponse> myFinished; // for PollConnections to write
+    bool myIsStopping;
+
+    std::mutex myStatisticsMutex;   // guards the counts of myPrograms
+};
+
+
+#endif // SERVER_H
@@ -0,0 +1,345 @@
+// FILE: shape_matcher.cpp
+//
+// DESCRIPTION:
+//      Implements module described in shape_matcher.h
+//
+// HISTORY:
+//      17-OCT-26   D.Brown     Created
+//      17-OCT-26   D.Brown     Templates moved to shape_templates.h
+//      17-OCT-26   D.Brown     Check for tagged chars with WorkData
+
+#include "shape_matcher.h"
+#include "shape_templates.h"
+#include "work_data.h"
+#include "misc.h"
+#include <string>
+#include <assert.h>
+
+
+using namespace std;
+
+
+bool MatchGapWildcards( ShapeMatchState & theState,
+                        size_t theGapIx,
+                        int theStartIx,
+                        int theEndIx,
+                        bool theCheckChars )
+{
+    WorkData & work_data = theState.myWorkData;
+    const ShapeGap & gap = theState.myGaps[theGapIx];
+
+    work_data.UnmatchFromString( theStartIx );
+
+    for ( int wi = 0; wi < gap.myNumWildcards; wi++ )
+    {
+        Wildcard_t wt = gap.myWildcards[wi];
+        bool one_char = WildcardMatches1Char(wt);
+        int len = one_char ? 1 : theEndIx - theStartIx;
+
+        if ( (one_char && theStartIx >= theEndIx) ||
+             (wi + 1 == gap.myNumWildcards && theStartIx + len != theEndIx) )
+        {
+            return false;
+        }
+
+        if ( theCheckChars && WildcardMatchesOnlyUntagged(wt) &&
+             !work_data.FromSubstringIsUntagged( theStartIx,
+                                                 theStartIx + len ) )
+        {
+            return false;
+        }
+
+        if ( WildcardIsUnique(wt) &&
+             work_data.GetFirstWildcardOccurrence(wt) >= 0 )
+        {
+            if ( !work_data.CompareSubstringWithWildcard( wt, theStartIx,
+                                                          len ) )
+            {
+                return false;
+            }
+        }
+        else
+        {
+            work_data.FoundWildcard( wt, theStartIx, len );
+        }
+
+        theStartIx += len;
+    }
+
+    return true;
+}
+
+
+
+// The supported shapes, one char per gap (see ShapeMatcher::GetShape):
+//      N = GAP_NONE, A = GAP_ANY, U = GAP_UNTAGGED,
+//      O = GAP_ONE, P = GAP_ONE_UNTAGGED
+// A ? or . gap is only supported between fragments.
+struct ShapeEntry
+{
+    const char *            myShape;
+    ShapeMatcher::MatchFn_t myMatchFn;
+};
+
+static const ShapeEntry g_Shapes[] =
+{
+    // one fragment
+    { "AA",   MatchShape<AnyGap, AnyGap> },                     // *LIT*
+    { "AN",   MatchShape<AnyGap, NoGap> },                      // *LIT
+    { "NA",   MatchShape<NoGap, AnyGap> },                      // LIT*
+    { "AU",   MatchShape<AnyGap, UntaggedGap> },                // *LIT$
+    { "UA",   MatchShape<UntaggedGap, AnyGap> },                // $LIT*
+    { "UN",   MatchShape<UntaggedGap, NoGap> },                 // $LIT
+    { "NU",   MatchShape<NoGap, UntaggedGap> },                 // LIT$
+    { "UU",   MatchShape<UntaggedGap, UntaggedGap> },           // $LIT%
+    { "PN",   MatchShape<OneUntaggedGap, NoGap> },              // ?$LIT
+    { "NP",   MatchShape<NoGap, OneUntaggedGap> },              // LIT?$
+
+    // two fragments
+    { "NUN",  MatchShape<NoGap, UntaggedGap, NoGap> },          // LIT$LIT
+    { "NPN",  MatchShape<NoGap, OneUntaggedGap, NoGap> },       // LIT?$LIT
+    { "NON",  MatchShape<NoGap, OneGap, NoGap> },               // LIT?LIT
+    { "NAN",  MatchShape<NoGap, AnyGap, NoGap> },               // LIT*LIT
+    { "NUA",  MatchShape<NoGap, UntaggedGap, AnyGap> },         // LIT$LIT*
+    { "NPA",  MatchShape<NoGap, OneUntaggedGap, AnyGap> },      // LIT?$LIT*
+    { "NAA",  MatchShape<NoGap, AnyGap, AnyGap> },              // LIT*LIT*
+    { "AUA",  MatchShape<AnyGap, UntaggedGap, AnyGap> },        // *LIT$LIT*
+    { "AAA",  MatchShape<AnyGap, AnyGap, AnyGap> },             // *LIT*LIT*
+
+    // three fragments
+    { "NUAA", MatchShape<NoGap, UntaggedGap, AnyGap, AnyGap> }, // LIT$LIT*LIT*
+    { "NUAN", MatchShape<NoGap, UntaggedGap, AnyGap, NoGap> },  // LIT$LIT*LIT
+    { "NUUN", MatchShape<NoGap, UntaggedGap, UntaggedGap, NoGap> },
+                                                                // LIT$LIT%LIT
+    { "NAAA", MatchShape<NoGap, AnyGap, AnyGap, AnyGap> },      // LIT*LIT*LIT*
+};
+
+
+
+// returns the char for the kind of theGap, or 0 if it isn't supported
+static char GetGapKindChar( const ShapeGap & theGap )
+{
+    if ( theGap.myNumWildcards == 0 )
+    {
+        return 'N';
+    }
+
+    Wildcard_t first = theGap.myWildcards[0];
+
+    if ( theGap.myNumWildcards == 1 )
+    {
+        return WildcardMatchesAny(first) ? 'A' :
+               WildcardMatches1Char(first) ? 'O' : 'U';
+    }
+
+    Wildcard_t second = theGap.myWildcards[1];
+
+    if ( WildcardMatches1Char(first) &&
+         WildcardMatchesString(second) && WildcardMatchesOnlyUntagged(second) )
+    {
+        return 'P';
+    }
+
+    return 0;
+}
+
+
+
+ShapeMatcher::ShapeMatcher() :
+    myMatchFn( 0 )
+{
+}
+
+
+
+ShapeMatcher::~ShapeMatcher()
+{
+}
+
+
+
+ShapeMatcher::ShapeMatcher( const ShapeMatcher & theOther )
+{
+    *this = theOther;
+}
+
+
+
+const ShapeMatcher & ShapeMatcher::operator = ( const ShapeMatcher & theOther )
+{
+    myMatchFn = theOther.myMatchFn;
+    myShape = theOther.myShape;
+    myFragmentChars = theOther.myFragmentChars;
+    myFragments = theOther.myFragments;
+    myGaps = theOther.myGaps;
+
+    return *this;
+}
+
+
+
+void ShapeMatcher::Bind( const Pattern & thePattern )
+{
+    Clear();
+
+    if ( thePattern.IsLiteral() )
+    {   // Work::DoLiteralMatch handles these
+        return;
+    }
+
+    const TaggedString & pat = thePattern.GetStr();
+    BitSet_t wildcard_used = 0;
+    ShapeGap gap = { 0, { WC_END, WC_END } };
+    ShapeFragment frag = { 0, 0 };
+    string shape;
+
+    for ( size_t pi = 0; pi <= pat.size(); pi++ )
+    {
+        Wildcard_t wt = pi < pat.size() ? ToWildcard( pat[pi] ) : WC_END;
+
+        if ( pi == pat.size() || wt != WC_END )
+        {
+            if ( frag.myLength != 0 )
+            {
+                myFragments.push_back( frag );
+                frag.myLength = 0;
+            }
+        }
+
+        if ( pi == pat.size() || (wt == WC_END && frag.myLength == 0) )
+        {   // end of the gap before a fragment, or after the last one
+            char kind = GetGapKindChar( gap );
+
+            if ( kind == 0 )
+            {
+                Clear();
+                return;
+            }
+
+            shape += kind;
+            myGaps.push_back( gap );
+            gap.myNumWildcards = 0;
+            gap.myWildcards[0] = gap.myWildcards[1] = WC_END;
+        }
+
+        if ( pi == pat.size() )
+        {
+            break;
+        }
+
+        if ( wt == WC_END )
+        {
+            if ( frag.myLength == 0 )
+            {
+                frag.myStart = (int)myFragmentChars.size();
+            }
+
+            myFragmentChars.push_back( pat[pi] );
+            frag.myLength++;
+        }
+        else
+        {
+            if ( WildcardIsUnique(wt) )
+            {
+                if ( (wildcard_used & SET_BIT(wt)) != 0 )
+                {   // the occurrences must match each other
+                    Clear();
+                    return;
+                }
+
+                wildcard_used |= SET_BIT(wt);
+            }
+
+            if ( gap.myNumWildcards == 2 )
+            {
+                Clear();
+                return;
+            }
+
+            gap.myWildcards[gap.myNumWildcards++] = wt;
+        }
+    }
+
+    if ( myFragments.empty() || myFragments.size() > MAX_SHAPE_FRAGMENTS )
+    {
+        Clear();
+        return;
+    }
+
+    for ( size_t i = 0; i < sizeof(g_Shapes) / sizeof(g_Shapes[0]); i++ )
+    {
+        if ( shape == g_Shapes[i].myShape )
+        {
+            myMatchFn = g_Shapes[i].myMatchFn;
+            myShape = shape;
+            return;
+        }
+    }
+
+    Clear();
+}
+
+
+
+bool ShapeMatcher::IsBound() const
+{
+    return myMatchFn != 0;
+}
+
+
+
+WorkStatus_t ShapeMatcher::Match( WorkData & theWorkData ) const
+{
+    assert( myMatchFn != 0 );
+
+    ShapeMatchState state( theWorkData, &myFragmentChars[0],
+                           &myFragments[0], &myGaps[0] );
+
+    if ( !myMatchFn( state ) )
+    {
+        return WS_NO_MATCH;
+    }
+
+    theWorkData.SetPrefixAndSuffix( state.myMatchStart, state.myMatchEnd );
+
+    return WS_OK;
+}
+
+
+
+const string & ShapeMatcher::GetShape() const
+{
+    return myShape;
+}
+
+
+
+const TaggedString & ShapeMatcher::GetFragmentChars() const
+{
+    return myFragmentChars;
+}
+
+
+
+const vector<ShapeFragment> & ShapeMatcher::GetFragments() const
+{
+    return myFragments;
+}
+
+
+
+const vector<ShapeGap> & ShapeMatcher::GetGaps() const
+{
+    return myGaps;
+}
+
+
+
+void ShapeMatcher::Clear()
+{
+    myMatchFn = 0;
+    myShape.clear();
+    myFragmentChars.clear();
+    myFragments.clear();
+    myGaps.clear();
+}
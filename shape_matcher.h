@@ -0,0 +1,126 @@
+// FILE: shape_matcher.h
+//
+// DESCRIPTION:
+//      Defines class ShapeMatcher, which matches patterns of a few common
+//      shapes without running the PatternVM.
+//
+//      A pattern is viewed as a series of literal fragments (runs of
+//      non-wildcard chars), with a gap of wildcards before the first
+//      fragment, between each pair of fragments and after the last one.
+//      Each gap is one of these kinds:
+//
+//          GAP_NONE:           no wildcards
+//          GAP_ANY:            *, matches any chars
+//          GAP_UNTAGGED:       $ or %, matches 0 or more untagged chars
+//          GAP_ONE:            ? or ., matches 1 untagged char
+//          GAP_ONE_UNTAGGED:   ? or . followed by $ or %, matches
+//                              1 or more untagged chars
+//
+//      The list of gap kinds is the shape of the pattern, for example
+//      *LIT* is ANY,ANY and LIT?$LIT is NONE,ONE_UNTAGGED,NONE.  For each
+//      supported shape there is a matcher instantiated from a template
+//      on the gap kinds, so the checks for each gap are compiled in.
+//
+//      A shape matcher finds the same match as the PatternVM:
+//      each fragment is placed at its leftmost position after the
+//      previous one, backtracking to the next position if the rest of
+//      the pattern doesn't match.  The wildcard occurrences are stored
+//      and removed at the same points as by the PatternVM, so the
+//      WorkData is left with the same occurrences, including any kept
+//      from positions which were tried first.  Patterns which repeat a
+//      unique wildcard (which must then match the same string), have gaps
+//      of other kinds, or a shape without a matcher are left to
+//      the PatternVM.
+//
+//      The matcher templates are in shape_templates.h, so that markovc
+//      can instantiate them in the programs it compiles.
+//
+// HISTORY:
+//      17-OCT-26   D.Brown     Created
+//      17-OCT-26   D.Brown     Fragments and gaps as flat arrays for markovc
+
+#ifndef SHAPE_MATCHER_H
+#define SHAPE_MATCHER_H
+
+
+#include "tagged_char.h"
+#include "pattern.h"
+#include "work_status.h"
+#include <vector>
+#include <string>
+
+
+#define MAX_SHAPE_FRAGMENTS 3
+
+
+class WorkData;
+struct ShapeMatchState;
+
+
+// a literal fragment of a pattern, as an offset into an array of chars
+struct ShapeFragment
+{
+    int myStart;
+    int myLength;
+};
+
+
+// the wildcards in a gap, in pattern order
+struct ShapeGap
+{
+    int        myNumWildcards;
+    Wildcard_t myWildcards[2];
+};
+
+
+class ShapeMatcher
+{
+public:
+    ShapeMatcher();
+
+    ~ShapeMatcher();
+
+    ShapeMatcher( const ShapeMatcher & theOther );
+
+    const ShapeMatcher & operator = ( const ShapeMatcher & theOther );
+
+    // Classifies thePattern, and binds the matcher for its shape if
+    // there is one.  Otherwise the ShapeMatcher is left unbound.
+    void Bind( const Pattern & thePattern );
+
+    bool IsBound() const;
+
+    // Matches the From String of theWorkData, storing the wildcard
+    // occurrences and the prefix and suffix in theWorkData.
+    // Returns WS_OK if matched, or WS_NO_MATCH if not.
+    WorkStatus_t Match( WorkData & theWorkData ) const;
+
+    // Returns the shape, one char per gap: N = GAP_NONE, A = GAP_ANY,
+    // U = GAP_UNTAGGED, O = GAP_ONE, P = GAP_ONE_UNTAGGED.
+    // Returns "" if not bound.
+    const std::string & GetShape() const;
+
+    // the chars of all of the fragments, which index into them
+    const TaggedString & GetFragmentChars() const;
+
+    const std::vector<ShapeFragment> & GetFragments() const;
+
+    const std::vector<ShapeGap> & GetGaps() const;
+
+public:
+    typedef bool (*MatchFn_t)( ShapeMatchState & theState );
+
+private:
+    // leaves the ShapeMatcher unbound
+    void Clear();
+
+private:
+    MatchFn_t myMatchFn;                    // 0 if not bound
+    std::string myShape;
+    TaggedString myFragmentChars;
+    std::vector<ShapeFragment> myFragments;
+    std::vector<ShapeGap> myGaps;           // one more than myFragments
+};
+
+
+#endif // SHAPE_MATCHER_H
@@ -0,0 +1,263 @@
+// FILE: shape_templates.h
+//
+// DESCRIPTION:
+//      Defines the templates ShapeMatcher is built from (see
+//      shape_matcher.h).  MatchShape<Lead, Gaps...> matches a pattern
+//      whose gaps are of the kinds Lead, Gaps..., with the checks for
+//      each gap kind compiled in:
+//
+//          NoGap           GAP_NONE
+//          AnyGap          GAP_ANY
+//          UntaggedGap     GAP_UNTAGGED
+//          OneGap          GAP_ONE
+//          OneUntaggedGap  GAP_ONE_UNTAGGED
+//
+//      The fragments and gaps are passed in a ShapeMatchState, so the
+//      programs compiled by markovc can instantiate MatchShape with
+//      their fragments in static arrays.
+//
+// HISTORY:
+//      17-OCT-26   D.Brown     Created, split out of shape_matcher.cpp
+//      17-OCT-26   D.Brown     Check for tagged chars with WorkData
+
+#ifndef SHAPE_TEMPLATES_H
+#define SHAPE_TEMPLATES_H
+
+
+#include "shape_matcher.h"
+#include "work_data.h"
+#include "tagged_char.h"
+#include <string.h>
+
+
+// The state of one match, shared by the levels of the matcher.
+// Gap i is before fragment i; the last gap is after the last fragment.
+struct ShapeMatchState
+{
+    ShapeMatchState( WorkData & theWorkData,
+                     const TaggedChar_t * theFragmentChars,
+                     const ShapeFragment * theFragments,
+                     const ShapeGap * theGaps ) :
+        myWorkData( theWorkData ),
+        myFragmentChars( theFragmentChars ),
+        myFragments( theFragments ),
+        myGaps( theGaps ),
+        myFromStr( theWorkData.GetFromStr() ),
+        myMatchStart( -1 ),
+        myMatchEnd( -1 )
+    {
+    }
+
+    WorkData & myWorkData;
+    const TaggedChar_t * myFragmentChars;
+    const ShapeFragment * myFragments;
+    const ShapeGap * myGaps;
+    const TaggedString & myFromStr;
+    int myMatchStart;                   // start of the first gap
+    int myMatchEnd;                     // end of the last gap
+};
+
+
+
+// The gap kinds.  IS_VARIABLE gaps can be longer than MIN_LEN.
+struct NoGap          { enum { IS_VARIABLE = 0, MIN_LEN = 0, UNTAGGED_ONLY = 0 }; };
+struct AnyGap         { enum { IS_VARIABLE = 1, MIN_LEN = 0, UNTAGGED_ONLY = 0 }; };
+struct UntaggedGap    { enum { IS_VARIABLE = 1, MIN_LEN = 0, UNTAGGED_ONLY = 1 }; };
+struct OneGap         { enum { IS_VARIABLE = 0, MIN_LEN = 1, UNTAGGED_ONLY = 1 }; };
+struct OneUntaggedGap { enum { IS_VARIABLE = 1, MIN_LEN = 1, UNTAGGED_ONLY = 1 }; };
+
+
+
+// Matches the wildcards of gap theGapIx with the From String chars
+// from theStartIx up to theEndIx, checking them in the same order as
+// the PO_GAP_ONE and PO_GAP_VAR ops of the PatternVM.  Each occurrence
+// is stored, or compared with the first occurrence if the wildcard is
+// unique and has one.  If theCheckChars is false the chars are already
+// known to be untagged.
+//
+// First the occurrences after theStartIx are removed, as when
+// the PatternVM places a fragment.  Occurrences stored for a
+// position of the fragment which was tried before are kept if they end
+// at or before theStartIx, so that the occurrences are always the same
+// as those the PatternVM would leave.
+bool MatchGapWildcards( ShapeMatchState & theState,
+                        size_t theGapIx,
+                        int theStartIx,
+                        int theEndIx,
+                        bool theCheckChars );
+
+
+
+// true if gap kind G can match the From String chars
+// from theStartIx up to theEndIx
+template <class G>
+inline bool GapCharsOk( const ShapeMatchState & theState,
+                        int theStartIx,
+                        int theEndIx )
+{
+    return !G::UNTAGGED_ONLY ||
+           theState.myWorkData.FromSubstringIsUntagged( theStartIx,
+                                                        theEndIx );
+}
+
+
+
+// returns the first position >= theMinPos of fragment theFragIx,
+// or -1 if there is none
+inline int FindNextFragment( ShapeMatchState & theState,
+                             size_t theFragIx,
+                             int theMinPos )
+{
+    const ShapeFragment & frag = theState.myFragments[theFragIx];
+
+    return theState.myWorkData.FindSubstring(
+                    theState.myFragmentChars + frag.myStart, frag.myLength,
+                    theMinPos );
+}
+
+
+
+inline bool FragmentIsAt( const ShapeMatchState & theState,
+                          size_t theFragIx,
+                          int thePos )
+{
+    const ShapeFragment & frag = theState.myFragments[theFragIx];
+    const TaggedString & from_str = theState.myFromStr;
+
+    return thePos + frag.myLength <= (int)from_str.size() &&
+           memcmp( &from_str[thePos],
+                   theState.myFragmentChars + frag.myStart,
+                   frag.myLength ) == 0;
+}
+
+
+
+// Places fragment theFragIx, which follows a gap of kind G starting
+// at theGapStart, and then the rest of the fragments, whose gaps are
+// of kinds MoreGaps.  Returns true if everything matched.
+template <class G, class... MoreGaps>
+struct FragmentChain
+{
+    static bool Place( ShapeMatchState & theState,
+                       size_t theFragIx,
+                       int theGapStart )
+    {
+        int min_pos = theGapStart + G::MIN_LEN;
+        int frag_len = theState.myFragments[theFragIx].myLength;
+
+        if ( !G::IS_VARIABLE )
+        {   // the fragment must be right after the gap
+            if ( FragmentIsAt( theState, theFragIx, min_pos ) &&
+                 MatchGapWildcards( theState, theFragIx, theGapStart,
+                                    min_pos, true ) &&
+                 FragmentChain<MoreGaps...>::Place( theState, theFragIx + 1,
+                                                    min_pos + frag_len ) )
+            {
+                return true;
+            }
+
+            // The PatternVM also places the fragment at the
+            // later positions, which only removes the occurrences
+            if ( FindNextFragment( theState, theFragIx, min_pos + 1 ) >= 0 )
+            {
+                theState.myWorkData.UnmatchFromString( theGapStart );
+            }
+
+            return false;
+        }
+
+        int checked_to = theGapStart;   // gap chars before this are ok
+
+        for ( int pos = FindNextFragment( theState, theFragIx, min_pos );
+              pos >= 0;
+              pos = FindNextFragment( theState, theFragIx, pos + 1 ) )
+        {
+            // A later position would include the same bad chars, and
+            // trying it would leave the same occurrences as this one
+            if ( !GapCharsOk<G>( theState, checked_to, pos ) )
+            {
+                MatchGapWildcards( theState, theFragIx, theGapStart, pos,
+                                   true );
+                return false;
+            }
+
+            checked_to = pos;
+
+            if ( MatchGapWildcards( theState, theFragIx, theGapStart, pos,
+                                    false ) &&
+                 FragmentChain<MoreGaps...>::Place( theState, theFragIx + 1,
+                                                    pos + frag_len ) )
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+};
+
+
+
+// the gap after the last fragment
+template <class G>
+struct FragmentChain<G>
+{
+    static bool Place( ShapeMatchState & theState,
+                       size_t theFragIx,
+                       int theGapStart )
+    {
+        int from_len = (int)theState.myFromStr.size();
+        int gap_end = G::IS_VARIABLE ? from_len : theGapStart + G::MIN_LEN;
+
+        theState.myMatchEnd = gap_end;
+
+        return gap_end <= from_len &&
+               MatchGapWildcards( theState, theFragIx, theGapStart, gap_end,
+                                  true );
+    }
+};
+
+
+
+// Places the first fragment, which follows a gap of kind Lead, and
+// then the rest.  A variable leading gap starts at the beginning of
+// the From String; otherwise the unmatched prefix is before it.
+// Returns true if matched, with the matched part of the From String
+// in theState.myMatchStart and theState.myMatchEnd.
+template <class Lead, class... Gaps>
+bool MatchShape( ShapeMatchState & theState )
+{
+    int frag_len = theState.myFragments[0].myLength;
+    int checked_to = 0;                 // gap chars before this are ok
+
+    for ( int pos = FindNextFragment( theState, 0, Lead::MIN_LEN );
+          pos >= 0;
+          pos = FindNextFragment( theState, 0, pos + 1 ) )
+    {
+        int gap_start = Lead::IS_VARIABLE ? 0 : pos - Lead::MIN_LEN;
+
+        if ( Lead::IS_VARIABLE )
+        {   // a later position would include the same bad chars
+            if ( !GapCharsOk<Lead>( theState, checked_to, pos ) )
+            {
+                return false;
+            }
+
+            checked_to = pos;
+        }
+
+        theState.myMatchStart = gap_start;
+
+        if ( MatchGapWildcards( theState, 0, gap_start, pos,
+                                !Lead::IS_VARIABLE ) &&
+             FragmentChain<Gaps...>::Place( theState, 1, pos + frag_len ) )
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
+
+
+#endif // SHAPE_TEMPLATES_H
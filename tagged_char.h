@@ -12,6 +12,8 @@
 //
 // HISTORY:
 //      14-DEC-12   D.Brown     Created
+//      17-OCT-26   D.Brown     Added TAGGED_BIGRAM_END
+//      17-OCT-26   D.Brown     constexpr wildcard tables and functions
 
 #ifndef TAGGED_CHAR_H
 #define TAGGED_CHAR_H
@@ -29,6 +31,10 @@ typedef std::vector<TaggedChar_t> TaggedString;
 
 #define TAGGED_CHAR_END 256  // # elements in an array indexed by TaggedChar_t
 
+// # elements in an array indexed by a bigram, which is a pair of adjacent
+// chars c1 c2 stored as c1 * TAGGED_CHAR_END + c2
+#define TAGGED_BIGRAM_END (TAGGED_CHAR_END * TAGGED_CHAR_END)
+
 #define FIRST_PRINTING_CHAR 0x20        // space
 #define LAST_PRINTING_CHAR  0x7E        // ~
 
@@ -45,31 +51,128 @@ enum Wildcard_t
 };
 
 
-TaggedChar_t ToTaggedChar( char c );            // set the tag bit
+#define TAG_BIT     0x80
+#define NONTAG_BITS 0x7F
+
+
+// The properties of a wildcard.  The tables and the functions which use
+// them are all constexpr, so they are computed at compile time, there is
+// no state to initialize, and they can be used from any thread.
+struct WildcardInfo_t
+{
+    char myChar;            // needs to be tagged
+    bool myIsSingle;        // true = matches 1 char, false = matches 0 or more chars
+    bool myIsUnique;        // true = multiple occurrences in same pattern must match
+    bool myOnlyUntagged;    // true = matches only untagged chars
+};
+
+
+inline constexpr WildcardInfo_t g_WildcardInfo[WC_END] =
+{
+    { '?', true, true, true },    // WC_QM   - matches 1 untagged char, unique
+    { '.', true, true, true },    // WC_DOT  - matches 1 untagged char, unique
+    { '$', false, true, true },   // WC_DS   - matches 0 or more untagged chars, unique
+    { '%', false, true, true },   // WC_PCT  - matches 0 or more untagged chars, unique
+    { '*', false, false, false }  // WC_STAR - matches 0 or more chars, nonunique
+};
+
+
+// a Wildcard_t for each tagged char, WC_END if it isn't a wildcard
+struct CharToWildcard_t
+{
+    unsigned char myWildcard[TAGGED_CHAR_END];
+};
+
+
+constexpr CharToWildcard_t MakeCharToWildcard()
+{
+    CharToWildcard_t table = {};
+
+    for ( int c = 0; c < TAGGED_CHAR_END; c++ )
+    {
+        table.myWildcard[c] = WC_END;
+    }
+
+    for ( int i = 0; i < WC_END; i++ )
+    {
+        table.myWildcard[(unsigned char)g_WildcardInfo[i].myChar | TAG_BIT] =
+            (unsigned char)i;
+    }
+
+    return table;
+}
 
-TaggedChar_t ToUntaggedChar( char c );          // clear the tag bit
 
-char FromTaggedChar( TaggedChar_t tc );         // clear the tag bit
+inline constexpr CharToWildcard_t g_CharToWildcard = MakeCharToWildcard();
 
-bool IsTagged( TaggedChar_t tc );               // is tag bit iset
 
-TaggedChar_t GetWildcardChar( Wildcard_t wc );  // wildcards are tagged
+
+constexpr TaggedChar_t ToTaggedChar( char c )           // set the tag bit
+{
+    return (TaggedChar_t)c | TAG_BIT;
+}
+
+constexpr TaggedChar_t ToUntaggedChar( char c )         // clear the tag bit
+{
+    return (TaggedChar_t)c & NONTAG_BITS;
+}
+
+constexpr char FromTaggedChar( TaggedChar_t tc )        // clear the tag bit
+{
+    return (char)(tc & NONTAG_BITS);
+}
+
+constexpr bool IsTagged( TaggedChar_t tc )              // is tag bit iset
+{
+    return (tc & TAG_BIT) != 0;
+}
+
+constexpr TaggedChar_t GetWildcardChar( Wildcard_t wc ) // wildcards are tagged
+{
+    return ToTaggedChar( g_WildcardInfo[wc].myChar );
+}
 
 
 // if this is a wildcard char, returns it otherwise returns WC_END
-Wildcard_t ToWildcard( TaggedChar_t tc );
+constexpr Wildcard_t ToWildcard( TaggedChar_t tc )
+{
+    return (Wildcard_t)g_CharToWildcard.myWildcard[tc];
+}
 
-bool IsWildcard( TaggedChar_t tc );             // is this a wildcard?
+constexpr bool IsWildcard( TaggedChar_t tc )            // is this a wildcard?
+{
+    return ToWildcard(tc) != WC_END;
+}
 
-bool WildcardMatches1Char( Wildcard_t wc );
+constexpr bool WildcardMatches1Char( Wildcard_t wc )
+{
+    return g_WildcardInfo[wc].myIsSingle;
+}
 
-bool WildcardMatchesString( Wildcard_t wc );
+constexpr bool WildcardMatchesString( Wildcard_t wc )
+{
+    return !g_WildcardInfo[wc].myIsSingle;
+}
 
-bool WildcardMatchesOnlyUntagged( Wildcard_t wc );
+constexpr bool WildcardMatchesOnlyUntagged( Wildcard_t wc )
+{
+    return g_WildcardInfo[wc].myOnlyUntagged;
+}
+
+constexpr bool WildcardMatchesAny( Wildcard_t wc )
+{
+    return !g_WildcardInfo[wc].myOnlyUntagged;
+}
+
+constexpr bool WildcardIsUnique( Wildcard_t wc )
+{
+    return g_WildcardInfo[wc].myIsUnique;
+}
 
-bool WildcardMatchesAny( Wildcard_t wc );
 
-bool WildcardIsUnique( Wildcard_t wc );
+static_assert( ToWildcard( GetWildcardChar(WC_STAR) ) == WC_STAR &&
+               !IsWildcard( ToUntaggedChar('*') ),
+               "g_CharToWildcard must map only the tagged wildcard chars" );
 
 // sets bitset bs to the characters contained in tagged string ts
 void TaggedCharsUsed( std::bitset<TAGGED_CHAR_END> & bs,
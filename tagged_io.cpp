@@ -0,0 +1,132 @@
+// FILE: tagged_io.cpp
+//
+// DESCRIPTION:
+//      Implements module described in tagged_io.h
+//
+// HISTORY:
+//      17-OCT-26   D.Brown     Created, from driver.cpp
+
+#include "tagged_io.h"
+#include "misc.h"
+
+
+using namespace std;
+
+
+#define BACKSLASH                 '\\'
+#define SPECIAL_END_OF_LINE_CHAR '~'
+
+
+
+WorkStatus_t ReadTaggedString( istream & theInStrm,
+                               TaggedString & theInputString,
+                               unsigned & theLineNumber,
+                               bool theStopAtEndOfLine,
+                               bool theCvtTildaToTaggedTilda,
+                               bool theCvtToTagged )
+{
+    WorkStatus_t status = WS_CONTINUE;
+    bool next_is_tagged = false;
+
+    while ( status == WS_CONTINUE )
+    {
+        char c;
+        theInStrm.get( c );
+
+        if ( theInStrm && c == '\t' )       // convert tabs to spaces
+        {
+            c = ' ';
+        }
+
+        if ( !theInStrm )
+        {
+            status = WS_END_OF_FILE;     // tbd: check for read errors as well as eof
+        }
+        else if ( IsEndOfLine( theInStrm, c ) )
+        {
+            theLineNumber++;
+
+            if ( theStopAtEndOfLine )
+            {
+                status = WS_OK;
+            }
+            else 
+            {
+                theInputString.push_back( 
+                       ToTaggedChar(SPECIAL_END_OF_LINE_CHAR) );
+            }
+
+            next_is_tagged = false;
+        }
+        else
+        {
+            TaggedChar_t tc = ToUntaggedChar( c );
+
+            if ( next_is_tagged )
+            {
+                tc = ToTaggedChar( c );
+                next_is_tagged = false;
+            }
+
+            if ( theCvtToTagged && tc == '\\' )
+            {
+                next_is_tagged = true;
+            }
+            else
+            {
+                if ( c == SPECIAL_END_OF_LINE_CHAR && 
+                     theCvtTildaToTaggedTilda )
+                {
+                    theInputString.push_back( ToTaggedChar(c) );
+                }
+                else if ( c >= FIRST_PRINTING_CHAR && c <= LAST_PRINTING_CHAR )
+                {
+                    theInputString.push_back( tc );
+                }
+                // else ignore nonprinting chars
+
+                next_is_tagged = false;
+            }
+        }
+    }
+
+    return status;
+}
+
+
+
+void WriteTaggedString( ostream & theOutputStream,
+                        const TaggedString & theString,
+                        bool theConvertTildaToEoln )
+{
+    size_t len = theString.size();
+    char c = 0;
+
+    for ( size_t i = 0; i < len; i++ )
+    {
+        TaggedChar_t tc = theString[i];
+        c = ToUntaggedChar( tc );
+
+        if ( c == '\n' || 
+             ( c == SPECIAL_END_OF_LINE_CHAR && IsTagged(tc) && 
+               theConvertTildaToEoln ) )
+        {
+            theOutputStream << endl;
+            c = '\n';
+        }
+        else
+        {
+            if ( c != SPECIAL_END_OF_LINE_CHAR && IsTagged( tc ) )
+            {
+                theOutputStream.put( BACKSLASH );
+            }
+
+            theOutputStream.put( c );
+        }
+    }
+
+    if ( c != '\n' )
+    {
+        theOutputStream << endl;
+    }
+}
@@ -0,0 +1,47 @@
+// FILE: tagged_io.h
+//
+// DESCRIPTION:
+//      Converts between text, as read from an input file or written to an
+//      output file, and the TaggedString which Work transforms.  Used by
+//      Driver for its files and by MarkovEngine for its buffers, so both
+//      give the same output for the same input.
+//
+// HISTORY:
+//      17-OCT-26   D.Brown     Created, from driver.cpp
+
+#ifndef TAGGED_IO_H
+#define TAGGED_IO_H
+
+
+#include "tagged_char.h"
+#include "work_status.h"
+#include <iostream>
+
+
+// Reads from theInStrm into theInputString.
+// Updates theLineNumber at end-of-lines.
+// Converts any end-of-line characters to tagged ~.
+// If theStopAtEndOfLine then stops reading at the end of the line,
+// and doesn't add the end-of-line character to theInputString.
+// If theCvtTildaToTaggedTilda is true converts ~ to tagged ~
+// If theCvtToTagged is true \ will cause next char to be tagged.
+// Returns WS_OK if it stopped at an end-of-line, or WS_END_OF_FILE.
+WorkStatus_t ReadTaggedString( std::istream & theInStrm,
+                               TaggedString & theInputString,
+                               unsigned & theLineNumber,
+                               bool theStopAtEndOfLine,
+                               bool theCvtTildaToTaggedTilda,
+                               bool theCvtToTagged );
+
+
+// Writes theString to theOutputStream.
+// If theConvertTildaToEoln is true, any tagged ~ characters are converted
+// to end-of-lines.  Any tagged characters (other than ~) are prefixed with
+// a backspace.  If the string doesn't end with an end-of-line, 
+// terminates the line.
+void WriteTaggedString( std::ostream & theOutputStream,
+                        const TaggedString & theString,
+                        bool theConvertTildaToEoln );
+
+
+#endif // TAGGED_IO_H
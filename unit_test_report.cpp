@@ -0,0 +1,162 @@
+// FILE: unit_test_report.cpp
+//
+// DESCRIPTION:
+//      Implements module described in unit_test_report.h
+//
+// HISTORY:
+//      17-OCT-26   D.Brown     Created
+
+#include "unit_test_report.h"
+#include <stdio.h>
+
+
+using namespace std;
+
+
+
+// returns theSeconds as a string with microsecond resolution
+static string SecondsStr( double theSeconds )
+{
+    char buf[32];
+    snprintf( buf, sizeof(buf), "%.6f", theSeconds );
+    return buf;
+}
+
+
+
+// returns theStr as a double quoted YAML string
+static string YamlQuoted( const string & theStr )
+{
+    string quoted( 1, '"' );
+
+    for ( size_t i = 0; i < theStr.size(); i++ )
+    {
+        if ( theStr[i] == '"' || theStr[i] == '\\' )
+        {
+            quoted.push_back( '\\' );
+        }
+
+        quoted.push_back( theStr[i] );
+    }
+
+    quoted.push_back( '"' );
+
+    return quoted;
+}
+
+
+
+// returns theStr with the XML special characters replaced by entities
+static string XmlEscaped( const string & theStr )
+{
+    string escaped;
+
+    for ( size_t i = 0; i < theStr.size(); i++ )
+    {
+        switch ( theStr[i] )
+        {
+        case '&':   escaped.append( "&amp;" );      break;
+        case '<':   escaped.append( "&lt;" );       break;
+        case '>':   escaped.append( "&gt;" );       break;
+        case '"':   escaped.append( "&quot;" );     break;
+        case '\'':  escaped.append( "&apos;" );     break;
+        default:    escaped.push_back( theStr[i] ); break;
+        }
+    }
+
+    return escaped;
+}
+
+
+
+void WriteTapReport( ostream & theStream,
+                     const vector<UnitTestResult> & theResults )
+{
+    theStream << "TAP version 13" << endl;
+    theStream << "1.." << theResults.size() << endl;
+
+    for ( size_t i = 0; i < theResults.size(); i++ )
+    {
+        const UnitTestResult & r = theResults[i];
+
+        theStream << ( r.myStatus == WS_OK ? "ok " : "not ok " ) << i + 1 <<
+                     " - line " << r.myLineNumber << endl;
+        theStream << "  ---" << endl;
+        theStream << "  duration_ms: " << SecondsStr( r.mySeconds * 1000 ) <<
+                     endl;
+        theStream << "  steps: " << r.myNumSteps << endl;
+
+        if ( r.myStatus != WS_OK )
+        {
+            theStream << "  status: " << GetWorkStatusStr( r.myStatus ) <<
+                         endl;
+            theStream << "  input: " << YamlQuoted( r.myInput ) << endl;
+            theStream << "  output: " << YamlQuoted( r.myOutput ) << endl;
+            theStream << "  expected: " << YamlQuoted( r.myExpected ) << endl;
+        }
+
+        theStream << "  ..." << endl;
+    }
+}
+
+
+
+void WriteJUnitReport( ostream & theStream,
+                       const vector<UnitTestResult> & theResults,
+                       const char * theSuiteName,
+                       double theSeconds )
+{
+    size_t num_failures = 0;
+    size_t num_errors = 0;
+
+    for ( size_t i = 0; i < theResults.size(); i++ )
+    {
+        if ( theResults[i].myStatus == WS_ERROR_DOESNT_MATCH_EXPECTED )
+        {
+            num_failures++;
+        }
+        else if ( theResults[i].myStatus != WS_OK )
+        {
+            num_errors++;
+        }
+    }
+
+    string suite_name = XmlEscaped( theSuiteName );
+
+    theStream << "<?xml version=\"1.0\" encoding=\"UTF-8\"?>" << endl;
+    theStream << "<testsuite name=\"" << suite_name << "\" tests=\"" <<
+                 theResults.size() << "\" failures=\"" << num_failures <<
+                 "\" errors=\"" << num_errors << "\" time=\"" <<
+                 SecondsStr( theSeconds ) << "\">" << endl;
+
+    for ( size_t i = 0; i < theResults.size(); i++ )
+    {
+        const UnitTestResult & r = theResults[i];
+
+        theStream << "  <testcase classname=\"" << suite_name <<
+                     "\" name=\"line " << r.myLineNumber << "\" time=\"" <<
+                     SecondsStr( r.mySeconds ) << "\">" << endl;
+        theStream << "    <properties>" << endl;
+        theStream << "      <property name=\"steps\" value=\"" <<
+                     r.myNumSteps << "\"/>" << endl;
+        theStream << "    </properties>" << endl;
+
+        if ( r.myStatus != WS_OK )
+        {
+            const char * element =
+                r.myStatus == WS_ERROR_DOESNT_MATCH_EXPECTED ?
+                    "failure" : "error";
+
+            theStream << "    <" << element << " type=\"" <<
+                         GetWorkStatusStr( r.myStatus ) << "\">" <<
+                         "input: " << XmlEscaped( r.myInput ) << endl <<
+                         "output: " << XmlEscaped( r.myOutput ) << endl <<
+                         "expected: " << XmlEscaped( r.myExpected ) <<
+                         "</" << element << ">" << endl;
+        }
+
+        theStream << "  </testcase>" << endl;
+    }
+
+    theStream << "</testsuite>" << endl;
+}
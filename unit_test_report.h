@@ -0,0 +1,52 @@
+// FILE: unit_test_report.h
+//
+// DESCRIPTION:
+//      Defines struct UnitTestResult, the result of one case of a unit
+//      test file, and the functions which write the results of a run in
+//      a machine readable format:
+//          WriteTapReport      - Test Anything Protocol, version 13
+//          WriteJUnitReport    - JUnit XML
+//
+//      A case passes if its status is WS_OK.  A case whose output doesn't
+//      match the expected string is a failure, and one whose transformation
+//      returned an error is an error.  Each case reports its wall time and
+//      the number of transformations done.
+//
+// HISTORY:
+//      17-OCT-26   D.Brown     Created
+
+#ifndef UNIT_TEST_REPORT_H
+#define UNIT_TEST_REPORT_H
+
+
+#include "work_status.h"
+#include <vector>
+#include <string>
+#include <iostream>
+
+
+struct UnitTestResult
+{
+    unsigned myLineNumber;      // line of the input string in the test file
+    WorkStatus_t myStatus;      // WS_OK, WS_ERROR_DOESNT_MATCH_EXPECTED, or
+                                // the error from Work::DoTransformations
+    double mySeconds;           // wall time of the transformation
+    size_t myNumSteps;          // transformations done, see Work
+    std::string myInput;        // the strings as they would be written
+    std::string myOutput;       //
+    std::string myExpected;     //
+};
+
+
+void WriteTapReport( std::ostream & theStream,
+                     const std::vector<UnitTestResult> & theResults );
+
+// theSuiteName names the testsuite, typically the test file name.
+// theSeconds is the wall time of the whole run.
+void WriteJUnitReport( std::ostream & theStream,
+                       const std::vector<UnitTestResult> & theResults,
+                       const char * theSuiteName,
+                       double theSeconds );
+
+
+#endif // UNIT_TEST_REPORT_H
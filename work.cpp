@@ -7,6 +7,25 @@
 //      14-DEC-12   D.Brown     Created
 //      26-DEC-12   D.Brown     If start xform fails then error
 //      28-DEC-12   D.Brown     Don't retry same step if it succeeds
+//      17-OCT-26   D.Brown     Match using precompiled Pattern
+//      17-OCT-26   D.Brown     Replace using compiled Replacement
+//      17-OCT-26   D.Brown     Only try instructions selected by RuleIndex
+//      17-OCT-26   D.Brown     Skip instructions needing a longer string
+//      17-OCT-26   D.Brown     Only build the replaced part of the To String
+//      17-OCT-26   D.Brown     Fast path for patterns without wildcards
+//      17-OCT-26   D.Brown     Use the ShapeMatcher of the instruction
+//      17-OCT-26   D.Brown     Use the native matcher of the instruction
+//      17-OCT-26   D.Brown     Match with the PatternVM unless verbose
+//      17-OCT-26   D.Brown     Wildcards can't match past the From String
+//      17-OCT-26   D.Brown     No match if the prefix overlaps the suffix
+//      17-OCT-26   D.Brown     Skip instructions with a RuleCertificates entry
+//      17-OCT-26   D.Brown     Check the counts of repeated pattern chars
+//      17-OCT-26   D.Brown     Check the bigrams of the pattern
+//      17-OCT-26   D.Brown     Check for tagged chars with WorkData
+//      17-OCT-26   D.Brown     Added Reset
+//      17-OCT-26   D.Brown     Count the steps of DoTransformations
+//      17-OCT-26   D.Brown     Trace the PatternVM for the verbose log,
+//                              removed the PM_Level matcher
 
 #include "work.h"
 #include "work_data.h"
@@ -26,25 +45,6 @@ static const size_t EXIT_STEP  = 1;     // second step in program
 static const size_t BREAK_AT_UID = 0;
 
 
-// this struct contains everything needed for pattern matching on a
-// single level.  The Work class will contain a stack of PM_Level_t.
-// There will be one PM_Level_t for each of the wildcards in the gap
-// between fixed strings, plus one PM_Level_t for the fixed string itself.
-struct PM_Level
-{
-    size_t    myFragIx;         // current fixed fragment
-    int       myPatWildIx;      // points to current wildcard in pattern
-    int       myPatFixedIx;     // points to start of fixed part in pattern
-    int       myFsLeftIx;       // leftmost matched char or -1
-    int       myFsWildIx;       // points start of wildcard part in from string
-    int       myFsWildEndIx;    // points to max loc of wildcard part in from string
-    int       myFsFixedIx;      // points to start of fixed part in from string
-    bool      myFixedIsMatched; // myFsFixedIx points to valid matched string
-};
-
-
-
-
 Work::Work( const Program & theProgram,
             bool isVerbose,
             bool theDebugToConsole ) :
@@ -53,7 +53,13 @@ Work::Work( const Program & theProgram,
     myDebugToConsole( theDebugToConsole ),
     myPC( 0 ),
     myUID( 1 ),
-    myWorkData( *new WorkData() )
+    myNumSteps( 0 ),
+    myWorkData( *new WorkData() ),
+    myDebug( 0 ),
+    myRuleIndex( theProgram, EXIT_STEP ),
+    myCandidates( 0 ),
+    myCandidateIx( 0 ),
+    myCertificates( theProgram )
 {
 }
 
@@ -66,11 +72,27 @@ Work::~Work()
 
 
 
+void Work::Reset( size_t theMaxKeptLength )
+{
+    myPC = 0;
+    myUID = 1;
+    myNumSteps = 0;
+    myCandidates = 0;
+    myCandidateIx = 0;
+    myCertificates.Clear();
+    myPatternVM.Reset( theMaxKeptLength );
+    myWorkData.Reset( theMaxKeptLength );
+}
+
+
+
 WorkStatus_t Work::DoTransformations(
                          const TaggedString & theInputString,
                          TaggedString & theOutputString,
                          ofstream * theDebug )
 {
+    myDebug = theDebug;
+    myWorkData.ClearFromString();
     myWorkData.ClearToString();
     myWorkData.AppendStringToToString( theInputString );
     myWorkData.MoveToStringToFromString();
@@ -87,6 +109,8 @@ WorkStatus_t Work::DoTransformations(
 
     size_t pgm_size = myProgram.size();
     myPC = START_STEP;
+    myNumSteps = 0;
+    myCertificates.Clear();
     WorkStatus_t status = WS_CONTINUE;
 
     while ( status == WS_CONTINUE )
@@ -97,23 +121,26 @@ WorkStatus_t Work::DoTransformations(
         }
         else
         {
-            status = QuickCheckPattern( myProgram[myPC].GetPatternCharsUsed() );
+            // instructions after the start step are only tried if
+            // they were selected by FirstCandidate/NextCandidate
+            status = myPC != START_STEP ? WS_CONTINUE :
+                     QuickCheckPattern( myProgram[myPC] );
 
             if ( status == WS_CONTINUE )
             {
-                myWorkData.SetCurrentPattern(
-                                myProgram[myPC].GetPatternStr() );
+                myWorkData.SetCurrentPattern( myProgram[myPC].GetPattern() );
 
-                status = DoPatternMatch( myProgram[myPC].GetPatternStr(),
-                                         theDebug );
+                status = DoInstrMatch( myProgram[myPC] );
 
                 if ( status == WS_OK )
                 {
                     status = DoReplacement(
-                                    myProgram[myPC].GetReplacementStr() );
+                                    myProgram[myPC].GetReplacement() );
 
                     if ( status == WS_CONTINUE )
                     {
+                        myNumSteps++;
+
                         if ( myDebugToConsole )
                         {
                             DebugPrintTransition(cout);
@@ -130,8 +157,9 @@ WorkStatus_t Work::DoTransformations(
                         }
                         else
                         {   // start over from exit step
-                            myPC = EXIT_STEP;
                             myWorkData.MoveToStringToFromString();
+                            myCertificates.AddEdit( myWorkData );
+                            FirstCandidate();
                             status = WS_CONTINUE;
                         }
                     }
@@ -148,8 +176,14 @@ WorkStatus_t Work::DoTransformations(
                 }
                 else
                 {
+                    // the verbose log shows every instruction tried
+                    if ( !myIsVerbose )
+                    {
+                        myCertificates.Certify( myPC, myWorkData );
+                    }
+
                     status = WS_CONTINUE;
-                    myPC++;
+                    NextCandidate();
                 }
             }
         }
@@ -175,381 +209,182 @@ WorkStatus_t Work::DoTransformations(
 
 
 
-WorkStatus_t Work::QuickCheckPattern(
-                    const bitset<TAGGED_CHAR_END> & thePatternCharsUsed )
+size_t Work::GetNumSteps() const
 {
-    const bitset<TAGGED_CHAR_END> & from_chars =
-        myWorkData.GetFromStrCharsUsed();
+    return myNumSteps;
+}
 
-    bitset<TAGGED_CHAR_END> tmp = thePatternCharsUsed & (~from_chars);
 
-    return tmp.any() ? WS_NO_MATCH : WS_CONTINUE;
-}
 
+void Work::FirstCandidate()
+{
+    myCandidates = &myRuleIndex.GetCandidates(
+                            myWorkData.GetFromStrCharsUsed() );
+    myCandidateIx = 0;
+    SkipRejectedCandidates();
+}
 
 
 
-WorkStatus_t Work::DoReplacement( const TaggedString & theReplacementStr )
+void Work::NextCandidate()
 {
-    int cur_wildcard_occurrence[WC_END];
-    myWorkData.ClearToString();
+    assert( myCandidates != 0 );
 
-    for ( size_t i = 0; i < WC_END; i++ )
-    {
-        cur_wildcard_occurrence[i] = -1;
-    }
+    myCandidateIx++;
+    SkipRejectedCandidates();
+}
 
-    int prefix_len;
-    int suffix_start;
-    int suffix_len;
-    myWorkData.GetPrefixAndSuffix( prefix_len,
-                                   suffix_start, suffix_len );
 
-    const TaggedString & fromstr = myWorkData.GetFromStr();
 
-    for ( int i = 0; i < prefix_len; i++ )
-    {
-        TaggedChar_t tc = fromstr[i];
-        myWorkData.AppendCharToToString( tc );
-    }
+void Work::SkipRejectedCandidates()
+{
+    int from_len = (int)myWorkData.GetFromStr().size();
+    size_t num_candidates = myCandidates->size();
 
-    for ( size_t i = 0; i < theReplacementStr.size(); i++ )
+    while ( myCandidateIx < num_candidates )
     {
-        TaggedChar_t tc = theReplacementStr[i];
-        Wildcard_t wt = ToWildcard(tc);
+        size_t rule = (*myCandidates)[myCandidateIx];
 
-        if ( wt == WC_END )
-        {   // ordinary character
-            myWorkData.AppendCharToToString( tc );
-        }
-        else
-        {   // wildcard char
-            myWorkData.GetNextWildcardOccurrence(
-                            wt, cur_wildcard_occurrence[wt] );
-
-            if ( cur_wildcard_occurrence[wt] < 0 )
-            {
-                return WS_ERROR_REPLACE_STR_BAD_WILDCARD;
-            }
-            else
-            {
-                myWorkData.AppendWildcardOccurrenceToToString(
-                                        cur_wildcard_occurrence[wt] );
-            }
+        if ( myRuleIndex.GetMinLength( rule ) <= from_len &&
+             HasRepeatedChars( myProgram[rule].GetPattern() ) &&
+             HasBigrams( myProgram[rule].GetPattern() ) &&
+             !myCertificates.Holds( rule, myWorkData ) )
+        {
+            break;
         }
-    }
 
-    for ( int i = 0; i < suffix_len; i++ )
-    {
-        TaggedChar_t tc = fromstr[suffix_start + i];
-        myWorkData.AppendCharToToString( tc );
+        myCandidateIx++;
     }
 
-    return WS_CONTINUE;
+    myPC = myCandidateIx < num_candidates ?
+                (*myCandidates)[myCandidateIx] : myProgram.size();
 }
 
 
 
-WorkStatus_t Work::DoPatternMatch( const TaggedString & pat,
-                                   ofstream * theDebug )
+WorkStatus_t Work::QuickCheckPattern( const Instr & theInstr )
 {
-    WorkStatus_t status = WS_CONTINUE;
-
-    PM_Level top = { 0, 0, 0, -1, 0, 0, 0, false  };
-    myStack.clear();
-    myStack.push_back( top );
-    while ( status == WS_CONTINUE && !myStack.empty() )
-    {
-        status = DoPatternMatch1();
-
-        if ( myIsVerbose )
-        {
-            if ( myDebugToConsole )
-            {
-                PrintWorkState( cout, status );
-            }
-
-            if ( theDebug != 0 )
-            {
-                PrintWorkState( *theDebug, status );
-            }
-        }
-
-        if ( (theDebug != 0 || myDebugToConsole) &&
-            BREAK_AT_UID != 0 && BREAK_AT_UID == myUID )
-        {
-            TriggerBreakpoint();
-        }
+    const bitset<TAGGED_CHAR_END> & from_chars =
+        myWorkData.GetFromStrCharsUsed();
 
-        myUID++;
+    bitset<TAGGED_CHAR_END> tmp = theInstr.GetPatternCharsUsed() &
+                                  (~from_chars);
 
-        if ( status == WS_NO_MATCH && !myStack.empty() )
-        {   // no match, but still more stuff to try on the stack
-            status = WS_CONTINUE;
-        }
+    if ( tmp.any() )
+    {
+        return WS_NO_MATCH;
     }
 
-    if ( status == WS_CONTINUE && myStack.empty() )
+    const Pattern & pat = theInstr.GetPattern();
+
+    if ( pat.GetMinMatchLength() > (int)myWorkData.GetFromStr().size() ||
+         !HasRepeatedChars( pat ) || !HasBigrams( pat ) )
     {
-        status = WS_ERROR_STACK_EMPTY;
+        return WS_NO_MATCH;
     }
 
-    return status;
+    return WS_CONTINUE;
 }
 
 
 
-// This is the meat of the pattern matching.
-// It has two phases for each fragment, the first advances the
-// pattern fragment to the next matching substring in the from string,
-// and the second process the gap before the fragment (which are the
-// consecutive wildcards before the start of the fragment).  It will
-// return between the phases, so DoPatternMatch1 can print out the stack.
-WorkStatus_t Work::DoPatternMatch1()
+bool Work::HasRepeatedChars( const Pattern & thePattern ) const
 {
-    PM_Level top = myStack.back();
-    myStack.pop_back();
-    WorkStatus_t status = WS_CONTINUE;
-    size_t num_frags = myWorkData.GetNumPatternFragments();
+    const vector<PatternCharCount> & repeated = thePattern.GetRepeatedChars();
 
-    if ( !top.myFixedIsMatched )
+    for ( size_t i = 0; i < repeated.size(); i++ )
     {
-        status = PlaceFixedFragment( top );
-
-        if ( status == WS_CONTINUE )
-        {
-            myWorkData.UnmatchFromString( top.myFsWildIx );
-        }
-
-        if ( status == WS_CONTINUE &&
-             top.myFragIx < num_frags )
-        {   // push following occurrence of fragment onto stack below top
-            int len = myWorkData.GetPatFragLengthInFromStr(top.myFragIx);
-            assert( len >= 0 ); // if wildcard it should be matched
-            const TaggedString & fromstr = myWorkData.GetFromStr();
-
-            if ( top.myFsFixedIx + len < (int)fromstr.size() )
-            {   // we have characters in FromStr after this fragment
-                PM_Level next = top;
-                next.myFsFixedIx++;
-                next.myFixedIsMatched = false;
-                myStack.push_back( next );
-            }
-        }
-
-        if ( status == WS_CONTINUE )
+        if ( myWorkData.GetFromStrCharCount( repeated[i].myChar ) <
+                repeated[i].myCount )
         {
-            myStack.push_back( top );
+            return false;
         }
     }
-    else
-    {
-        bool top_changed = false;
-
-        myWorkData.UnmatchFromString( top.myFsWildIx );
 
-        if ( top.myPatWildIx < top.myPatFixedIx )
-        {
-            status = TryToFillGap( top, top_changed );
-
-            if ( status == WS_CONTINUE )
-            {
-                MaybePushNextWildcardAttempt( top );
-            }
+    return true;
+}
 
-            if ( status == WS_CONTINUE )
-            {
-                status = CheckAndHandleWildcard( top );
-                top_changed = status == WS_CONTINUE;
-            }
-        }
 
-        if ( status == WS_CONTINUE && top_changed &&
-             top.myPatWildIx < top.myPatFixedIx )
-        {
-            myStack.push_back( top );
-        }
 
-        if ( status == WS_CONTINUE &&
-             top.myFragIx <= num_frags && num_frags != 0 &&
-             top.myPatWildIx == top.myPatFixedIx )
-        {
-            PushAdvanceToNextFrag( top );
-        }
+bool Work::HasBigrams( const Pattern & thePattern ) const
+{
+    const vector<int> & bigrams = thePattern.GetBigrams();
 
-        if ( status == WS_CONTINUE &&
-             top.myFragIx == num_frags &&
-             top.myPatWildIx == top.myPatFixedIx )
+    for ( size_t i = 0; i < bigrams.size(); i++ )
+    {
+        if ( myWorkData.GetFromStrBigramCount( bigrams[i] ) == 0 )
         {
-            status = WS_OK;
-            myWorkData.SetPrefixAndSuffix(
-                    top.myFsLeftIx >= 0 ? top.myFsLeftIx : top.myFsWildIx,
-                    top.myFsFixedIx );
+            return false;
         }
     }
 
-    return status;
+    return true;
 }
 
 
 
-// This method will advance the top.myFsFixedIx pointer until it points
-// to the next occurrence of this fixed fragment in the from string.
-// This also will determine the size of the gap before the first fragment,
-// after the last fragment and in the case where there are no fragments.
-
-// If there are no fragments, and there are any *$% wildcards, the gap
-// will consist of the entire From String, otherwise the gap will start at
-// the beginning of the From String and its length will be the number
-// of ?. wildcards.  i.e. "*" matches the entire string, "?" matched
-// only the first char of the string.
-
-// If there are any *$% wildcards in the gap before the first fragment,
-// the gap will consist of everything from the beginning of the From String
-// to the start of the fragment, otherwise the gap will consist of the count
-// of the number of ?. wildcards just before the fragment.
-// ie: for "*A" the * will match everything before the first occurrence of A,
-// and for ".A" the . will match the character before the first A.
-
-// If there are any *$% wildcards in the gap after the last fragment,
-// the gap will consist of everything from the end of the last fragment to
-// the end of the string, otherwise the gap will consist of only the count of
-// ?. wildcards just after the last fragment.
-// ie: for "A*" the * will match everything from the first A on,
-// and for "A." the . will match the character after the first A.
 
-WorkStatus_t Work::PlaceFixedFragment( PM_Level & top )
+WorkStatus_t Work::DoReplacement( const Replacement & theReplacement )
 {
     WorkStatus_t status = WS_CONTINUE;
-    const TaggedString & pat = myWorkData.GetCurPat();
-    const TaggedString & fs = myWorkData.GetFromStr();
-    size_t num_frags = myWorkData.GetNumPatternFragments();
+    myWorkData.ClearToString();
+    myWorkData.IndexWildcardOccurrences();
 
-    if ( num_frags == 0 )
-    {
-        int max_span = MaxWildcardSpan( 0, pat.size() );
-        top.myPatWildIx = 0;
-        top.myPatFixedIx = (int)pat.size();
-        top.myFsFixedIx = (int)fs.size();
-        top.myFsWildIx = max_span == -1 ? 0 : max_span;
-        top.myFsWildEndIx = top.myFsFixedIx;
-        top.myFixedIsMatched = true;
-    }
-    else if ( top.myFragIx == num_frags )
-    {   // after last fragment.
-        // set myPatWildIx to end of previous fragment, and
-        // myPatFixedIx to the end of the pattern
-        int prev_pat_fixed_start =
-                myWorkData.GetPatFragStartInPat( top.myFragIx-1 );
-        int prev_pat_fixed_len =
-                myWorkData.GetPatFragLengthInPat( top.myFragIx-1 );
-        top.myPatWildIx = prev_pat_fixed_start + prev_pat_fixed_len;
-        top.myPatFixedIx = (int)pat.size();
-
-        // Set myFsWildIx to the end of the previous fragment.
-        // If any *$% wildcards, then gap will end at the
-        // end of the from string, otherwise gap will be the number of
-        // ?. wildcards
-        int prev_fs_frag_start;
-        int prev_fs_frag_len;
-        myWorkData.GetPatFragStartLengthInFromStr(
-                                    top.myFragIx-1, prev_fs_frag_start,
-                                    prev_fs_frag_len );
-        assert( prev_fs_frag_start >= 0 && prev_fs_frag_len >= 0 );
-        top.myFsWildIx = prev_fs_frag_start + prev_fs_frag_len;
-        int max_span = MaxWildcardSpan( top.myPatWildIx, top.myPatFixedIx );
-        top.myFsFixedIx =
-                max_span == -1 ? (int)fs.size() : top.myFsWildIx + max_span;
-        top.myFsWildEndIx = top.myFsFixedIx;
-        top.myFixedIsMatched = true;
-    }
-    else
+    // first pass: check the wildcards and compute the length of the
+    // replaced part of the To String
+    int num_ops = theReplacement.GetNumOps();
+    int num_good_ops = 0;
+    size_t to_len = theReplacement.GetLiteralLength();
+
+    for ( ; num_good_ops < num_ops; num_good_ops++ )
     {
-        int pat_wild_start = myWorkData.GetPatFragStartInPat( top.myFragIx);
-        bool matched;
-        if ( top.myFragIx > 0 && top.myPatWildIx == pat_wild_start )
-        {   // no wildcards in gap before fixed string
-            matched = myWorkData.VerifyPatFragPos( top.myFragIx, top.myFsFixedIx );
-        }
-        else
-        {
-            matched = myWorkData.AdvancePatFragPos( top.myFragIx, top.myFsFixedIx );
-        }
+        const ReplacementOp & op = theReplacement.GetOp( num_good_ops );
 
-        if ( matched )
+        if ( op.myWildcardType != WC_END )
         {
-            top.myFsFixedIx = myWorkData.GetPatFragPosInFromStr( top.myFragIx );
-            int len = myWorkData.GetPatFragLengthInFromStr( top.myFragIx );
-            assert( top.myFsFixedIx >= 0 && len >= 0 );
+            int start;
+            int len;
 
-            top.myFixedIsMatched = true;
-
-            if ( top.myFragIx == 0 || top.myFsLeftIx < 0 ||
-                 top.myFsLeftIx > top.myFsFixedIx )
+            if ( !myWorkData.GetWildcardUseInfo( op.myWildcardType,
+                                                 op.myUseIx, start, len ) )
             {
-                top.myFsLeftIx = top.myFsFixedIx;
+                status = WS_ERROR_REPLACE_STR_BAD_WILDCARD;
+                break;
             }
 
-            if ( top.myFragIx == 0 )
-            {   // first fragment.
-                // If any *$% wildcards, gap will be from the beginning of the
-                // From String to the beginning of the fragment,
-                // otherwise gap will be the count of ?. wildcards before the
-                // beginning of the fragment.
-                top.myPatWildIx = 0;
-                top.myPatFixedIx = myWorkData.GetPatFragStartInPat(top.myFragIx);
-                int max_span = MaxWildcardSpan( 0, top.myPatFixedIx );
-                top.myFsWildIx = max_span == -1 ? 0 : top.myFsFixedIx - max_span;
-            }
-
-            top.myFsWildEndIx = top.myFsFixedIx;
-            top.myPatFixedIx = myWorkData.GetPatFragStartInPat(top.myFragIx);
-        }
-        else
-        {
-             status = WS_NO_MATCH;
+            to_len += len;
         }
     }
 
-    return status;
-}
-
+    // second pass: copy the spans.  On error the To String is left
+    // with everything up to the bad wildcard.
+    myWorkData.ReserveToString( to_len );
+    myWorkData.AppendPrefixToToString();
 
+    const TaggedString & repstr = theReplacement.GetStr();
 
-// If this is a ?. wildcard, set its max FromString span to 1 char.
-// For *$% wildcards, to save unnecessary checking which would immediately
-// cause the following wildcards in the gap to fail, reduce the size of
-// the maximum span for this wildcard to allow 1 char for each ?.
-// wildcard to the right
-WorkStatus_t Work::TryToFillGap( PM_Level & top,
-                                 bool & top_changed )
-{
-    WorkStatus_t status = WS_CONTINUE;
-
-    Wildcard_t wt = GetCurWildcardType( top );
-
-    if ( WildcardMatches1Char( wt ) )
+    for ( int i = 0; i < num_good_ops; i++ )
     {
-        if ( top.myFsWildIx == top.myFsWildEndIx ||
-             top.myFsWildIx == top.myFsFixedIx )
-        {
-            status = WS_NO_MATCH;
+        const ReplacementOp & op = theReplacement.GetOp( i );
+
+        if ( op.myWildcardType == WC_END )
+        {   // ordinary characters
+            myWorkData.AppendSubstringToToString( repstr, op.myStart,
+                                                  op.myLength );
         }
         else
-        {
-            top_changed = top.myFsWildEndIx != top.myFsWildIx + 1;
-            top.myFsWildEndIx = top.myFsWildIx + 1;
+        {   // wildcard
+            int start;
+            int len;
+            myWorkData.GetWildcardUseInfo( op.myWildcardType, op.myUseIx,
+                                           start, len );
+            myWorkData.AppendFromSubstringToToString( start, len );
         }
     }
-    else
-    {
-        int span = MinWildcardSpan( top.myPatWildIx + 1, top.myPatFixedIx );
-
-        int we = max( top.myFsWildIx,
-                      min( top.myFsWildEndIx, top.myFsFixedIx - span ) );
 
-        top_changed = top.myFsWildEndIx != we;
-        top.myFsWildEndIx = we;
+    if ( status == WS_CONTINUE )
+    {
+        myWorkData.AppendSuffixToToString();
     }
 
     return status;
@@ -557,187 +392,85 @@ WorkStatus_t Work::TryToFillGap( PM_Level & top,
 
 
 
-WorkStatus_t Work::CheckAndHandleWildcard( PM_Level & top )
+WorkStatus_t Work::DoInstrMatch( const Instr & theInstr )
 {
-    if ( top.myPatWildIx == top.myPatFixedIx )
-    {   // no more wildcards in gap
-        return WS_CONTINUE;
-    }
-
-    if ( top.myPatWildIx + 1 == top.myPatFixedIx &&
-         top.myFsWildEndIx != top.myFsFixedIx )
-    {   // this is the last wildcard in gap, and gap is not filled
-        return WS_NO_MATCH;
-    }
-
-    int matched_len = top.myFsWildEndIx - top.myFsWildIx;
-    Wildcard_t wt = GetCurWildcardType( top );
+    const Pattern & pat = theInstr.GetPattern();
+    const ShapeMatcher & shape_matcher = theInstr.GetShapeMatcher();
 
-    assert( wt != WC_END );     // gap should only contain wildcards
-
-    if ( WildcardMatches1Char( wt ) )
-    {   // make sure ?. only match 1 character
-        if ( matched_len != 1 )
-        {
-            return WS_NO_MATCH;
-        }
+    if ( myIsVerbose )
+    {
+        return myPatternVM.Run( theInstr.GetPatternCode(), myWorkData,
+                                *this );
     }
 
-    const TaggedString & fs = myWorkData.GetFromStr();
-
-    if ( WildcardMatchesOnlyUntagged( wt ) )
-    {   // make sure $%?. match only untagged characters
-        for ( int i = top.myFsWildIx; i < top.myFsWildEndIx; i++ )
-        {
-            if ( IsTagged( fs[i] ) )
-            {
-                return WS_NO_MATCH;
-            }
-        }
+    if ( theInstr.GetNativeMatcher() != 0 )
+    {
+        myUID++;
+        return theInstr.GetNativeMatcher()( myWorkData );
     }
 
-    if ( WildcardIsUnique( wt ) )
-    {   // make sure subsequent $%?. match first occurrence
-        int wo = myWorkData.GetFirstWildcardOccurrence(wt);
-
-        if ( wo >= 0 )
-        {
-            if ( !myWorkData.CompareSubstringWithWildcard(
-                                wt, top.myFsWildIx, matched_len ) )
-            {
-                return WS_NO_MATCH;
-            }
-        }
-        else
-        {   // save first substring matched by $%?.
-            myWorkData.FoundWildcard( wt, top.myFsWildIx, matched_len );
-        }
-    }
-    else
-    {   // save substring matched by *
-        myWorkData.FoundWildcard( wt, top.myFsWildIx, matched_len );
+    if ( pat.IsLiteral() )
+    {
+        myUID++;
+        return DoLiteralMatch( pat );
     }
 
-    if ( top.myFsLeftIx < 0 || top.myFsLeftIx > top.myFsWildIx )
-    {   // mark leftmost matched character in this From String
-        top.myFsLeftIx = top.myFsWildIx;
+    if ( shape_matcher.IsBound() )
+    {
+        myUID++;
+        return shape_matcher.Match( myWorkData );
     }
 
-    // advance to next wildcard in gap
-    top.myPatWildIx++;
-    top.myFsWildIx = top.myFsWildEndIx;
-    top.myFsWildEndIx = top.myFsFixedIx;
-
-    return WS_CONTINUE;
-}
-
-
-// at this point we know that top.myFragIx < number of fragments
-// on exit, myPatWildIx and myPatFixedIx (of the top of the stack)
-// will point to just after the end of the previous fragment
-// in the pattern, and myFsWildIx, myFsWildEndIx and myFsFixedIx will
-// point to just after the end of the previous fragment in the from string.
-// We don't know exactly where the fragment will start in the from string,
-// but we know it can't be before this point.
-void Work::PushAdvanceToNextFrag( PM_Level & prev )
-{
-    PM_Level next = prev;
-
-    next.myFragIx++;
-    int prev_pat_frag_len = myWorkData.GetPatFragLengthInPat( prev.myFragIx );
-    assert( prev_pat_frag_len >= 0 );
-
-    next.myPatWildIx = prev.myPatFixedIx + prev_pat_frag_len;
-    next.myPatFixedIx = next.myPatWildIx;
-
-    int prev_fs_frag_len = myWorkData.GetPatFragLengthInFromStr( prev.myFragIx );
-    assert( prev_fs_frag_len >= 0 );
-
-    next.myFsWildIx = prev.myFsFixedIx + prev_fs_frag_len;
-    next.myFsWildEndIx = next.myFsWildIx;
-    next.myFsFixedIx = next.myFsWildIx;
-
-    next.myFixedIsMatched = false;
-
-    myStack.push_back( next );
+    myUID++;
+    return myPatternVM.Run( theInstr.GetPatternCode(), myWorkData );
 }
 
 
 
-// If this wildcard isn't ?. then push another try at
-// this same wildcard reducing the span by 1 char
-void Work::MaybePushNextWildcardAttempt( PM_Level & top )
+WorkStatus_t Work::DoLiteralMatch( const Pattern & pat )
 {
-    Wildcard_t wt = GetCurWildcardType( top );
-
-    if ( !WildcardMatches1Char(wt) && top.myFsWildEndIx > top.myFsWildIx &&
-         top.myPatWildIx + 1 < top.myPatFixedIx )
-    {
-        PM_Level next = top;
-        next.myFsWildEndIx--;
-        myStack.push_back( next );
-    }
-}
+    assert( pat.IsLiteral() );
 
+    int pos = myWorkData.FindLiteral( pat.GetStr() );
 
-
-int Work::MinWildcardSpan( int pat_from,
-                           int pat_to )
-{
-    int len_so_far = 0;
-    const TaggedString & pat = myWorkData.GetCurPat();
-
-    for ( int i = pat_from; i < pat_to; i++ )
+    if ( pos < 0 )
     {
-        Wildcard_t wt = ToWildcard( pat[i] );
-
-        if ( WildcardMatches1Char(wt) )
-        {
-            len_so_far++;
-        }
+        return WS_NO_MATCH;
     }
 
-    return len_so_far;
-}
+    myWorkData.SetPrefixAndSuffix( pos, pos + pat.GetLength() );
 
+    return WS_OK;
+}
 
 
 
-int Work::MaxWildcardSpan( int pat_from,
-                           int pat_to )
+void Work::TraceOp( const PatternCode & theCode,
+                    size_t thePC,
+                    WorkStatus_t theStatus,
+                    const PatternVMRegisters & theRegisters,
+                    const PatternVMRegisters * theChoicePoints,
+                    size_t theNumChoicePoints )
 {
-    int len_so_far = 0;
-    const TaggedString & pat = myWorkData.GetCurPat();
-
-    for ( int i = pat_from; i < pat_to; i++ )
+    if ( myDebugToConsole )
     {
-        Wildcard_t wt = ToWildcard( pat[i] );
-
-        if ( WildcardMatches1Char(wt) )
-        {
-            len_so_far++;
-        }
-        else
-        {
-            return -1;
-        }
+        PrintWorkState( cout, theStatus, theCode, thePC, theRegisters,
+                        theChoicePoints, theNumChoicePoints );
     }
 
-    return len_so_far;
-}
-
-
-
+    if ( myDebug != 0 )
+    {
+        PrintWorkState( *myDebug, theStatus, theCode, thePC, theRegisters,
+                        theChoicePoints, theNumChoicePoints );
+    }
 
-Wildcard_t Work::GetCurWildcardType( PM_Level & top )
-{
-    if ( top.myPatWildIx == top.myPatFixedIx )
+    if ( (myDebug != 0 || myDebugToConsole) &&
+        BREAK_AT_UID != 0 && BREAK_AT_UID == myUID )
     {
-        return WC_END;
+        TriggerBreakpoint();
     }
 
-    const TaggedString & pat = myWorkData.GetCurPat();
-    return ToWildcard( pat[top.myPatWildIx] );
+    myUID++;
 }
 
 
@@ -753,7 +486,7 @@ string Work::PatStringChar( int theIx ) const
 {
     if ( myWorkData.HasCurPat() )
     {
-        return TaggedStringChar( myWorkData.GetCurPat(), theIx );
+        return TaggedStringChar( myWorkData.GetCurPat().GetStr(), theIx );
     }
     else
     {
@@ -764,13 +497,18 @@ string Work::PatStringChar( int theIx ) const
 
 
 void Work::PrintWorkState( ostream & out,
-                           WorkStatus_t status )  const
+                           WorkStatus_t status,
+                           const PatternCode & theCode,
+                           size_t thePC,
+                           const PatternVMRegisters & theRegisters,
+                           const PatternVMRegisters * theChoicePoints,
+                           size_t theNumChoicePoints ) const
 {
     static const size_t MAX_PAT_STRING = 30;
     static const size_t MAX_FROM_STRING = 30;
     static const size_t MAX_TO_STRING = 30;
     static const size_t MAX_WILDCARD_STRING =  40;
-    static const size_t MAX_STACK_TO_PRINT = 10;
+    static const size_t MAX_CHOICE_POINTS_TO_PRINT = 10;
 
     out << "############# Work State #############" << endl;
 
@@ -784,7 +522,7 @@ void Work::PrintWorkState( ostream & out,
 
     if ( myWorkData.HasCurPat() )
     {
-        const TaggedString & pat = myWorkData.GetCurPat();
+        const TaggedString & pat = myWorkData.GetCurPat().GetStr();
         out << "### PAT: " << pat.size();
         PrintTaggedString( out, pat, MAX_PAT_STRING );
         out << endl;
@@ -866,26 +604,32 @@ void Work::PrintWorkState( ostream & out,
         }
     }
 
-    if ( !myStack.empty() )
+    const PatternOp & op = theCode.GetOp( thePC );
+
+    out << "### OP " << thePC << ": " <<
+        GetPatternOpName( (PatternOpCode_t)op.myOpCode );
+
+    if ( op.myWildcard != WC_END )
+    {
+        out << " " << FromTaggedChar(
+                        GetWildcardChar( (Wildcard_t)op.myWildcard ) );
+    }
+
+    out << " frag:" << op.myFragIx << endl;
+
+    out << "### REGS: ";
+    PrintRegisters( out, theRegisters );
+
+    if ( theNumChoicePoints > 0 )
     {
-        out << "### STACK <" << myStack.size() << ">:" << endl;
-        size_t stacksize = myStack.size();
-        size_t limit = min( stacksize, MAX_STACK_TO_PRINT );
-        size_t si = stacksize - 1;
+        out << "### CHOICE POINTS <" << theNumChoicePoints << ">:" << endl;
+        size_t limit = min( theNumChoicePoints, MAX_CHOICE_POINTS_TO_PRINT );
+        size_t ci = theNumChoicePoints - 1;
         for ( size_t i = 0; i < limit; i++ )
         {
-            out << "###   " << si << ": ";
-            const PM_Level & e = myStack[si];
-
-            out << "#:" << e.myFragIx;
-            out << " PAT w:" << e.myPatWildIx << "=" << PatStringChar(e.myPatWildIx);
-            out << " f:" << e.myPatFixedIx << "=" << PatStringChar(e.myPatFixedIx);
-            out << " FS <:" << e.myFsLeftIx;
-            out << " w:" << e.myFsWildIx << "=" << FromStringChar(e.myFsWildIx);
-            out << " we:" << e.myFsWildEndIx << "=" << FromStringChar(e.myFsWildEndIx);
-            out << " fx:" << e.myFsFixedIx << "=" << FromStringChar(e.myFsFixedIx);
-            out << (e.myFixedIsMatched ? "" : " !m") << endl;
-            si--;
+            out << "###   " << ci << ": ";
+            PrintRegisters( out, theChoicePoints[ci] );
+            ci--;
         }
     }
 
@@ -921,6 +665,20 @@ void Work::PrintWorkState( ostream & out,
 }
 
 
+void Work::PrintRegisters( ostream & out,
+                           const PatternVMRegisters & theRegisters ) const
+{
+    const PatternVMRegisters & r = theRegisters;
+
+    out << "op:" << r.myPC;
+    out << " FS <:" << r.myFsLeftIx;
+    out << " w:" << r.myFsWildIx << "=" << FromStringChar(r.myFsWildIx);
+    out << " we:" << r.myFsWildEndIx << "=" << FromStringChar(r.myFsWildEndIx);
+    out << " fx:" << r.myFsFixedIx << "=" << FromStringChar(r.myFsFixedIx);
+    out << endl;
+}
+
+
 void Work::DebugPrintInitial( ostream & out )  const
 {
     static const size_t MAX_FROM_STRING = 120;
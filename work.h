@@ -5,9 +5,25 @@
 //      on an input string to produce an output string.
 //      All the low level data is stored in the WorkData class so
 //      Work is simply the high level algorithm.
+//      A Work only reads its Program, and keeps no state outside itself
+//      and its WorkData, so any number of Works on different threads can
+//      share one Program.  Each Work must be used by one thread at a time.
 //
 // HISTORY:
 //      14-DEC-12   D.Brown     Created
+//      17-OCT-26   D.Brown     Match using precompiled Pattern
+//      17-OCT-26   D.Brown     Replace using compiled Replacement
+//      17-OCT-26   D.Brown     Only try instructions selected by RuleIndex
+//      17-OCT-26   D.Brown     Skip instructions needing a longer string
+//      17-OCT-26   D.Brown     Fast path for patterns without wildcards
+//      17-OCT-26   D.Brown     Match with the PatternVM unless verbose
+//      17-OCT-26   D.Brown     Skip instructions with a RuleCertificates entry
+//      17-OCT-26   D.Brown     Check the counts of repeated pattern chars
+//      17-OCT-26   D.Brown     Check the bigrams of the pattern
+//      17-OCT-26   D.Brown     Added Reset
+//      17-OCT-26   D.Brown     Added GetNumSteps
+//      17-OCT-26   D.Brown     Documented sharing the Program across threads
+//      17-OCT-26   D.Brown     Trace the PatternVM for the verbose log
 
 #ifndef WORK_H
 #define WORK_H
@@ -16,6 +32,9 @@
 #include "tagged_char.h"
 #include "work_status.h"
 #include "instr.h"
+#include "rule_index.h"
+#include "pattern_vm.h"
+#include "rule_certificates.h"
 #include <vector>
 #include <bitset>
 #include <iostream>
@@ -24,10 +43,10 @@
 
 
 class WorkData;
-struct PM_Level;
 
 
-class Work
+// Work is the PatternTracer of its PatternVM when verbose.
+class Work : private PatternTracer
 {
 public:
     Work( const Program & theProgram,
@@ -42,62 +61,98 @@ private:
     const Work & operator = ( const Work & theOther );
 
 public:
+    // Makes the Work ready for another input, as if newly constructed.
+    // The memory used by the last input is kept, unless the buffers
+    // grew past theMaxKeptLength elements (see WorkPool).
+    void Reset( size_t theMaxKeptLength );
+
     WorkStatus_t DoTransformations(
                     const TaggedString & theInputString,
                     TaggedString & theOutputString,
                     std::ofstream * theDebug = 0 );    // 0 if not debugging
 
-private:
-    // This is a quick check to see if a pattern cannot be matched with
-    // the from string.  If any characters in thePatternCharsUsed are not
-    // in the from string's characters used, returns WS_NO_MATCH, otherwise
-    // returns WS_NOT_DONE (in this case, DoPatternMatch should be called to
-    // do the actual matching).
-    WorkStatus_t QuickCheckPattern(
-                    const std::bitset<TAGGED_CHAR_END> & thePatternCharsUsed );
-
-    WorkStatus_t DoReplacement( const TaggedString & theReplacementStr );
-
-    // Does a pattern match, storing the matched substrings in the WorkData.
-    // Returns WS_OK if the pattern successfully matched, or
-    // WS_NO_MATCH if not successfully matched.
-    WorkStatus_t DoPatternMatch( const TaggedString & thePatternStr,
-                                 std::ofstream * theDebug = 0 );
-
-    WorkStatus_t DoPatternMatch1();
-
-    WorkStatus_t PlaceFixedFragment( PM_Level & top );
-
-    WorkStatus_t TryToFillGap( PM_Level & top,
-                               bool & top_changed );
-
-    // if the wildcard cannot be matched in this sub-gap, returns WS_NO_MATCH,
-    // otherwise adds wildcard substring to myWorkData's wildcard occurrences.
-    WorkStatus_t CheckAndHandleWildcard( PM_Level & top );
+    // Returns the number of transformations the last DoTransformations
+    // applied, including the one of the exit step.
+    size_t GetNumSteps() const;
 
-    void PushAdvanceToNextFrag( PM_Level & prev );
-
-    void MaybePushNextWildcardAttempt( PM_Level & top );
-
-    void PushNextWildcard( PM_Level & prev );
-
-    // how many wildcards in this series are single-character wildcards?
-    int MinWildcardSpan( int pat_from,
-                         int pat_to );
-
-    // if any of these are *$% return -1 otherwise return count of ?.
-    int MaxWildcardSpan( int pat_from,
-                         int pat_to );
-
-    Wildcard_t GetCurWildcardType( PM_Level & top );
+private:
+    // Sets myPC to the first instruction from the exit step on which
+    // could match the From String, according to myRuleIndex, or to the
+    // end of the program if there are none.
+    void FirstCandidate();
+
+    // Sets myPC to the next instruction which could match the From String,
+    // or to the end of the program if there are no more.
+    void NextCandidate();
+
+    // Sets myPC to the candidate at myCandidateIx, skipping any which
+    // need a longer From String than we have, which need more of some
+    // char or a bigram it doesn't have, or which are certified not to
+    // match it by myCertificates.
+    void SkipRejectedCandidates();
+
+    // This is a quick check to see if the pattern of theInstr cannot be
+    // matched with the from string.  If any characters it uses are not
+    // in the from string's characters used, if it has more of any
+    // character than the from string or a pair of adjacent characters
+    // the from string doesn't have, or if it needs a longer from
+    // string, returns WS_NO_MATCH, otherwise returns WS_CONTINUE (in this
+    // case, DoInstrMatch should be called to do the actual matching).
+    WorkStatus_t QuickCheckPattern( const Instr & theInstr );
+
+    // Returns true if the From String has at least as many of each char
+    // as thePattern has outside its wildcards.  Only the repeated chars
+    // are checked, the others are checked by the set of chars used.
+    bool HasRepeatedChars( const Pattern & thePattern ) const;
+
+    // Returns true if the From String has all the bigrams of thePattern.
+    bool HasBigrams( const Pattern & thePattern ) const;
+
+    // Builds the To String from the unmatched prefix and suffix of the
+    // From String and the compiled replacement.  The length of the To
+    // String is computed first so it is only allocated once.
+    WorkStatus_t DoReplacement( const Replacement & theReplacement );
+
+    // Matches the pattern of theInstr with the fastest matcher which
+    // applies: the instruction's native matcher, DoLiteralMatch, its
+    // ShapeMatcher, or else myPatternVM running its PatternCode.
+    // When verbose, myPatternVM is always used, traced by TraceOp so the
+    // log shows each op it runs.
+    // Returns WS_OK if the pattern matched, storing the matched substrings
+    // in the WorkData, or WS_NO_MATCH if not.
+    WorkStatus_t DoInstrMatch( const Instr & theInstr );
+
+    // Matches a pattern without wildcards (see Pattern::IsLiteral) by
+    // finding its leftmost occurrence in the From String, without
+    // backtracking.  Returns the same as DoInstrMatch.
+    WorkStatus_t DoLiteralMatch( const Pattern & thePattern );
+
+    // PatternTracer: prints the work state after each op of myPatternVM
+    // to the verbose log.
+    void TraceOp( const PatternCode & theCode,
+                  size_t thePC,
+                  WorkStatus_t theStatus,
+                  const PatternVMRegisters & theRegisters,
+                  const PatternVMRegisters * theChoicePoints,
+                  size_t theNumChoicePoints );
 
 private:        // for debug printing
     std::string FromStringChar( int theIx ) const;
 
     std::string PatStringChar( int theIx ) const;
 
+    // prints the state after op thePC of theCode; the arguments are
+    // those of TraceOp
     void PrintWorkState( std::ostream & out,
-                         WorkStatus_t status ) const;
+                         WorkStatus_t status,
+                         const PatternCode & theCode,
+                         size_t thePC,
+                         const PatternVMRegisters & theRegisters,
+                         const PatternVMRegisters * theChoicePoints,
+                         size_t theNumChoicePoints ) const;
+
+    void PrintRegisters( std::ostream & out,
+                         const PatternVMRegisters & theRegisters ) const;
 
     void DebugPrintInitial( std::ostream & out ) const;
 
@@ -115,8 +170,14 @@ private:
     bool myDebugToConsole;
     size_t myPC;                    // current instruction in myProgram
     size_t myUID;                   // unique id of pattern match for debugging
+    size_t myNumSteps;              // transformations applied
     WorkData & myWorkData;
-    std::vector<PM_Level> myStack;
+    PatternVM myPatternVM;          // matches, traced when verbose
+    std::ofstream * myDebug;        // of DoTransformations, for TraceOp
+    RuleIndex myRuleIndex;          // instructions which could match
+    const RuleList * myCandidates;  // from myRuleIndex for the From String
+    size_t myCandidateIx;           // index of myPC in myCandidates
+    RuleCertificates myCertificates;    // instructions which can't match
 };
 
 
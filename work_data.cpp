@@ -5,16 +5,72 @@
 //
 // HISTORY:
 //      14-DEC-12   D.Brown     Created
+//      17-OCT-26   D.Brown     Use precompiled Pattern fragments
+//      17-OCT-26   D.Brown     Bulk copies for compiled Replacement
+//      17-OCT-26   D.Brown     Update From String info from each edit
+//      17-OCT-26   D.Brown     Splice the replacement into the From String
+//      17-OCT-26   D.Brown     Sorted position lists instead of CFirst/CNext
+//      17-OCT-26   D.Brown     Scan for fragments with common first chars
+//      17-OCT-26   D.Brown     UnmatchFromString only rescans if it unmatched
+//      17-OCT-26   D.Brown     GetFirstWildcardOccurrence without a scan
+//      17-OCT-26   D.Brown     Added GetLastEdit
+//      17-OCT-26   D.Brown     Added GetFromStrCharCount
+//      17-OCT-26   D.Brown     Count the bigrams of the From String
+//      17-OCT-26   D.Brown     Leave out the unchanged ends of an edit
+//      17-OCT-26   D.Brown     Compare long substrings by prefix hashes
+//      17-OCT-26   D.Brown     Check for tagged chars by prefix counts
+//      17-OCT-26   D.Brown     Added Reset
 
 #include "work_data.h"
 #include "tagged_char.h"
+#include "fragment_search.h"
 #include "misc.h"
+#include <algorithm>
 #include <assert.h>
 
 
 using namespace std;
 
 
+// If the first char of a fragment occurs more often than once every
+// this many chars, AdvancePatFragPos scans the From String with
+// FindFragment instead of checking each occurrence of the first char.
+static const size_t MAX_CANDIDATE_SPACING = 16;
+
+// Searches with fewer candidates than this check each candidate.
+static const size_t MIN_SCAN_CANDIDATES = 8;
+
+// Substrings shorter than this are compared char by char, since that is
+// cheaper than bringing myFromStringHash up to date after an edit.
+static const int MIN_HASH_COMPARE_LEN = 32;
+
+// Multiplier of the From String prefix hashes.  The hashes are taken
+// modulo 2^64, so different substrings can have the same hash (the
+// Thue-Morse strings are the well known case), which is why the chars
+// are still compared when the hashes are the same.
+static const unsigned long long HASH_BASE = 0x9E3779B97F4A7C15ULL;
+
+// Substrings shorter than this are checked for tagged chars one char at
+// a time, for the same reason as MIN_HASH_COMPARE_LEN.
+static const int MIN_TAG_COUNT_LEN = 16;
+
+
+// Empties theVector, and frees its memory if it can hold more than
+// theMaxKept elements.
+template <class T>
+static void ClearAndTrim( vector<T> & theVector,
+                          size_t theMaxKept )
+{
+    theVector.clear();
+
+    if ( theVector.capacity() > theMaxKept )
+    {
+        vector<T>().swap( theVector );
+    }
+}
+
+
+
 // This identifies a wildcard substring which has already
 // been matched in the working string
 struct WildcardOccurrence
@@ -28,12 +84,19 @@ struct WildcardOccurrence
 
 
 WorkData::WorkData() :
-    myFromStringIsA( false ),
-    myFromStringHasInfo( false ),
+    myToStringHasPrefix( false ),
+    myToStringHasSuffix( false ),
+    myFromStringBigramCount( TAGGED_BIGRAM_END, 0 ),
+    myFromStringIsIndexed( false ),
+    myFromStringIndexedLen( 0 ),
+    myFromStringHashedLen( 0 ),
+    myFromStringTagCountedLen( 0 ),
+    myLastEditStart( 0 ),
+    myLastEditLength( 0 ),
+    myLastEditOldLength( 0 ),
     myCurPat( 0 )
 {
-    ClearWildcardOccurrences();
-    ClearPrefixAndSuffix();
+    ClearFromString();
 }
 
 
@@ -46,7 +109,7 @@ WorkData::~WorkData()
 
 const TaggedString & WorkData::GetFromStr()
 {
-    return myFromStringIsA ? myWorkA : myWorkB;
+    return myFromStr;
 }
 
 
@@ -54,38 +117,71 @@ const TaggedString & WorkData::GetFromStr()
 
 const std::bitset<TAGGED_CHAR_END> & WorkData::GetFromStrCharsUsed()
 {
-    if ( !myFromStringHasInfo )
-    {
-        GetFromStringInfo();
-    }
-
     return myFromStringCharsUsed;
 }
 
 
 
-int WorkData::GetFromStrCFirst( TaggedChar_t tc )
+int WorkData::GetFromStrCharCount( TaggedChar_t tc ) const
+{
+    return myFromStringCharCount[tc];
+}
+
+
+
+int WorkData::GetFromStrBigramCount( int theBigram ) const
 {
-    if ( !myFromStringHasInfo )
+    assert( theBigram >= 0 && theBigram < TAGGED_BIGRAM_END );
+
+    return myFromStringBigramCount[theBigram];
+}
+
+
+
+const vector<int> & WorkData::GetFromStrCharPositions( TaggedChar_t tc )
+{
+    if ( !myFromStringIsIndexed )
     {
-        GetFromStringInfo();
+        IndexFromString();
     }
 
-    return myFromStringCFirst[tc];
+    return myFromStringCharPos[tc];
 }
 
 
 
-int WorkData::GetFromStrCNext( int i )
+// Returns the index in thePositions of the first position >= theMinPos,
+// or the size of thePositions if there is none.  The positions before
+// theHint must all be < theMinPos.  The search gallops forward from
+// theHint, so it is fast if the answer is close to theHint.
+static size_t FindFirstPosAtOrAfter( const vector<int> & thePositions,
+                                     int theMinPos,
+                                     size_t theHint )
 {
-    if ( !myFromStringHasInfo )
+    size_t size = thePositions.size();
+    size_t lo = theHint;
+
+    if ( lo >= size || thePositions[lo] >= theMinPos )
+    {
+        return lo;
+    }
+
+    // thePositions[lo] < theMinPos
+    size_t step = 1;
+    size_t hi = lo + step;
+
+    while ( hi < size && thePositions[hi] < theMinPos )
     {
-        GetFromStringInfo();
+        lo = hi;
+        step *= 2;
+        hi = lo + step;
     }
 
-    assert( i >= 0 && i < (int)myFromStringCNext.size() );
+    hi = min( hi, size );
 
-    return myFromStringCNext[i];
+    return lower_bound( thePositions.begin() + lo + 1,
+                        thePositions.begin() + hi,
+                        theMinPos ) - thePositions.begin();
 }
 
 
@@ -110,7 +206,29 @@ void WorkData::GetSubstringOfFromStr( TaggedString & theStr,
 
 const TaggedString & WorkData::GetToStr()
 {
-    return myFromStringIsA ? myWorkB : myWorkA;
+    if ( !myToStringHasPrefix && !myToStringHasSuffix )
+    {
+        return myToStr;
+    }
+
+    myToStrCopy.clear();
+
+    if ( myToStringHasPrefix )
+    {
+        myToStrCopy.insert( myToStrCopy.end(), myFromStr.begin(),
+                            myFromStr.begin() + myPrefix.myLength );
+    }
+
+    myToStrCopy.insert( myToStrCopy.end(), myToStr.begin(), myToStr.end() );
+
+    if ( myToStringHasSuffix )
+    {
+        myToStrCopy.insert( myToStrCopy.end(),
+                            myFromStr.begin() + mySuffix.myStart,
+                            myFromStr.end() );
+    }
+
+    return myToStrCopy;
 }
 
 
@@ -184,48 +302,53 @@ Wildcard_t WorkData::GetWildcardType( int theWildcardOccurrence )
 
 
 
+// myFirstWildcardOccurrence is kept up to date by FoundWildcard,
+// UnmatchFromString and ClearWildcardOccurrences
 int WorkData::GetFirstWildcardOccurrence( Wildcard_t theWildcardType )
 {
+    assert( theWildcardType >= 0 && theWildcardType < WC_END );
+
+    return myFirstWildcardOccurrence[theWildcardType];
+}
+
+
+
+void WorkData::IndexWildcardOccurrences()
+{
+    for ( size_t w = 0; w < WC_END; w++ )
+    {
+        myWildcardsOfType[w].clear();
+    }
+
     int len = GetNumWildcardsUsed();
 
     for ( int i = 0; i < len; i++ )
     {
-        if ( GetWildcardType(i) == theWildcardType )
-        {
-            return i;
-        }
+        myWildcardsOfType[GetWildcardType(i)].push_back( i );
     }
-
-    return -1;
 }
 
 
 
-void WorkData::GetNextWildcardOccurrence( Wildcard_t theWildcardType,
-                                          int & theOccurrence )
+bool WorkData::GetWildcardUseInfo( Wildcard_t theWildcardType,
+                                   int        theUseIx,
+                                   int &      theStartIx,
+                                   int &      theLength )
 {
-    int len = GetNumWildcardsUsed();
-    bool found = false;
+    assert( theWildcardType >= 0 && theWildcardType < WC_END );
+
+    const vector<int> & occurrences = myWildcardsOfType[theWildcardType];
 
-    for ( int i = 0; i < len && !found; i++ )
+    if ( occurrences.empty() )
     {
-        theOccurrence++;
+        return false;
+    }
 
-        if ( theOccurrence < 0 || theOccurrence >= len )
-        {
-            theOccurrence = 0;
-        }
+    int wo = occurrences[theUseIx % occurrences.size()];
 
-        if ( GetWildcardType( theOccurrence ) == theWildcardType )
-        {
-            found = true;
-        }
-    }
+    GetWildcardSubstringInfo( wo, theStartIx, theLength );
 
-    if ( !found )
-    {
-        theOccurrence = -1;
-    }
+    return true;
 }
 
 
@@ -252,23 +375,63 @@ bool WorkData::CompareSubstringWithWildcard( Wildcard_t theWildcardType,
 
         GetWildcardSubstringInfo( wo, prev_start, prev_length );
 
-        if ( prev_length != theLength )
+        if ( prev_length != theLength ||
+             !FromSubstringsAreEqual( prev_start, theStartIx, theLength ) )
         {
             return false;
         }
-        else
+    }
+
+    return true;
+}
+
+
+
+bool WorkData::FromSubstringIsUntagged( int theStartIx,
+                                        int theEndIx )
+{
+    assert( theStartIx >= 0 && theEndIx <= (int)myFromStr.size() );
+
+    if ( theEndIx - theStartIx < MIN_TAG_COUNT_LEN )
+    {
+        for ( int i = theStartIx; i < theEndIx; i++ )
         {
-            for ( int i = 0; i < theLength; i++ )
+            if ( IsTagged( myFromStr[i] ) )
             {
-                if ( from_str[prev_start + i] != from_str[theStartIx + i] )
-                {
-                    return false;
-                }
+                return false;
             }
         }
+
+        return true;
     }
 
-    return true;
+    if ( myFromStringTagCountedLen < (int)myFromStr.size() )
+    {
+        CountFromStringTags();
+    }
+
+    return myFromStringTaggedCount[theEndIx] ==
+           myFromStringTaggedCount[theStartIx];
+}
+
+
+
+int WorkData::GetNextTaggedPos( int theStartIx )
+{
+    assert( theStartIx >= 0 && theStartIx <= (int)myFromStr.size() );
+
+    if ( myFromStringTagCountedLen < (int)myFromStr.size() )
+    {
+        CountFromStringTags();
+    }
+
+    // the count goes up just after each tagged char
+    vector<int>::const_iterator it =
+                    upper_bound( myFromStringTaggedCount.begin() + theStartIx,
+                                 myFromStringTaggedCount.end(),
+                                 myFromStringTaggedCount[theStartIx] );
+
+    return (int)(it - myFromStringTaggedCount.begin()) - 1;
 }
 
 
@@ -290,89 +453,258 @@ void WorkData::FoundWildcard( Wildcard_t theWildcardType,
 
 void WorkData::MoveToStringToFromString()
 {
-    myFromStringIsA = !myFromStringIsA;
-    myFromStringHasInfo = false;
+    int from_len = (int)myFromStr.size();
+    int to_len = (int)myToStr.size();
+    int replace_start = myToStringHasPrefix ? myPrefix.myLength : 0;
+    int replace_end = myToStringHasSuffix ? mySuffix.myStart : from_len;
+    int new_len = replace_start + to_len + (from_len - replace_end);
+
+    assert( replace_start <= replace_end );
+
+    // The chars at either end of the replaced part which the replacement
+    // leaves the same aren't changed, so the edit is just the chars
+    // between them.  Patterns ending in * often replace the rest of the
+    // From String with itself.
+    int same_start = CountSameChars( replace_start, replace_end, 0, to_len,
+                                     1 );
+    int same_end = CountSameChars( replace_end - 1,
+                                   replace_start + same_start - 1,
+                                   to_len - 1, same_start - 1, -1 );
+    int edit_start = replace_start + same_start;
+    int edit_old_end = replace_end - same_end;
+    int edit_new_end = edit_start + (to_len - same_start - same_end);
+
+    bool recount = (edit_old_end - edit_start) + (edit_new_end - edit_start) >=
+                    new_len;
+
+    myLastEditStart = edit_start;
+    myLastEditLength = edit_new_end - edit_start;
+    myLastEditOldLength = edit_old_end - edit_start;
+
+    if ( !recount )
+    {
+        UpdateCharCounts( myFromStr, edit_start, edit_old_end, -1 );
+        UpdateCharCounts( myToStr, same_start, to_len - same_end, 1 );
+    }
+
+    // the bigrams which change are the ones with a char in the edit
+    int bigram_start = max( 0, edit_start - 1 );
+    UpdateBigramCounts( myFromStr, bigram_start,
+                        min( from_len, edit_old_end + 1 ), -1 );
+
+    if ( replace_start == 0 && replace_end == from_len )
+    {   // everything is replaced
+        myFromStr.swap( myToStr );
+    }
+    else
+    {
+        SpliceFromString( replace_start, replace_end, myToStr );
+    }
+
+    UpdateBigramCounts( myFromStr, bigram_start,
+                        min( new_len, edit_new_end + 1 ), 1 );
+
+    if ( recount )
+    {
+        CountFromStringChars();
+    }
+
+    SetCharsUsedFromCounts();
+    myFromStringIndexedLen = min( myFromStringIndexedLen, edit_start );
+    myFromStringHashedLen = min( myFromStringHashedLen, edit_start );
+    myFromStringTagCountedLen = min( myFromStringTagCountedLen, edit_start );
+    myFromStringIsIndexed = false;
     ClearWildcardOccurrences();
     ClearToString();
-    myPatternFragments.clear();
     ClearAllPatFragPosInFromStr();
     ClearPrefixAndSuffix();
-
-    GetFromStringInfo();
 }
 
 
 
-void WorkData::ClearFromString()
+int WorkData::CountSameChars( int theFromIx,
+                              int theFromEndIx,
+                              int theToIx,
+                              int theToEndIx,
+                              int theStep ) const
 {
-    if ( myFromStringIsA )
+    if ( theFromIx == theFromEndIx || theToIx == theToEndIx )
     {
-        myWorkA.clear();
+        return 0;
     }
-    else
+
+    const TaggedChar_t * from = &myFromStr[0];
+    const TaggedChar_t * to = &myToStr[0];
+    int count = 0;
+
+    while ( theFromIx != theFromEndIx && theToIx != theToEndIx &&
+            from[theFromIx] == to[theToIx] )
     {
-        myWorkB.clear();
+        theFromIx += theStep;
+        theToIx += theStep;
+        count++;
     }
 
-    myFromStringHasInfo = false;
+    return count;
+}
+
+
+
+void WorkData::GetLastEdit( int & theStartIx,
+                            int & theLength,
+                            int & theOldLength ) const
+{
+    theStartIx = myLastEditStart;
+    theLength = myLastEditLength;
+    theOldLength = myLastEditOldLength;
+}
+
+
+
+void WorkData::ClearFromString()
+{
+    UpdateBigramCounts( myFromStr, 0, (int)myFromStr.size(), -1 );
+    myFromStr.clear();
+    myLastEditStart = 0;
+    myLastEditLength = 0;
+    myLastEditOldLength = 0;
+
+    CountFromStringChars();
+    SetCharsUsedFromCounts();
+    myFromStringIsIndexed = false;
+    myFromStringIndexedLen = 0;
+    myFromStringHashedLen = 0;
+    myFromStringTagCountedLen = 0;
     ClearWildcardOccurrences();
     ClearPrefixAndSuffix();
 }
 
 
 
-void WorkData::ClearToString()
+void WorkData::Reset( size_t theMaxKeptLength )
 {
-    if ( myFromStringIsA )
+    UnrefCurrentPattern();
+    ClearToString();
+    ClearFromString();
+
+    ClearAndTrim( myFromStr, theMaxKeptLength );
+    ClearAndTrim( myToStr, theMaxKeptLength );
+    ClearAndTrim( myToStrCopy, theMaxKeptLength );
+    ClearAndTrim( myFromStringHash, theMaxKeptLength );
+    ClearAndTrim( myHashPowers, theMaxKeptLength );
+    ClearAndTrim( myFromStringTaggedCount, theMaxKeptLength );
+    ClearAndTrim( myFromStringWildcards, theMaxKeptLength );
+
+    for ( size_t ci = 0; ci < TAGGED_CHAR_END; ci++ )
     {
-        myWorkB.clear();
+        ClearAndTrim( myFromStringCharPos[ci], theMaxKeptLength );
     }
-    else
+
+    for ( size_t wt = 0; wt < WC_END; wt++ )
     {
-        myWorkA.clear();
+        ClearAndTrim( myWildcardsOfType[wt], theMaxKeptLength );
     }
 }
 
 
 
+void WorkData::ClearToString()
+{
+    myToStr.clear();
+    myToStringHasPrefix = false;
+    myToStringHasSuffix = false;
+}
+
+
+
 void WorkData::AppendCharToToString( TaggedChar_t theChar )
 {
-    TaggedString & ts = myFromStringIsA ? myWorkB : myWorkA;
-    ts.push_back( theChar );
+    assert( !myToStringHasSuffix );
+
+    myToStr.push_back( theChar );
 }
 
 
 
 void WorkData::AppendStringToToString( const TaggedString & theStr )
 {
-    TaggedString & tostr = myFromStringIsA ? myWorkB : myWorkA;
+    assert( !myToStringHasSuffix );
 
-    size_t len = theStr.size();
+    myToStr.insert( myToStr.end(), theStr.begin(), theStr.end() );
+}
 
-    for ( size_t i = 0; i < len; i++ )
-    {
-        tostr.push_back( theStr[i] );
-    }
+
+
+void WorkData::ReserveToString( size_t theLength )
+{
+    myToStr.reserve( theLength );
 }
 
 
 
-void WorkData::AppendWildcardOccurrenceToToString( int wo )
+void WorkData::AppendSubstringToToString( const TaggedString & theStr,
+                                          int theStartIx,
+                                          int theLen )
 {
-    assert( wo >= 0 && wo < (int)myFromStringWildcards.size() );
+    assert( !myToStringHasSuffix );
+    assert( theStartIx >= 0 && theLen >= 0 &&
+            theStartIx + theLen <= (int)theStr.size() );
 
-    const TaggedString & fromstr = GetFromStr();
-    TaggedString & tostr = myFromStringIsA ? myWorkB : myWorkA;
+    myToStr.insert( myToStr.end(), theStr.begin() + theStartIx,
+                    theStr.begin() + theStartIx + theLen );
+}
+
+
+
+void WorkData::AppendFromSubstringToToString( int theStartIx,
+                                              int theLen )
+{
+    AppendSubstringToToString( myFromStr, theStartIx, theLen );
+}
 
-    size_t start = (size_t)myFromStringWildcards[wo].myStartingIx;
-    size_t len   = (size_t)myFromStringWildcards[wo].myLength;
 
-    assert( start + len <= fromstr.size() );
 
-    for ( size_t i = start; i < start+len; i++ )
+void WorkData::AppendPrefixToToString()
+{
+    assert( myHasPrefixAndSuffix && myToStr.empty() &&
+            !myToStringHasPrefix && !myToStringHasSuffix );
+
+    myToStringHasPrefix = true;
+}
+
+
+
+void WorkData::AppendSuffixToToString()
+{
+    assert( myHasPrefixAndSuffix && !myToStringHasSuffix );
+
+    myToStringHasSuffix = true;
+}
+
+
+
+void WorkData::SpliceFromString( int theStartIx,
+                                 int theEndIx,
+                                 const TaggedString & theStr )
+{
+    int old_len = theEndIx - theStartIx;
+    int new_len = (int)theStr.size();
+
+    assert( theStartIx >= 0 && theStartIx <= theEndIx &&
+            theEndIx <= (int)myFromStr.size() );
+
+    if ( new_len > old_len )
+    {
+        myFromStr.insert( myFromStr.begin() + theEndIx,
+                          new_len - old_len, (TaggedChar_t)0 );
+    }
+    else if ( new_len < old_len )
     {
-        tostr.push_back( fromstr[i] );
+        myFromStr.erase( myFromStr.begin() + theStartIx + new_len,
+                         myFromStr.begin() + theEndIx );
     }
+
+    copy( theStr.begin(), theStr.end(), myFromStr.begin() + theStartIx );
 }
 
 
@@ -380,11 +712,11 @@ void WorkData::AppendWildcardOccurrenceToToString( int wo )
 
 void WorkData::UnmatchFromString( int theNewMatchLength )
 {
-    TaggedString & ts = myFromStringIsA ? myWorkA : myWorkB;
-
-    assert( theNewMatchLength >= 0 && theNewMatchLength <= (int)ts.size() );
+    assert( theNewMatchLength >= 0 &&
+            theNewMatchLength <= (int)myFromStr.size() );
 
     int wo = GetNumWildcardsUsed();
+    int num_before = wo;
 
     for ( --wo; wo >= 0; wo-- )
     {
@@ -399,6 +731,11 @@ void WorkData::UnmatchFromString( int theNewMatchLength )
         }
     }
 
+    if ( GetNumWildcardsUsed() == num_before )
+    {   // the first occurrences haven't changed
+        return;
+    }
+
     for ( int w = 0; w < WC_END; w++ )
     {
         myFirstWildcardOccurrence[w] = -1;
@@ -419,75 +756,9 @@ void WorkData::UnmatchFromString( int theNewMatchLength )
 
 
 
-// split a pattern string into fragments which consist either of
-// the largest number of consecutive non-wildcard characters, or
-// a single fixed wildcard ?.$% character (meaning the caller
-// at this point can figure out the characters in the search
-// string by consulting the wildcard fragment table).
-// a wildcard other than * becomes fixed after the first
-// non-wildcard character after the first occurrence of that
-// wildcard character.  Until then, it should be included in a
-// floating fragment with other contigous wildcards.
-static void SplitPatternIntoFragments( const TaggedString & pat,
-                                       std::vector<PatternFragment> & vpatfrag )
-{
-    int patlen = (int)pat.size();
-    int start = 0;
-    int len = 0;
-    BitSet_t wildcard_used = 0;
-    BitSet_t not_yet_fixed = 0;
-    vpatfrag.clear();
-
-    for ( int pi = 0; pi < patlen; pi++ )
-    {
-        Wildcard_t wt = ToWildcard( pat[pi] );
-
-        if ( wt == WC_END )
-        {
-            len++;
-            not_yet_fixed = 0;  // all wildcards previously seen are fixed
-        }
-        else
-        {
-            if ( len != 0 )
-            {
-                PatternFragment ff = { start, len };
-                vpatfrag.push_back( ff );
-            }
-
-            start = pi + 1;
-            len = 0;
-
-            if ( WildcardIsUnique(wt) )
-            {
-                if ( (wildcard_used & SET_BIT(wt)) != 0 &&
-                     (not_yet_fixed & SET_BIT(wt)) == 0 )
-                {   // we have seen this before, and it is fixed
-                    PatternFragment ff = { pi, -1 };
-                    vpatfrag.push_back( ff );
-                }
-                else
-                {   // this wildcard is not yet fixed
-                    wildcard_used |= SET_BIT(wt);
-                    not_yet_fixed |= SET_BIT(wt);
-                }
-            }
-        }
-    }
-
-    if ( len != 0 )
-    {
-        PatternFragment pf = { start, len };
-        vpatfrag.push_back( pf );
-    }
-}
-
-
-
-void WorkData::SetCurrentPattern( const TaggedString & thePattern )
+void WorkData::SetCurrentPattern( const Pattern & thePattern )
 {
     myCurPat = &thePattern;
-    SplitPatternIntoFragments( thePattern, myPatternFragments );
     ClearAllPatFragPosInFromStr();
 }
 
@@ -496,14 +767,14 @@ void WorkData::SetCurrentPattern( const TaggedString & thePattern )
 void WorkData::UnrefCurrentPattern()
 {
     myCurPat = 0;
-    myPatternFragments.clear();
     myPatFragCurrentPos.clear();
+    myPatFragCurrentPosIx.clear();
     ClearWildcardOccurrences();
 }
 
 
 
-const TaggedString & WorkData::GetCurPat() const
+const Pattern & WorkData::GetCurPat() const
 {
     assert( myCurPat != 0 );
     return *myCurPat;
@@ -519,7 +790,7 @@ bool WorkData::HasCurPat() const
 
 int WorkData::GetNumPatternFragments() const
 {
-    return (int)myPatternFragments.size();
+    return myCurPat == 0 ? 0 : myCurPat->GetNumFragments();
 }
 
 
@@ -528,17 +799,16 @@ TaggedChar_t WorkData::GetPatFragFirstChar( size_t frag_ix )
 {
     TaggedChar_t rtv = (TaggedChar_t)0;
 
-    if ( frag_ix < myPatternFragments.size() )
+    if ( frag_ix < (size_t)GetNumPatternFragments() )
     {
-        const TaggedString & pat = GetCurPat();
+        const Pattern & pat = GetCurPat();
 
-        int start = myPatternFragments[frag_ix].myStart;
-        int len   = myPatternFragments[frag_ix].myLength;
+        int start = pat.GetFragment(frag_ix).myStart;
+        int len   = pat.GetFragment(frag_ix).myLength;
 
         if ( len < 0 )
         {   // this fragment is a single wildcard
-            TaggedChar_t tc = GetPatFragFirstCharInPat( frag_ix );
-            Wildcard_t wt = ToWildcard(tc);
+            Wildcard_t wt = pat.GetWildcardType( start );
             int wo = myFirstWildcardOccurrence[wt];
 
             if ( wo >= 0 && myFromStringWildcards[wo].myLength > 0 )
@@ -550,8 +820,8 @@ TaggedChar_t WorkData::GetPatFragFirstChar( size_t frag_ix )
         }
         else if ( len >= 0 )
         {   // ordinary fragment in pattern
-            assert( start >= 0 && start < (int)pat.size() );
-            rtv = pat[start];
+            assert( start >= 0 && start < pat.GetLength() );
+            rtv = pat.GetStr()[start];
         }
     }
 
@@ -564,8 +834,7 @@ bool WorkData::GetPatFragStartLengthInFromStr( size_t frag_ix,
                                                int & start,
                                                int & len )
 {
-    TaggedChar_t tc = GetPatFragFirstCharInPat(frag_ix);
-    Wildcard_t wt = ToWildcard(tc);
+    Wildcard_t wt = GetPatFragWildcardType(frag_ix);
 
     if ( wt != WC_END )
     {
@@ -584,14 +853,14 @@ bool WorkData::GetPatFragStartLengthInFromStr( size_t frag_ix,
             return false;          // unknown length
         }
     }
-    else if ( frag_ix == myPatternFragments.size() )
+    else if ( frag_ix == (size_t)GetNumPatternFragments() )
     {
         return false;
     }
     else
     {
         start = myPatFragCurrentPos[frag_ix];
-        len = myPatternFragments[frag_ix].myLength;
+        len = GetCurPat().GetFragment(frag_ix).myLength;
         return true;
     }
 }
@@ -600,8 +869,7 @@ bool WorkData::GetPatFragStartLengthInFromStr( size_t frag_ix,
 
 int WorkData::GetPatFragLengthInFromStr( size_t frag_ix )
 {
-    TaggedChar_t tc = GetPatFragFirstCharInPat(frag_ix);
-    Wildcard_t wt = ToWildcard(tc);
+    Wildcard_t wt = GetPatFragWildcardType(frag_ix);
 
     if ( wt != WC_END )
     {
@@ -616,13 +884,13 @@ int WorkData::GetPatFragLengthInFromStr( size_t frag_ix )
             return -1;          // unknown length
         }
     }
-    else if ( frag_ix >= myPatternFragments.size() )
+    else if ( frag_ix >= (size_t)GetNumPatternFragments() )
     {
         return false;
     }
     else
     {
-        return myPatternFragments[frag_ix].myLength;
+        return GetCurPat().GetFragment(frag_ix).myLength;
     }
 }
 
@@ -630,15 +898,13 @@ int WorkData::GetPatFragLengthInFromStr( size_t frag_ix )
 
 int WorkData::GetPatFragStartInPat( size_t frag_ix )
 {
-    if ( frag_ix == myPatternFragments.size() )
+    if ( frag_ix == (size_t)GetNumPatternFragments() )
     {
-        return GetCurPat().size();
+        return GetCurPat().GetLength();
     }
     else
     {
-        assert( frag_ix < myPatternFragments.size() );
-
-        return myPatternFragments[frag_ix].myStart;
+        return GetCurPat().GetFragment(frag_ix).myStart;
     }
 }
 
@@ -648,9 +914,9 @@ int WorkData::GetPatFragLengthInPat( size_t frag_ix )
 {
     int len = 0;
 
-    if ( frag_ix < myPatternFragments.size() )
+    if ( frag_ix < (size_t)GetNumPatternFragments() )
     {
-        len = myPatternFragments[frag_ix].myLength;
+        len = GetCurPat().GetFragment(frag_ix).myLength;
 
         if ( len < 0 )
         {
@@ -667,14 +933,14 @@ TaggedChar_t WorkData::GetPatFragFirstCharInPat( size_t frag_ix )
 {
     TaggedChar_t tc = (TaggedChar_t)0;
 
-    if ( frag_ix < myPatternFragments.size() )
+    if ( frag_ix < (size_t)GetNumPatternFragments() )
     {
-        const TaggedString & pat = GetCurPat();
+        const Pattern & pat = GetCurPat();
         int start = GetPatFragStartInPat( frag_ix );
 
-        if ( start >= 0 && start < (int)pat.size() )
+        if ( start >= 0 && start < pat.GetLength() )
         {
-            tc = pat[start];
+            tc = pat.GetStr()[start];
         }
 
     }
@@ -684,16 +950,27 @@ TaggedChar_t WorkData::GetPatFragFirstCharInPat( size_t frag_ix )
 
 
 
+Wildcard_t WorkData::GetPatFragWildcardType( size_t frag_ix )
+{
+    if ( frag_ix < (size_t)GetNumPatternFragments() )
+    {
+        return GetCurPat().GetWildcardType( GetPatFragStartInPat(frag_ix) );
+    }
+
+    return WC_END;
+}
+
+
+
 bool WorkData::PatFragIsWildcard( size_t frag_ix )
 {
-    if ( frag_ix == myPatternFragments.size() )
+    if ( frag_ix == (size_t)GetNumPatternFragments() )
     {
         return false;
     }
     else
     {
-        assert( frag_ix < myPatternFragments.size() );
-        return myPatternFragments[frag_ix].myLength < 0;
+        return GetCurPat().GetFragment(frag_ix).myLength < 0;
     }
 }
 
@@ -701,16 +978,18 @@ bool WorkData::PatFragIsWildcard( size_t frag_ix )
 
 void WorkData::ClearAllPatFragPosInFromStr()
 {
-    size_t len = myPatternFragments.size();
+    size_t len = GetNumPatternFragments();
 
     if ( myPatFragCurrentPos.size() != len )
     {
         myPatFragCurrentPos.resize(len);
+        myPatFragCurrentPosIx.resize(len);
     }
 
     for ( size_t i = 0; i < len; i++ )
     {
         myPatFragCurrentPos[i] = -1;
+        myPatFragCurrentPosIx[i] = 0;
     }
 }
 
@@ -718,7 +997,7 @@ void WorkData::ClearAllPatFragPosInFromStr()
 
 int WorkData::GetPatFragPosInFromStr( size_t frag_ix )
 {
-    assert( frag_ix < myPatternFragments.size() );
+    assert( frag_ix < myPatFragCurrentPos.size() );
     return myPatFragCurrentPos[frag_ix];
 }
 
@@ -734,33 +1013,53 @@ bool WorkData::AdvancePatFragPos( size_t frag_ix,
         return false;
     }
 
-    int pos = myPatFragCurrentPos[frag_ix];
-    int len = GetPatFragLengthInPat( frag_ix );
+    int pos = -1;
+    TaggedChar_t tc = GetPatFragFirstChar( frag_ix );
 
-    if ( pos > fromstr_min_pos )
+    if ( tc != 0 )
     {
-        // we have backtracked to before this position, so
-        // need to restart searching for matching char from
-        // beginning of FromString
-        myPatFragCurrentPos[frag_ix] = -1;
-        pos = -1;
-    }
+        const vector<int> & positions = GetFromStrCharPositions( tc );
+        size_t pos_ix = myPatFragCurrentPosIx[frag_ix];
+
+        if ( pos_ix >= positions.size() ||
+             positions[pos_ix] != myPatFragCurrentPos[frag_ix] ||
+             positions[pos_ix] > fromstr_min_pos )
+        {
+            // we have backtracked to before this position, so
+            // need to restart searching for matching char from
+            // beginning of FromString
+            pos_ix = 0;
+        }
 
-    if ( pos < 0 )
-    {   // at beginning of string: start at first matching char
-        TaggedChar_t tc = GetPatFragFirstChar( frag_ix );
+        if ( PatFragIsWildcard( frag_ix ) )
+        {   // compare with the string the wildcard has already matched
+            pos_ix = FindFirstPosAtOrAfter( positions, fromstr_min_pos,
+                                            pos_ix );
 
-        if ( tc != 0 )
+            while ( pos_ix < positions.size() &&
+                    !CompareSubstringWithFragment( positions[pos_ix],
+                                                   GetPatFragLengthInPat(
+                                                                frag_ix ),
+                                                   frag_ix ) )
+            {
+                pos_ix++;
+            }
+        }
+        else
         {
-            pos = GetFromStrCFirst(tc);
+            const TaggedString & pat = GetCurPat().GetStr();
+
+            pos_ix = FindSubstringPosIx( &pat[GetPatFragStartInPat(frag_ix)],
+                                         GetPatFragLengthInPat(frag_ix),
+                                         fromstr_min_pos, pos_ix );
         }
-    }
 
-    while ( pos != -1 &&
-            ( pos < fromstr_min_pos ||
-              !CompareSubstringWithFragment( pos, len, frag_ix ) ) )
-    {
-        pos = GetFromStrCNext(pos);
+        if ( pos_ix < positions.size() )
+        {
+            pos = positions[pos_ix];
+        }
+
+        myPatFragCurrentPosIx[frag_ix] = pos_ix;
     }
 
     myPatFragCurrentPos[frag_ix] = pos;
@@ -770,6 +1069,67 @@ bool WorkData::AdvancePatFragPos( size_t frag_ix,
 
 
 
+int WorkData::FindLiteral( const TaggedString & theStr )
+{
+    assert( !theStr.empty() );
+
+    return FindSubstring( &theStr[0], (int)theStr.size(), 0 );
+}
+
+
+
+int WorkData::FindSubstring( const TaggedChar_t * theChars,
+                             int theLen,
+                             int theMinPos )
+{
+    assert( theLen > 0 );
+
+    const vector<int> & positions = GetFromStrCharPositions( theChars[0] );
+    size_t pos_ix = FindSubstringPosIx( theChars, theLen, theMinPos, 0 );
+
+    return pos_ix < positions.size() ? positions[pos_ix] : -1;
+}
+
+
+
+size_t WorkData::FindSubstringPosIx( const TaggedChar_t * theChars,
+                                     int theLen,
+                                     int theMinPos,
+                                     size_t theHint )
+{
+    const vector<int> & positions = GetFromStrCharPositions( theChars[0] );
+    int from_len = (int)myFromStr.size();
+    size_t pos_ix = FindFirstPosAtOrAfter( positions, theMinPos, theHint );
+    size_t num_candidates = positions.size() - pos_ix;
+
+    if ( theLen >= MIN_SEARCH_FRAGMENT_LEN &&
+         num_candidates >= MIN_SCAN_CANDIDATES &&
+         num_candidates * MAX_CANDIDATE_SPACING >=
+            (size_t)(from_len - positions[pos_ix]) )
+    {   // the first char is common: scan for the whole substring
+        int found = FindFragment( &myFromStr[0], from_len,
+                                  positions[pos_ix], theChars, theLen );
+
+        return found < 0 ? positions.size() :
+               FindFirstPosAtOrAfter( positions, found, pos_ix );
+    }
+
+    for ( ; pos_ix < positions.size(); pos_ix++ )
+    {
+        int pos = positions[pos_ix];
+
+        if ( pos + theLen <= from_len &&
+             equal( theChars, theChars + theLen, myFromStr.begin() + pos ) )
+        {
+            break;
+        }
+    }
+
+    return pos_ix;
+}
+
+
+
 bool WorkData::VerifyPatFragPos( size_t frag_ix,
                                  int fromstr_pos )
 {
@@ -806,7 +1166,7 @@ bool WorkData::CompareSubstringWithFragment( int fs_start,
 
     if ( PatFragIsWildcard(frag_ix) )
     {
-        Wildcard_t wt = ToWildcard( GetPatFragFirstCharInPat(frag_ix) );
+        Wildcard_t wt = GetPatFragWildcardType(frag_ix);
         int wo = GetFirstWildcardOccurrence(wt);
         if ( wo >= 0 )
         {
@@ -817,17 +1177,14 @@ bool WorkData::CompareSubstringWithFragment( int fs_start,
             if ( (int)len == fs_len )
             {
                 match = (size_t)len+fs_start <= from_str.size() &&
-                        (size_t)len+start <= from_str.size();
-                for ( int i = 0; i < len && match; i++ )
-                {
-                    match = from_str[i+fs_start] == from_str[i+start];
-                }
+                        (size_t)len+start <= from_str.size() &&
+                        FromSubstringsAreEqual( fs_start, start, len );
             }
         }
     }
     else
     {
-        const TaggedString & pat = GetCurPat();
+        const TaggedString & pat = GetCurPat().GetStr();
         int start = GetPatFragStartInPat(frag_ix);
         int len = GetPatFragLengthInPat(frag_ix);
 
@@ -847,28 +1204,209 @@ bool WorkData::CompareSubstringWithFragment( int fs_start,
 
 
 
-void WorkData::GetFromStringInfo()
+void WorkData::CountFromStringChars()
 {
+    for ( size_t ci = 0; ci < TAGGED_CHAR_END; ci++ )
+    {
+        myFromStringCharCount[ci] = 0;
+    }
+
     const TaggedString & from_str = GetFromStr();
-    myFromStringCNext.clear();
-    myFromStringCNext.resize( from_str.size() );
-    myFromStringCharsUsed.reset();
 
+    UpdateCharCounts( from_str, 0, (int)from_str.size(), 1 );
+}
+
+
+
+void WorkData::UpdateCharCounts( const TaggedString & theStr,
+                                 int theStartIx,
+                                 int theEndIx,
+                                 int theDelta )
+{
+    assert( theStartIx >= 0 && theEndIx <= (int)theStr.size() );
+
+    for ( int si = theStartIx; si < theEndIx; si++ )
+    {
+        myFromStringCharCount[theStr[si]] += theDelta;
+    }
+}
+
+
+
+void WorkData::UpdateBigramCounts( const TaggedString & theStr,
+                                   int theStartIx,
+                                   int theEndIx,
+                                   int theDelta )
+{
+    assert( theStartIx >= 0 && theEndIx <= (int)theStr.size() );
+
+    if ( theEndIx - theStartIx < 2 )
+    {
+        return;
+    }
+
+    // this runs over every edit, so avoid the vector operator[] calls
+    const TaggedChar_t * str = &theStr[0];
+    int * counts = &myFromStringBigramCount[0];
+
+    for ( int si = theStartIx; si + 1 < theEndIx; si++ )
+    {
+        counts[str[si] * TAGGED_CHAR_END + str[si + 1]] += theDelta;
+    }
+}
+
+
+
+void WorkData::SetCharsUsedFromCounts()
+{
+    for ( size_t ci = 0; ci < TAGGED_CHAR_END; ci++ )
+    {
+        assert( myFromStringCharCount[ci] >= 0 );
+
+        myFromStringCharsUsed.set( ci, myFromStringCharCount[ci] != 0 );
+    }
+}
+
+
+
+void WorkData::IndexFromString()
+{
+    int from_len = (int)myFromStr.size();
+    int indexed_len = myFromStringIndexedLen;
+    int * next_pos[TAGGED_CHAR_END];
+
+    assert( indexed_len <= from_len );
+
+    // Keep the positions before indexed_len, which have not changed.
+    // myFromStringCharCount tells how many positions there are now,
+    // so each vector only needs to be resized once.
     for ( size_t ci = 0; ci < TAGGED_CHAR_END; ci++ )
     {
-        myFromStringCFirst[ci] = -1;
+        vector<int> & positions = myFromStringCharPos[ci];
+        size_t num_kept = positions.size();
+        bool changed = num_kept != 0 && positions.back() >= indexed_len;
+
+        if ( !changed && num_kept == (size_t)myFromStringCharCount[ci] )
+        {   // all of these positions are before indexed_len
+            continue;
+        }
+
+        if ( changed )
+        {
+            num_kept = lower_bound( positions.begin(), positions.end(),
+                                    indexed_len ) - positions.begin();
+        }
+
+        positions.resize( myFromStringCharCount[ci] );
+        next_pos[ci] = positions.empty() ? 0 : &positions[0] + num_kept;
     }
 
-    for ( int si = (int)from_str.size() - 1; si >= 0; si-- )
+    const TaggedChar_t * fs = from_len == 0 ? 0 : &myFromStr[0];
+
+    for ( int si = indexed_len; si < from_len; si++ )
     {
-        TaggedChar_t tc = from_str[si];
+        *next_pos[fs[si]]++ = si;
+    }
+
+    myFromStringIndexedLen = from_len;
+    myFromStringIsIndexed = true;
+}
+
+
 
-        myFromStringCNext[si]  = myFromStringCFirst[tc];
-        myFromStringCFirst[tc] = si;
-        myFromStringCharsUsed.set(tc);
+void WorkData::HashFromString()
+{
+    int from_len = (int)myFromStr.size();
+    int hashed_len = myFromStringHashedLen;
+
+    assert( hashed_len <= from_len );
+
+    myFromStringHash.resize( from_len + 1 );
+
+    if ( myHashPowers.empty() )
+    {
+        myHashPowers.push_back( 1 );
+    }
+
+    while ( (int)myHashPowers.size() <= from_len )
+    {
+        myHashPowers.push_back( myHashPowers.back() * HASH_BASE );
+    }
+
+    const TaggedChar_t * fs = &myFromStr[0];
+    unsigned long long * hash = &myFromStringHash[0];
+
+    hash[0] = 0;
+
+    for ( int si = hashed_len; si < from_len; si++ )
+    {
+        hash[si + 1] = hash[si] * HASH_BASE + fs[si];
+    }
+
+    myFromStringHashedLen = from_len;
+}
+
+
+
+void WorkData::CountFromStringTags()
+{
+    int from_len = (int)myFromStr.size();
+    int counted_len = myFromStringTagCountedLen;
+
+    assert( counted_len <= from_len );
+
+    myFromStringTaggedCount.resize( from_len + 1 );
+
+    const TaggedChar_t * fs = &myFromStr[0];
+    int * count = &myFromStringTaggedCount[0];
+
+    count[0] = 0;
+
+    for ( int si = counted_len; si < from_len; si++ )
+    {
+        count[si + 1] = count[si] + (IsTagged( fs[si] ) ? 1 : 0);
+    }
+
+    myFromStringTagCountedLen = from_len;
+}
+
+
+
+bool WorkData::FromSubstringsAreEqual( int theStartIx1,
+                                       int theStartIx2,
+                                       int theLength )
+{
+    int from_len = (int)myFromStr.size();
+
+    assert( theStartIx1 >= 0 && theStartIx1 + theLength <= from_len );
+    assert( theStartIx2 >= 0 && theStartIx2 + theLength <= from_len );
+
+    if ( theStartIx1 == theStartIx2 || theLength <= 0 )
+    {
+        return true;
+    }
+
+    const TaggedChar_t * fs = &myFromStr[0];
+
+    if ( theLength >= MIN_HASH_COMPARE_LEN )
+    {
+        if ( myFromStringHashedLen < from_len )
+        {
+            HashFromString();
+        }
+
+        const unsigned long long * hash = &myFromStringHash[0];
+        unsigned long long power = myHashPowers[theLength];
+
+        if ( hash[theStartIx1 + theLength] - hash[theStartIx1] * power !=
+             hash[theStartIx2 + theLength] - hash[theStartIx2] * power )
+        {
+            return false;
+        }
     }
 
-    myFromStringHasInfo = true;
+    return equal( fs + theStartIx1, fs + theStartIx1 + theLength,
+                  fs + theStartIx2 );
 }
 
 
@@ -879,6 +1417,7 @@ void WorkData::ClearPrefixAndSuffix()
     myPrefix.myLength = 0;
     mySuffix.myStart  = 0;
     mySuffix.myLength = 0;
+    myHasPrefixAndSuffix = false;
 }
 
 
@@ -893,6 +1432,7 @@ void WorkData::SetPrefixAndSuffix( int first_match_ix,
     myPrefix.myLength = first_match_ix;
     mySuffix.myStart = last_match_ix;
     mySuffix.myLength = (int)fromstr.size() - last_match_ix;
+    myHasPrefixAndSuffix = true;
 }
 
 
@@ -14,12 +14,18 @@
 //                          pattern matched.  Last time through the main
 //                          Work loop it was the To String.
 //
-//      The To String and From String are actually stored in strings
-//      myWorkA and myWorkB, and myFromStringIsA identifies which of these
-//      is the From String and which is the To String.
+//      The From String is stored in myFromStr.  The To String is usually
+//      the prefix of the From String (everything before the substring
+//      matched by the pattern), followed by the replacement chars,
+//      followed by the suffix of the From String (everything after the
+//      match).  Only the replacement chars are stored, in myToStr;
+//      myToStringHasPrefix and myToStringHasSuffix tell whether the
+//      prefix and suffix are part of the To String.
 //      Note that before each pass the To string is moved to the From string
-//      and the To string is cleared.  Instead of actually moving the strings
-//      (which could be large), the myFromStringIsA is complemented.
+//      and the To string is cleared.  Instead of copying the whole string,
+//      the replacement chars are spliced into myFromStr in place of the
+//      matched substring, which only moves the suffix.  If the whole
+//      From String is replaced, myFromStr and myToStr are swapped.
 //
 //      The From String has the following sub-data items:
 //
@@ -32,20 +38,71 @@
 //                                  pattern are in the From String, it
 //                                  can't match.
 //
-//          myFromStringCFirst:     This is a vector indexed by char which
-//                                  indicates the first position of that
-//                                  character in From String, or -1 if not used.
+//          myFromStringCharCount:  This is a vector indexed by char which
+//                                  counts the occurrences of that character
+//                                  in the From String.  After each step it
+//                                  is updated from the chars removed and
+//                                  inserted by the replacement, which keeps
+//                                  myFromStringCharsUsed exact without
+//                                  rescanning the From String.
 //
-//          myFromStringCNext:      This is an int vector with as many elements
-//                                  as there are characters in the From String,
-//                                  and indicates the position of the next
-//                                  occurrence of this character.  This permits
-//                                  rapid searching for pattern fragments in
-//                                  the From Str, since we only need to check
-//                                  substrings beginning with the first character
-//                                  of the pattern fragment, and can advance the
-//                                  From String pointer directly to the next
-//                                  occurrence of this starting char if no match.
+//          myFromStringBigramCount:
+//                                  This is a vector indexed by bigram
+//                                  (see TAGGED_BIGRAM_END) which counts
+//                                  the occurrences of each pair of
+//                                  adjacent chars in the From String.
+//                                  Like myFromStringCharCount, it is
+//                                  updated from the chars around each edit.
+//                                  A pattern can't match if the From
+//                                  String has none of one of its bigrams.
+//
+//          myFromStringCharPos:    This is a vector indexed by char of
+//                                  sorted vectors of the positions of that
+//                                  character in the From String.  This
+//                                  permits rapid searching for pattern
+//                                  fragments in the From String, since we
+//                                  only need to check substrings beginning
+//                                  with the first character of the pattern
+//                                  fragment, and can jump directly to the
+//                                  first occurrence of this starting char
+//                                  at or after a given position.
+//
+//                                  myFromStringCharPos is built when first
+//                                  needed.  Only the chars from
+//                                  myFromStringIndexedLen on have changed
+//                                  since it was last built, so only the
+//                                  positions from there on are rebuilt.
+//
+//          myFromStringHash:       This is a vector of polynomial hashes
+//                                  of the prefixes of the From String:
+//                                  element i is the hash of the first i
+//                                  chars.  The hash of any substring is
+//                                  worked out from two of them, so two
+//                                  long substrings can be compared in
+//                                  constant time, and their chars only
+//                                  need to be compared if the hashes are
+//                                  the same.  This is used to check that
+//                                  a repeated unique wildcard ($%?.)
+//                                  matches the same chars as its first
+//                                  occurrence.
+//
+//                                  Like myFromStringCharPos, it is built
+//                                  when first needed, and only from the
+//                                  first changed char (myFromStringHashedLen)
+//                                  on.
+//
+//          myFromStringTaggedCount:
+//                                  This is a vector which counts the
+//                                  tagged chars in the prefixes of the
+//                                  From String: element i is the number
+//                                  of tagged chars in the first i chars.
+//                                  A substring has no tagged chars if the
+//                                  counts at its ends are the same, so the
+//                                  check that a $%?. wildcard matches only
+//                                  untagged chars doesn't depend on the
+//                                  length of the substring.  It is built
+//                                  and updated the same way as
+//                                  myFromStringHash.
 //
 //          myFromStringWildcards:  This is a vector whose elements
 //                                  describe substrings in From String
@@ -62,39 +119,43 @@
 //                                  this substring, and if so, where it is
 //                                  so it can be quickly compared.
 //
-//      myCurPat:               This is a pointer to the current pattern
-//                              string we are doing pattern matching on.
+//      myCurPat:               This is a pointer to the compiled pattern
+//                              we are doing pattern matching on.  The
+//                              fragments of the pattern are precomputed
+//                              in the Pattern (see pattern.h).
 //                              If we call GetCurPat() and there is no
-//                              pattern string set, we will assert.
-//                              The pattern string has these sub-data items:
-//
-//          myPatternFragments:     This is a vector which describes the
-//                                  start and length in the pattern string
-//                                  of each contiguous set of non-wildcard
-//                                  characters, or of a single unique
-//                                  wildcard character we have already seen
-//                                  and whose position is fixed (by having
-//                                  at least one non-wildcard fragment
-//                                  between this fragment and the first
-//                                  occurrence of the wildcard.  Once the
-//                                  unique wildcard is fixed, we can find
-//                                  its substring just like it was a
-//                                  non-wildcard fragment.
+//                              pattern set, we will assert.
+//                              The current pattern has this sub-data item:
 //
 //          myPatFragCurrentPos:    This is an int vector with elements that
-//                                  correspond to the elements of
-//                                  myPatternFragments, that indicates the
+//                                  correspond to the fragments of
+//                                  the current pattern, that indicates the
 //                                  position of that fragment in the
 //                                  From String, or -1 if not found yet.
 //
 // HISTORY:
 //      14-DEC-12   D.Brown     Created
+//      17-OCT-26   D.Brown     Use precompiled Pattern fragments
+//      17-OCT-26   D.Brown     Bulk copies for compiled Replacement
+//      17-OCT-26   D.Brown     Update From String info from each edit
+//      17-OCT-26   D.Brown     Splice the replacement into the From String
+//      17-OCT-26   D.Brown     Sorted position lists instead of CFirst/CNext
+//      17-OCT-26   D.Brown     Added FindLiteral
+//      17-OCT-26   D.Brown     Added FindSubstring
+//      17-OCT-26   D.Brown     Added GetLastEdit
+//      17-OCT-26   D.Brown     Added GetFromStrCharCount
+//      17-OCT-26   D.Brown     Added GetFromStrBigramCount
+//      17-OCT-26   D.Brown     GetLastEdit leaves out unchanged chars
+//      17-OCT-26   D.Brown     Compare long substrings by prefix hashes
+//      17-OCT-26   D.Brown     Added FromSubstringIsUntagged, GetNextTaggedPos
+//      17-OCT-26   D.Brown     Added Reset
 
 #ifndef WORK_DATA_H
 #define WORK_DATA_H
 
 
 #include "tagged_char.h"
+#include "pattern.h"
 #include <vector>
 #include <bitset>
 #include <iostream>
@@ -105,15 +166,6 @@
 struct WildcardOccurrence;
 
 
-// This identifies either a set of contiguous non-wildcard characters
-// in the current pattern, or a single already-matched unique wildcard char.
-struct PatternFragment
-{
-    int     myStart;
-    int     myLength;       // -1 means this is a wildcard char
-};
-
-
 class WorkData
 {
 public:
@@ -131,18 +183,23 @@ public:
 
     const std::bitset<TAGGED_CHAR_END> & GetFromStrCharsUsed();
 
-    // return index in first string of first occurrence of char tc,
-    // or -1 if there are no occurrences.
-    int GetFromStrCFirst( TaggedChar_t tc );
+    // returns how many times the char tc occurs in the From String
+    int GetFromStrCharCount( TaggedChar_t tc ) const;
 
-    // returns index in first string of the next occurrence of
-    // the character at index i, or -1 if there are no next chars
-    int GetFromStrCNext( int i );
+    // returns how many times theBigram (see TAGGED_BIGRAM_END) occurs
+    // in the From String
+    int GetFromStrBigramCount( int theBigram ) const;
+
+    // returns the positions in the From String of the char tc,
+    // in increasing order.
+    const std::vector<int> & GetFromStrCharPositions( TaggedChar_t tc );
 
     void GetSubstringOfFromStr( TaggedString & theStr,
                                 int theStartIx,
                                 int theLen );
 
+    // Returns the whole To String.  If it includes the prefix or suffix,
+    // this copies it, so it should only be used for output.
     const TaggedString & GetToStr();
 
     void ClearWildcardOccurrences();
@@ -162,12 +219,18 @@ public:
     // otherwise returns the occurrence # of the first occurrence
     int GetFirstWildcardOccurrence( Wildcard_t theWildcardType );
 
-    // before first call, theOccurrence should be -1.
-    // Gets the next wildcard occurrence of this kind of wildcard,
-    // wrapping around at the end of the array.  If there are no
-    // occurrences of this wildcard, will return theOccurrence = -1.
-    void GetNextWildcardOccurrence( Wildcard_t theWildcardType,
-                                    int & theOccurrence );
+    // Groups the wildcard occurrences by wildcard type, for
+    // GetWildcardUseInfo.  Call after the pattern has been matched.
+    void IndexWildcardOccurrences();
+
+    // Gets the From String substring for theUseIx'th use of wildcard
+    // theWildcardType in the replacement string.  The uses cycle through
+    // the occurrences of this wildcard in the pattern, wrapping around at
+    // the end.  Returns false if there are no occurrences of this wildcard.
+    bool GetWildcardUseInfo( Wildcard_t theWildcardType,
+                             int        theUseIx,
+                             int &      theStartIx,
+                             int &      theLength );
 
     // Found a new occurrence of theWildcardType in the from string.
     // If this wildcard type has already been found, compare its string
@@ -177,6 +240,15 @@ public:
                                        int        theStartIx,
                                        int        theLength );
 
+    // Returns true if none of the From String chars from theStartIx
+    // up to theEndIx are tagged.
+    bool FromSubstringIsUntagged( int theStartIx,
+                                  int theEndIx );
+
+    // Returns the position of the first tagged char at or after
+    // theStartIx in the From String, or its length if there is none.
+    int GetNextTaggedPos( int theStartIx );
+
     // Stores an occurrence of a wildcard of type theWildcardType which
     // matches the From String substring starting at theStartingIndex and
     // of size theSize.
@@ -186,18 +258,52 @@ public:
 
     // Moves the To string to the From String, clears the To String and
     // all of the other attributes associated with the From String.
+    // Only the replaced chars are used to update the From String info.
     void MoveToStringToFromString();
 
+    // Gets the part of the From String which MoveToStringToFromString
+    // replaced: theOldLength chars starting at theStartIx were replaced
+    // by theLength chars.  Everything before them is unchanged, and
+    // everything after them is the old From String shifted by the change
+    // in length.
+    void GetLastEdit( int & theStartIx,
+                      int & theLength,
+                      int & theOldLength ) const;
+
     // Clear the From String and all associated attributes
     void ClearFromString();
 
+    // Clears everything, as if newly constructed, for the next input.
+    // The memory of the strings and vectors is kept for it, unless they
+    // have grown past theMaxKeptLength elements.
+    void Reset( size_t theMaxKeptLength );
+
     void ClearToString();
 
     void AppendCharToToString( TaggedChar_t theChar );
 
     void AppendStringToToString( const TaggedString & theStr );
 
-    void AppendWildcardOccurrenceToToString( int wildcard_occurrence );
+    // Makes sure the To String can grow to theLength chars
+    // without reallocating.
+    void ReserveToString( size_t theLength );
+
+    // Appends theLen chars of theStr starting at theStartIx.
+    void AppendSubstringToToString( const TaggedString & theStr,
+                                    int theStartIx,
+                                    int theLen );
+
+    // Appends theLen chars of the From String starting at theStartIx.
+    void AppendFromSubstringToToString( int theStartIx,
+                                        int theLen );
+
+    // Starts the To String with the prefix set by SetPrefixAndSuffix.
+    // The To String must be empty.
+    void AppendPrefixToToString();
+
+    // Ends the To String with the suffix set by SetPrefixAndSuffix.
+    // Nothing more can be appended after this.
+    void AppendSuffixToToString();
 
     // used to backtrack during pattern matching of the from string.
     // deletes any wildcard occurrences whose substrings are not
@@ -205,14 +311,14 @@ public:
     void UnmatchFromString( int theNewMatchLength );
 
     // Sets the current pattern to thePattern.
-    void SetCurrentPattern( const TaggedString & thePattern );
+    void SetCurrentPattern( const Pattern & thePattern );
 
     // Sets the current pattern to nothing.
     void UnrefCurrentPattern();
 
-    // Gets the current pattern string, or asserts if there is no
+    // Gets the current pattern, or asserts if there is no
     // current pattern.
-    const TaggedString & GetCurPat() const;
+    const Pattern & GetCurPat() const;
 
     // Returns true if there is a current pattern set by SetCurrentPattern
     // or false if the current pattern has been unreferenced by
@@ -232,7 +338,7 @@ public:
     // If this is a wildcard fragment, returns the start & len
     // of the matched substring, or start=-1 and len=-1;
     // If this is a normal fragment, returns the start & len of
-    // the substring from the myPatternFragments array,
+    // the substring from the current pattern fragments,
     // which means that it must be already matched.
     // returns true if start and len are >= 0.
     bool GetPatFragStartLengthInFromStr( size_t frag_ix,
@@ -249,6 +355,10 @@ public:
     // even if it is a wildcard fragment (returns the wildcard char)
     TaggedChar_t GetPatFragFirstCharInPat( size_t frag_ix );
 
+    // Returns the wildcard type of the first character of the fragment
+    // in the pattern, or WC_END if it is not a wildcard fragment.
+    Wildcard_t GetPatFragWildcardType( size_t frag_ix );
+
     // Returns the starting position of the fragment in the pattern string.
     int GetPatFragStartInPat( size_t frag_ix );
 
@@ -272,6 +382,16 @@ public:
     bool AdvancePatFragPos( size_t frag_ix,
                             int fromstr_min_pos );
 
+    // Returns the position of the leftmost occurrence of theStr
+    // in the From String, or -1 if there is none.  theStr can't be empty.
+    int FindLiteral( const TaggedString & theStr );
+
+    // Returns the first position >= theMinPos in the From String where
+    // the theLen chars of theChars occur, or -1 if there is none.
+    int FindSubstring( const TaggedChar_t * theChars,
+                       int theLen,
+                       int theMinPos );
+
     // Verifies that the substring matched by pattern fragment frag_ix
     // matches the From String starting at index fromstr_ix.
     // The pattern fragment may be in the pattern or an already
@@ -303,36 +423,110 @@ public:
                              int & suffix_len );
 
 private:
-    // gets myFromStringCharsUsed, myFromStringCNext,
-    // and myFromStringCNext and sets myFromStringHasInfo to true
-    void GetFromStringInfo();
+    // counts the chars in the From String for myFromStringCharCount
+    void CountFromStringChars();
+
+    // adds theDelta to myFromStringCharCount for each of the chars
+    // in theStr from theStartIx up to theEndIx
+    void UpdateCharCounts( const TaggedString & theStr,
+                           int theStartIx,
+                           int theEndIx,
+                           int theDelta );
+
+    // adds theDelta to myFromStringBigramCount for each pair of
+    // chars in theStr from theStartIx up to theEndIx
+    void UpdateBigramCounts( const TaggedString & theStr,
+                             int theStartIx,
+                             int theEndIx,
+                             int theDelta );
+
+    // sets myFromStringCharsUsed from myFromStringCharCount
+    void SetCharsUsedFromCounts();
+
+    // Returns how many chars are the same in the From String going from
+    // theFromIx towards theFromEndIx and in the To String going from
+    // theToIx towards theToEndIx, stepping by theStep (1 or -1).
+    int CountSameChars( int theFromIx,
+                        int theFromEndIx,
+                        int theToIx,
+                        int theToEndIx,
+                        int theStep ) const;
+
+    // replaces the From String chars from theStartIx up to theEndIx
+    // with theStr
+    void SpliceFromString( int theStartIx,
+                           int theEndIx,
+                           const TaggedString & theStr );
+
+    // Returns the index in GetFromStrCharPositions(theChars[0]) of the
+    // first position >= theMinPos where the theLen chars of theChars
+    // occur, or the size of that vector if there is none.  The positions
+    // before index theHint must be < theMinPos.
+    size_t FindSubstringPosIx( const TaggedChar_t * theChars,
+                               int theLen,
+                               int theMinPos,
+                               size_t theHint );
+
+    // rebuilds myFromStringCharPos from myFromStringIndexedLen
+    // to the end of the From String
+    void IndexFromString();
+
+    // rebuilds myFromStringHash from myFromStringHashedLen
+    // to the end of the From String
+    void HashFromString();
+
+    // rebuilds myFromStringTaggedCount from myFromStringTagCountedLen
+    // to the end of the From String
+    void CountFromStringTags();
+
+    // Returns true if the theLength chars of the From String starting
+    // at theStartIx1 are the same as the ones starting at theStartIx2.
+    // Both substrings must be in the From String.
+    bool FromSubstringsAreEqual( int theStartIx1,
+                                 int theStartIx2,
+                                 int theLength );
 
 private:
-    TaggedString myWorkA;
-    TaggedString myWorkB;
-
-    bool myFromStringIsA;
+    TaggedString myFromStr;
+    TaggedString myToStr;               // replacement chars only
+    TaggedString myToStrCopy;           // whole To String, for GetToStr
+    bool myToStringHasPrefix;
+    bool myToStringHasSuffix;
 
     std::bitset<TAGGED_CHAR_END> myFromStringCharsUsed;
-    std::vector<int> myFromStringCNext;
-    int myFromStringCFirst[TAGGED_CHAR_END];
-    bool myFromStringHasInfo;
+    int myFromStringCharCount[TAGGED_CHAR_END];
+    std::vector<int> myFromStringBigramCount;
+    std::vector<int> myFromStringCharPos[TAGGED_CHAR_END];
+    bool myFromStringIsIndexed;         // myFromStringCharPos is up to date
+    int myFromStringIndexedLen;         // chars before this are unchanged
+    std::vector<unsigned long long> myFromStringHash;
+    std::vector<unsigned long long> myHashPowers;   // powers of HASH_BASE
+    int myFromStringHashedLen;          // chars before this are unchanged
+    std::vector<int> myFromStringTaggedCount;
+    int myFromStringTagCountedLen;      // chars before this are unchanged
+    int myLastEditStart;                // see GetLastEdit
+    int myLastEditLength;
+    int myLastEditOldLength;
 
     // identifies substrings of myFromStr which are matched by wildcards
     std::vector<WildcardOccurrence> myFromStringWildcards;
     int myFirstWildcardOccurrence[WC_END+1];  // -1 if no wildcards of this type yet
 
-    const TaggedString * myCurPat;            // current pattern
+    // indices in myFromStringWildcards of each type, see IndexWildcardOccurrences
+    std::vector<int> myWildcardsOfType[WC_END];
 
-    // spans of contiguous non-wildcard characters in current pattern
-    // or single already matched wildcard characters in pattern
-    std::vector<PatternFragment> myPatternFragments;
+    const Pattern * myCurPat;                 // current pattern
 
     PatternFragment myPrefix;
     PatternFragment mySuffix;
+    bool myHasPrefixAndSuffix;          // set by SetPrefixAndSuffix
 
-    // positions in myFromStr of each fragment in myPatternFragment
+    // positions in myFromStr of each fragment in myCurPat
     std::vector<int> myPatFragCurrentPos;   // -1 if not known yet
+
+    // index of myPatFragCurrentPos in its myFromStringCharPos vector,
+    // where AdvancePatFragPos starts searching
+    std::vector<size_t> myPatFragCurrentPosIx;
 };
 
 
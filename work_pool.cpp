@@ -0,0 +1,59 @@
+// FILE: work_pool.cpp
+//
+// DESCRIPTION:
+//      Implements module described in work_pool.h
+//
+// HISTORY:
+//      17-OCT-26   D.Brown     Created
+
+#include "work_pool.h"
+#include "work.h"
+
+
+using namespace std;
+
+
+
+WorkPool::WorkPool( const Program & theProgram,
+                    bool isVerbose,
+                    bool theDebugToConsole,
+                    size_t theMaxKeptLength ) :
+    myProgram( theProgram ),
+    myIsVerbose( isVerbose ),
+    myDebugToConsole( theDebugToConsole ),
+    myMaxKeptLength( theMaxKeptLength )
+{
+}
+
+
+
+WorkPool::~WorkPool()
+{
+    for ( size_t i = 0; i < myIdleWorks.size(); i++ )
+    {
+        delete myIdleWorks[i];
+    }
+}
+
+
+
+Work & WorkPool::Acquire()
+{
+    if ( myIdleWorks.empty() )
+    {
+        return *new Work( myProgram, myIsVerbose, myDebugToConsole );
+    }
+
+    Work * work = myIdleWorks.back();
+    myIdleWorks.pop_back();
+
+    return *work;
+}
+
+
+
+void WorkPool::Release( Work & theWork )
+{
+    theWork.Reset( myMaxKeptLength );
+    myIdleWorks.push_back( &theWork );
+}
@@ -0,0 +1,72 @@
+// FILE: work_pool.h
+//
+// DESCRIPTION:
+//      Defines class WorkPool, which keeps Work objects for one program
+//      so they can be used again for the next input, instead of a new
+//      Work being built for each one.
+//
+//      Building a Work builds its RuleCertificates for the program, its
+//      RuleIndex starts with an empty cache, and its WorkData starts with
+//      empty buffers which have to grow again while the input is
+//      transformed.  A Work from the pool
+//      has been Reset, so it keeps its RuleIndex cache and the memory of
+//      its buffers, and most inputs can be transformed without
+//      allocating.  So that one very long input doesn't hold on to its
+//      memory for the rest of the run, buffers which grew past
+//      theMaxKeptLength elements are freed when the Work is released.
+//
+//      A WorkPool is not locked, so each thread which runs the program
+//      has its own.
+//
+// HISTORY:
+//      17-OCT-26   D.Brown     Created
+
+#ifndef WORK_POOL_H
+#define WORK_POOL_H
+
+
+#include "instr.h"
+#include <vector>
+
+
+class Work;
+
+
+// default for WorkPool theMaxKeptLength
+#define DEFAULT_MAX_KEPT_LENGTH 65536
+
+
+class WorkPool
+{
+public:
+    WorkPool( const Program & theProgram,
+              bool isVerbose,
+              bool theDebugToConsole,
+              size_t theMaxKeptLength = DEFAULT_MAX_KEPT_LENGTH );
+
+    ~WorkPool();
+
+private:
+    WorkPool( const WorkPool & theOther );
+
+    const WorkPool & operator = ( const WorkPool & theOther );
+
+public:
+    // Returns a Work which is ready for DoTransformations, taking
+    // one from the pool if there is one, or else building one.
+    Work & Acquire();
+
+    // Resets theWork, which was returned by Acquire, and puts it back
+    // in the pool.
+    void Release( Work & theWork );
+
+private:
+    const Program & myProgram;
+    bool myIsVerbose;
+    bool myDebugToConsole;
+    size_t myMaxKeptLength;
+    std::vector<Work *> myIdleWorks;
+};
+
+
+#endif // WORK_POOL_H
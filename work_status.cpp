@@ -6,6 +6,9 @@
 // HISTORY:
 //      14-DEC-12   D.Brown     Created
 //      26-DEC-12   D.Brown     Added WS_ERROR_CANT_CREATE_IMMEDIATE_FILE
+//      17-OCT-26   D.Brown     Added errors for loading programs in libmarkov
+//      17-OCT-26   D.Brown     Added errors for serve mode
+//      17-OCT-26   D.Brown     Added WS_ERROR_DUPLICATE_PROGRAM
 
 #include "work_status.h"
 #include "misc.h"
@@ -26,6 +29,12 @@ static const StrTabElement_t g_WorkStatusNames[] =
     { WS_ERROR_NO_MATCHING_XFORMS,          "ERROR_NO_MATCHING_XFORMS" },
     { WS_ERROR_START_STEP_NO_MATCH,         "ERROR_START_STEP_NO_MATCH" },
     { WS_ERROR_STACK_EMPTY,                 "ERROR_STACK_EMPTY" },
+    { WS_ERROR_CANT_OPEN_PROGRAM_FILE,      "ERROR_CANT_OPEN_PROGRAM_FILE" },
+    { WS_ERROR_PROGRAM_SYNTAX,              "ERROR_PROGRAM_SYNTAX" },
+    { WS_ERROR_OUT_OF_MEMORY,               "ERROR_OUT_OF_MEMORY" },
+    { WS_ERROR_CANT_OPEN_SOCKET,            "ERROR_CANT_OPEN_SOCKET" },
+    { WS_ERROR_UNKNOWN_PROGRAM,             "ERROR_UNKNOWN_PROGRAM" },
+    { WS_ERROR_DUPLICATE_PROGRAM,           "ERROR_DUPLICATE_PROGRAM" },
     { -1,                                   0 }
 };
 
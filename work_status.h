@@ -9,6 +9,9 @@
 // HISTORY:
 //      14-DEC-12   D.Brown     Created
 //      26-DEC-12   D.Brown     Added WS_ERROR_CANT_CREATE_IMMEDIATE_FILE
+//      17-OCT-26   D.Brown     Added errors for loading programs in libmarkov
+//      17-OCT-26   D.Brown     Added errors for serve mode
+//      17-OCT-26   D.Brown     Added WS_ERROR_DUPLICATE_PROGRAM
 
 #ifndef WORK_STATUS_H
 #define WORK_STATUS_H
@@ -30,6 +33,12 @@ enum WorkStatus_t
     WS_ERROR_NO_MATCHING_XFORMS,        // no matching xforms found in program
     WS_ERROR_START_STEP_NO_MATCH,       // start step must succeed
     WS_ERROR_STACK_EMPTY,               // stack is unexpectedly empty
+    WS_ERROR_CANT_OPEN_PROGRAM_FILE,    // unable to open program file
+    WS_ERROR_PROGRAM_SYNTAX,            // syntax error in program
+    WS_ERROR_OUT_OF_MEMORY,             // memory allocation failed
+    WS_ERROR_CANT_OPEN_SOCKET,          // unable to listen on the socket
+    WS_ERROR_UNKNOWN_PROGRAM,           // request names no served program
+    WS_ERROR_DUPLICATE_PROGRAM,         // two served programs have one name
 
     WS_END
 };